@@ -0,0 +1,168 @@
+#pragma once
+
+/**
+ * C++20 awaitables on top of FeedbackDispatcher; this header is empty when coroutines are not available.
+ */
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <chrono>
+#include <coroutine>
+#include <functional>
+#include <inputtino/feedback.hpp>
+#include <inputtino/input.hpp>
+#include <optional>
+
+namespace inputtino::coro {
+
+/**
+ * Decides where suspended coroutines are resumed, ex: `[&io](auto handle) { asio::post(io, handle); }`
+ */
+using Executor = std::function<void(std::coroutine_handle<>)>;
+
+/**
+ * Resumes coroutines inline, on the thread that is calling `FeedbackDispatcher::dispatch()`
+ */
+inline void resume_inline(std::coroutine_handle<> handle) {
+  handle.resume();
+}
+
+/**
+ * Awaitable feedback and readiness for any number of devices, driven by the fd of a FeedbackDispatcher:
+ *
+ * ```
+ * auto dispatcher = FeedbackDispatcher::create(std::move(*FeedbackQueue::create()));
+ * auto feedback = coro::Feedback(*dispatcher);
+ * joypad.set_on_rumble(dispatcher->queue().rumble_callback(JOYPAD_ID));
+ *
+ * if (co_await feedback.ready(joypad, 1s)) {
+ *   while (true) {
+ *     auto rumble = co_await feedback.next_rumble(JOYPAD_ID);
+ *     send_rumble_to_client(rumble.payload.rumble.low_freq, rumble.payload.rumble.high_freq);
+ *   }
+ * }
+ * ```
+ *
+ * There are no callbacks on foreign threads: coroutines are resumed through the `executor`, from `dispatch()`.
+ * Suspended coroutines can be destroyed, their waits are cancelled; the dispatcher has to outlive them.
+ * Bring your own coroutine type (task, fire and forget, asio::awaitable, ...), these are just awaiters.
+ */
+class Feedback {
+public:
+  explicit Feedback(FeedbackDispatcher &dispatcher, Executor executor = resume_inline)
+      : dispatcher(dispatcher), executor(std::move(executor)) {}
+
+  /**
+   * Awaiters cancel their continuation when destroyed: a suspended coroutine can be destroyed at any time.
+   * Once the executor has been called the handle is up to it, it's not tracked anymore.
+   */
+  class NextEvent {
+  public:
+    NextEvent(const NextEvent &) = delete;
+    NextEvent &operator=(const NextEvent &) = delete;
+
+    ~NextEvent() {
+      if (wait_id) {
+        feedback.dispatcher.cancel(*wait_id);
+      }
+    }
+
+    bool await_ready() {
+      event = feedback.dispatcher.take(device_id, kind);
+      return event.has_value();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+      wait_id = feedback.dispatcher.on_next(device_id, kind, [this, handle](const FeedbackEvent &next) {
+        wait_id = std::nullopt;
+        event = next;
+        feedback.executor(handle);
+      });
+    }
+
+    FeedbackEvent await_resume() {
+      return *event;
+    }
+
+  private:
+    friend class Feedback;
+    NextEvent(Feedback &feedback, uint32_t device_id, FeedbackEvent::KIND kind)
+        : feedback(feedback), device_id(device_id), kind(kind) {}
+
+    Feedback &feedback;
+    uint32_t device_id;
+    FeedbackEvent::KIND kind;
+    std::optional<FeedbackEvent> event = std::nullopt;
+    std::optional<FeedbackDispatcher::WaitId> wait_id = std::nullopt;
+  };
+
+  class Ready {
+  public:
+    Ready(const Ready &) = delete;
+    Ready &operator=(const Ready &) = delete;
+
+    ~Ready() {
+      if (wait_id) {
+        feedback.dispatcher.cancel(*wait_id);
+      }
+    }
+
+    bool await_ready() {
+      ready = device.is_ready();
+      return ready;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+      wait_id = feedback.dispatcher.on_ready(device, timeout, [this, handle](bool is_ready) {
+        wait_id = std::nullopt;
+        ready = is_ready;
+        feedback.executor(handle);
+      });
+    }
+
+    bool await_resume() const {
+      return ready;
+    }
+
+  private:
+    friend class Feedback;
+    Ready(Feedback &feedback, const VirtualDevice &device, std::chrono::milliseconds timeout)
+        : feedback(feedback), device(device), timeout(timeout) {}
+
+    Feedback &feedback;
+    const VirtualDevice &device;
+    std::chrono::milliseconds timeout;
+    bool ready = false;
+    std::optional<FeedbackDispatcher::WaitId> wait_id = std::nullopt;
+  };
+
+  /**
+   * The next feedback event of the given kind for `device_id`; an event that has arrived while nobody was waiting is
+   * returned straight away (see FeedbackDispatcher::take())
+   */
+  NextEvent next(uint32_t device_id, FeedbackEvent::KIND kind) {
+    return {*this, device_id, kind};
+  }
+
+  NextEvent next_rumble(uint32_t device_id) {
+    return next(device_id, FeedbackEvent::RUMBLE);
+  }
+
+  NextEvent next_led(uint32_t device_id) {
+    return next(device_id, FeedbackEvent::LED);
+  }
+
+  /**
+   * true once the device nodes are ready to be opened (see VirtualDevice::wait_ready()), false after `timeout`
+   */
+  Ready ready(const VirtualDevice &device, std::chrono::milliseconds timeout) {
+    return {*this, device, timeout};
+  }
+
+private:
+  FeedbackDispatcher &dispatcher;
+  Executor executor;
+};
+
+} // namespace inputtino::coro
+
+#endif
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <inputtino/input.hpp>
+#include <inputtino/result.hpp>
+#include <memory>
+#include <optional>
+
+namespace inputtino {
+
+/**
+ * A single feedback record coming from a virtual device (rumble, LED, ...)
+ */
+struct FeedbackEvent {
+  enum KIND : uint8_t {
+    RUMBLE,
+    LED
+  };
+
+  /* Chosen by the caller when creating the callbacks, see FeedbackQueue::rumble_callback() */
+  uint32_t device_id;
+  KIND kind;
+
+  union {
+    struct {
+      int low_freq, high_freq;
+    } rumble;
+
+    struct {
+      int r, g, b;
+    } led;
+  } payload;
+};
+
+/**
+ * Collects the feedback of any number of devices into a single bounded queue.
+ *
+ * Instead of handling a `std::function` call for each device on its own private thread, devices are given callbacks
+ * that just push a FeedbackEvent into this queue (see `rumble_callback()` and `led_callback()`).
+ * Readiness is signalled through a single eventfd: add `get_fd()` to your poll/epoll loop and call `drain()` once it
+ * becomes readable to process the events of all the devices in one batch, on your own thread.
+ *
+ * Multiple producers (the device threads) and a single consumer are supported.
+ * When the queue is full new events are dropped, see `dropped()`.
+ */
+class FeedbackQueue {
+public:
+  /**
+   * @param capacity: will be rounded up to the next power of two
+   */
+  static Result<FeedbackQueue> create(std::size_t capacity = 256);
+
+  FeedbackQueue(FeedbackQueue &&q) noexcept : _state(nullptr) {
+    std::swap(q._state, _state);
+  }
+
+  ~FeedbackQueue();
+
+  /**
+   * An eventfd that will be readable when there are events to be drained
+   */
+  int get_fd() const;
+
+  /**
+   * Thread safe, returns false if the queue is full and the event has been dropped
+   */
+  bool push(const FeedbackEvent &event);
+
+  /**
+   * Moves up to `max_events` events into `events`, returns the number of events written.
+   * Only a single thread should call this at any given time.
+   */
+  std::size_t drain(FeedbackEvent *events, std::size_t max_events);
+
+  /**
+   * The number of events that have been dropped because the queue was full
+   */
+  std::size_t dropped() const;
+
+  /**
+   * A callback, suitable for `set_on_rumble()`, that pushes RUMBLE events into this queue.
+   * The callback keeps the queue alive, it can safely outlive this object.
+   */
+  std::function<void(int low_freq, int high_freq)> rumble_callback(uint32_t device_id) const;
+
+  /**
+   * A callback, suitable for `set_on_led()`, that pushes LED events into this queue.
+   * The callback keeps the queue alive, it can safely outlive this object.
+   */
+  std::function<void(int r, int g, int b)> led_callback(uint32_t device_id) const;
+
+protected:
+  typedef struct FeedbackQueueState FeedbackQueueState;
+  std::shared_ptr<FeedbackQueueState> _state;
+
+private:
+  FeedbackQueue();
+};
+
+/**
+ * Turns a FeedbackQueue, plus device readiness, into one shot continuations that are run on your own event loop:
+ * the building block of the awaitables in inputtino/coro.hpp, it can also be used directly.
+ *
+ * Add `get_fd()` to your poll/epoll loop and call `dispatch()` once it becomes readable: all the continuations are
+ * run there, on the calling thread. Thousands of devices can be served this way by a single thread.
+ *
+ * Feedback is coalesced: when events arrive while nobody is waiting for them, only the latest one for each device and
+ * kind is kept (see `take()`). Rumble and LED events carry the full state, the older ones are of no use.
+ *
+ * This is not thread safe, all the methods should be called from the thread that runs `dispatch()`.
+ * Continuations that are still waiting when this is destroyed will never be called.
+ */
+class FeedbackDispatcher {
+public:
+  using FeedbackContinuation = std::function<void(const FeedbackEvent &event)>;
+  using ReadyContinuation = std::function<void(bool ready)>;
+  /* Returned by on_next() and on_ready(), see cancel() */
+  using WaitId = uint64_t;
+
+  static Result<FeedbackDispatcher> create(FeedbackQueue queue);
+
+  FeedbackDispatcher(FeedbackDispatcher &&d) noexcept : _state(nullptr) {
+    std::swap(d._state, _state);
+  }
+
+  ~FeedbackDispatcher();
+
+  /**
+   * The queue that devices should push their feedback into, ex: `joypad.set_on_rumble(queue().rumble_callback(1))`
+   */
+  const FeedbackQueue &queue() const;
+
+  /**
+   * An epoll fd that will be readable when `dispatch()` has something to do
+   */
+  int get_fd() const;
+
+  /**
+   * Drains the queue and runs all the continuations whose event (or readiness, or timeout) has come
+   */
+  void dispatch();
+
+  /**
+   * The latest event of the given kind that has arrived while nobody was waiting for it, if any
+   */
+  std::optional<FeedbackEvent> take(uint32_t device_id, FeedbackEvent::KIND kind);
+
+  /**
+   * Calls `continuation` with the next event of the given kind for `device_id`.
+   * Only waits for new events, see `take()` for the ones that have already arrived.
+   */
+  WaitId on_next(uint32_t device_id, FeedbackEvent::KIND kind, FeedbackContinuation continuation);
+
+  /**
+   * Calls `continuation(true)` once `device` is ready (see `VirtualDevice::is_ready()`), or `continuation(false)`
+   * after `timeout`. Readiness is checked once on the next `dispatch()` and then only when device nodes show up in
+   * /dev or in the udev database. The device must outlive the wait, or the wait has to be cancelled.
+   */
+  WaitId on_ready(const VirtualDevice &device, std::chrono::milliseconds timeout, ReadyContinuation continuation);
+
+  /**
+   * Drops a continuation that hasn't been called yet, ex: because whatever it refers to is going away.
+   * Does nothing if it has already been called.
+   */
+  void cancel(WaitId id);
+
+protected:
+  typedef struct FeedbackDispatcherState FeedbackDispatcherState;
+  std::shared_ptr<FeedbackDispatcherState> _state;
+
+private:
+  FeedbackDispatcher();
+};
+
+} // namespace inputtino
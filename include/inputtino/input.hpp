@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <inputtino/result.hpp>
@@ -9,11 +11,52 @@
 #include <string>
 #include <vector>
 
+/* Defined in <linux/input.h> */
+struct ff_effect;
+
 namespace inputtino {
 
+/**
+ * All the methods of a device can be called from any thread, without any external locking.
+ *
+ * Each device has a single writer: calls that change its state (key presses, stick movements, ...) are queued and run
+ * one at a time, in the order in which each thread has submitted them. When there is no contention they run straight
+ * away on the calling thread, otherwise they might run on the thread that currently owns the device.
+ * With `DeviceDefinition::async_writes` they always run on a dedicated thread instead, see DeviceDefinition.
+ * State that can be read back (ex: `Joypad::snapshot()`) is published through a seqlock, readers never block writers.
+ */
 class VirtualDevice {
 public:
   virtual std::vector<std::string> get_nodes() const = 0;
+
+  /**
+   * Brings the device back to a neutral state: releases all keys and buttons, lifts all fingers/tools,
+   * centres sticks and triggers and stops any rumble. Everything is sent as a single frame (one SYN_REPORT or
+   * HID report), so clients will see a single state change.
+   * The kernel device is kept, so that it can be reused without hotplug events.
+   */
+  virtual void reset() = 0;
+
+  /**
+   * Prepares the device to be handed over to a new owner (ex: a client reconnecting): it's reset (see `reset()`) and
+   * all the callbacks set by the current owner (rumble, LEDs, ...) are dropped; once this returns none of them will be
+   * called anymore. The new owner can then take the (moved) object and set its own callbacks.
+   */
+  virtual void handover();
+
+  /**
+   * Blocks until all the device nodes (see `get_nodes()`) have been published by the kernel and, when udev is
+   * running, processed by udev; at that point they can be opened by libinput, SDL and the like.
+   *
+   * @return false if the nodes weren't ready before `timeout`
+   */
+  virtual bool wait_ready(std::chrono::milliseconds timeout) const;
+
+  /**
+   * Non blocking: checks once whether `wait_ready()` would return straight away
+   */
+  virtual bool is_ready() const;
+
   virtual ~VirtualDevice() = default;
 };
 
@@ -25,6 +68,15 @@ struct DeviceDefinition {
 
   std::string device_phys = "00:11:22:33:44:55";
   std::string device_uniq = "00:11:22:33:44:55";
+
+  /**
+   * When set, the methods that change the device only queue a command and return straight away, without performing
+   * any I/O on the caller's thread. A dedicated thread per device sends the commands to the kernel, batching together
+   * all the ones that have queued up in the meantime.
+   */
+  bool async_writes = false;
+  /* Pins the writer thread to the given CPU when `async_writes` is set, -1 to follow the ThreadConfig (threads.hpp) */
+  int writer_cpu = -1;
 };
 
 /**
@@ -32,20 +84,49 @@ struct DeviceDefinition {
  */
 class Mouse : public VirtualDevice {
 public:
+  /**
+   * A mouse is made of two devices: a relative one and an absolute pointer (see `move_abs()`).
+   *
+   * @param lazy_abs_device: when true, the absolute pointer device will only be created on the first call to
+   *                         `move_abs()` or `create_abs_device()`; most sessions will never need it.
+   */
   static Result<Mouse>
-  create(const DeviceDefinition &device = {
-             .name = "Wolf mouse virtual device", .vendor_id = 0xAB00, .product_id = 0xAB01, .version = 0xAB00});
+  create(const DeviceDefinition &device = {.name = "Wolf mouse virtual device",
+                                           .vendor_id = 0xAB00,
+                                           .product_id = 0xAB01,
+                                           .version = 0xAB00},
+         bool lazy_abs_device = true);
 
   Mouse(Mouse &&j) noexcept : _state(nullptr) {
     std::swap(j._state, _state);
   }
   ~Mouse() override;
   std::vector<std::string> get_nodes() const override;
+  void reset() override;
 
   void move(int delta_x, int delta_y);
 
+  /**
+   * Fractional moves, ex: from high DPI clients or after applying a sensitivity.
+   * Only whole units are sent, what's left is accumulated (per device) and added to the next moves: slow motion isn't
+   * lost and consecutive sub unit moves end up in a single event.
+   */
+  void move_subpixel(float delta_x, float delta_y);
+
+  /**
+   * When the absolute pointer device hasn't been created yet, it'll be created here.
+   * Clients that haven't opened it by the time this event is sent will only see the pointer position,
+   * use `create_abs_device()` to create it ahead of time.
+   * If creating it fails the error is logged once and absolute moves are dropped until `create_abs_device()` succeeds.
+   */
   void move_abs(int x, int y, int screen_width, int screen_height);
 
+  /**
+   * Creates the absolute pointer device, if it doesn't exist already; unlike `move_abs()` it always tries again.
+   * This is thread safe: it can be called from a background thread while the mouse is being used.
+   */
+  Result<bool> create_abs_device();
+
   enum MOUSE_BUTTON {
     LEFT,
     MIDDLE,
@@ -118,6 +199,7 @@ public:
   }
   ~Trackpad() override;
   std::vector<std::string> get_nodes() const override;
+  void reset() override;
 
   /**
    * We expect (x,y) to be in the range [0.0, 1.0]; x and y values are normalised device coordinates
@@ -155,6 +237,7 @@ public:
   }
   ~TouchScreen() override;
   std::vector<std::string> get_nodes() const override;
+  void reset() override;
 
   /**
    * We expect (x,y) to be in the range [0.0, 1.0]; x and y values are normalised device coordinates
@@ -165,6 +248,20 @@ public:
    */
   void place_finger(int finger_nr, float x, float y, float pressure, int orientation);
 
+  struct Finger {
+    int finger_nr;
+    float x;
+    float y;
+    float pressure;
+    int orientation;
+  };
+
+  /**
+   * Same as calling place_finger() for each one of them, in order; the coordinates of the whole batch are converted
+   * at once using SIMD instructions. Meant for replaying or streaming high rate touch data.
+   */
+  void place_fingers(const Finger *fingers, std::size_t count);
+
   void release_finger(int finger_nr);
 
 protected:
@@ -191,6 +288,7 @@ public:
   }
   ~PenTablet() override;
   std::vector<std::string> get_nodes() const override;
+  void reset() override;
 
   enum TOOL_TYPE {
     PEN,
@@ -220,6 +318,22 @@ public:
    */
   void place_tool(TOOL_TYPE tool_type, float x, float y, float pressure, float distance, float tilt_x, float tilt_y);
 
+  struct Tool {
+    TOOL_TYPE tool_type;
+    float x;
+    float y;
+    float pressure;
+    float distance;
+    float tilt_x;
+    float tilt_y;
+  };
+
+  /**
+   * Same as calling place_tool() for each one of them, in order; the whole batch is converted at once using SIMD
+   * instructions. Meant for replaying or streaming high rate pen data.
+   */
+  void place_tools(const Tool *tools, std::size_t count);
+
   void set_btn(BTN_TYPE btn, bool pressed);
 
 protected:
@@ -239,16 +353,32 @@ private:
  */
 class Keyboard : public VirtualDevice {
 public:
+  enum BACKEND {
+    /**
+     * A uinput device, every key press is sent as MSC_SCAN + EV_KEY + SYN_REPORT
+     * and auto repeat is emulated by re-pressing keys every `millis_repress_key`
+     */
+    UINPUT,
+    /**
+     * An N-Key Rollover HID keyboard (see src/uhid/README.adoc for the requirements).
+     * Every state change is a single report with the bitmap of all the currently held keys;
+     * `hid-input` will generate the evdev events and auto repeat, `millis_repress_key` is ignored.
+     */
+    UHID
+  };
+
   static Result<Keyboard> create(const DeviceDefinition &device = {.name = "Wolf (virtual) keyboard",
                                                                    .vendor_id = 0xAB00,
                                                                    .product_id = 0xAB05,
                                                                    .version = 0xAB00},
-                                 int millis_repress_key = 50);
+                                 int millis_repress_key = 50,
+                                 BACKEND backend = UINPUT);
   Keyboard(Keyboard &&j) noexcept : _state(nullptr) {
     std::swap(j._state, _state);
   }
   ~Keyboard() override;
   std::vector<std::string> get_nodes() const override;
+  void reset() override;
 
   void press(short key_code);
 
@@ -262,6 +392,46 @@ private:
   Keyboard();
 };
 
+/**
+ * Optional processing of the stick values, applied by Joypad::set_stick() before they are sent to the device, so that
+ * clients don't have to implement it themselves.
+ * The whole response is precomputed into lookup tables (see Joypad::set_stick_conditioning()): applying it costs a
+ * couple of table loads per sample.
+ */
+struct StickConditioning {
+  enum DEADZONE_TYPE {
+    RADIAL, // The deadzone is a circle, the direction of the stick is preserved
+    AXIAL   // Each axis has its own deadzone
+  };
+
+  DEADZONE_TYPE deadzone_type = RADIAL;
+  /* Values below this fraction of the full range are reported as 0, in [0.0, 1.0) */
+  float deadzone = 0.0f;
+  /* The smallest value reported outside the deadzone, as a fraction of the full range, in [0.0, 1.0).
+   * Compensates for the deadzone that games apply on top of ours. */
+  float anti_deadzone = 0.0f;
+  /* Response curve, between the deadzone and the full range: value ^ exponent (1.0 is linear) */
+  float exponent = 1.0f;
+  /* Overrides `exponent`: maps [0.0, 1.0] to [0.0, 1.0], it's only called while building the tables */
+  std::function<float(float)> curve = nullptr;
+  /*
+   * Exponential moving average: the weight of the new sample in (0.0, 1.0], 1.0 disables the smoothing.
+   * Until the stick reaches the last value that has been set, that value is applied again every 10ms (by a thread of
+   * the joypad): it gets there even if no new values come in.
+   */
+  float smoothing = 1.0f;
+};
+
+/**
+ * Same as StickConditioning, for the triggers [0, 255]; applied by Joypad::set_triggers()
+ */
+struct TriggerConditioning {
+  float deadzone = 0.0f;
+  float anti_deadzone = 0.0f;
+  float exponent = 1.0f;
+  std::function<float(float)> curve = nullptr;
+};
+
 /**
  * Base class for all joypads, they at the very least have to implement buttons and triggers
  */
@@ -301,6 +471,13 @@ public:
     LS
   };
 
+  enum FF_EVENT_TYPE {
+    FF_EFFECT_UPLOAD, // A new effect has been uploaded (or an existing one has been updated)
+    FF_EFFECT_PLAY,
+    FF_EFFECT_STOP,
+    FF_EFFECT_ERASE
+  };
+
   /**
    * Given the nature of joypads we (might) have to simultaneously press and release multiple buttons.
    * In order to implement this, you can pass a single short: button_flags which represent the currently pressed
@@ -315,6 +492,34 @@ public:
   virtual void set_triggers(int16_t left, int16_t right) = 0;
 
   virtual void set_stick(STICK_POSITION stick_type, short x, short y) = 0;
+
+  /**
+   * Replaces the conditioning of the given stick, the default one (`StickConditioning{}`) sends the values untouched.
+   * The tables are built on the calling thread; set_stick() is never blocked and, after the first call, switching
+   * to new tables doesn't allocate. Returns an Error if the configuration is not valid.
+   * handover() restores the default conditioning of both sticks and of the triggers.
+   */
+  virtual Result<bool> set_stick_conditioning(STICK_POSITION stick, const StickConditioning &conditioning) = 0;
+
+  virtual Result<bool> set_trigger_conditioning(const TriggerConditioning &conditioning) = 0;
+
+  /**
+   * The last values that have been set on the joypad, after the conditioning (if any)
+   */
+  struct Snapshot {
+    int pressed_buttons = 0;
+    short ls_x = 0;
+    short ls_y = 0;
+    short rs_x = 0;
+    short rs_y = 0;
+    int16_t left_trigger = 0;
+    int16_t right_trigger = 0;
+  };
+
+  /**
+   * Never blocks: can be called from any thread (ex: to collect stats) while the joypad is being updated
+   */
+  virtual Snapshot snapshot() const = 0;
 };
 
 class XboxOneJoypad : public Joypad {
@@ -332,12 +537,24 @@ public:
   ~XboxOneJoypad() override;
 
   std::vector<std::string> get_nodes() const override;
+  void reset() override;
+  void handover() override;
 
   void set_pressed_buttons(int newly_pressed) override;
   void set_triggers(int16_t left, int16_t right) override;
   void set_stick(STICK_POSITION stick_type, short x, short y) override;
+  Result<bool> set_stick_conditioning(STICK_POSITION stick, const StickConditioning &conditioning) override;
+  Result<bool> set_trigger_conditioning(const TriggerConditioning &conditioning) override;
+  Snapshot snapshot() const override;
   void set_on_rumble(const std::function<void(int low_freq, int high_freq)> &callback);
 
+  /**
+   * Alternative to `set_on_rumble()`: the raw force feedback effects (type, envelope, replay, waveform) are forwarded
+   * as they are uploaded/played/stopped/erased by the application, so that the client can synthesise them locally.
+   * The callback is called exactly once per event; no periodic magnitude updates are sent.
+   */
+  void set_on_ff_effect(const std::function<void(FF_EVENT_TYPE type, const ff_effect &effect)> &callback);
+
 protected:
   typedef struct XboxOneJoypadState XboxOneJoypadState;
   std::shared_ptr<XboxOneJoypadState> _state;
@@ -360,12 +577,24 @@ public:
   ~SwitchJoypad() override;
 
   std::vector<std::string> get_nodes() const override;
+  void reset() override;
+  void handover() override;
 
   void set_pressed_buttons(int newly_pressed) override;
   void set_triggers(int16_t left, int16_t right) override;
   void set_stick(STICK_POSITION stick_type, short x, short y) override;
+  Result<bool> set_stick_conditioning(STICK_POSITION stick, const StickConditioning &conditioning) override;
+  Result<bool> set_trigger_conditioning(const TriggerConditioning &conditioning) override;
+  Snapshot snapshot() const override;
   void set_on_rumble(const std::function<void(int low_freq, int high_freq)> &callback);
 
+  /**
+   * Alternative to `set_on_rumble()`: the raw force feedback effects (type, envelope, replay, waveform) are forwarded
+   * as they are uploaded/played/stopped/erased by the application, so that the client can synthesise them locally.
+   * The callback is called exactly once per event; no periodic magnitude updates are sent.
+   */
+  void set_on_ff_effect(const std::function<void(FF_EVENT_TYPE type, const ff_effect &effect)> &callback);
+
 protected:
   typedef struct XboxOneJoypadState SwitchJoypadState;
   std::shared_ptr<SwitchJoypadState> _state;
@@ -385,10 +614,15 @@ public:
   ~PS5Joypad() override;
 
   std::vector<std::string> get_nodes() const override;
+  void reset() override;
+  void handover() override;
 
   void set_pressed_buttons(int newly_pressed) override;
   void set_triggers(int16_t left, int16_t right) override;
   void set_stick(STICK_POSITION stick_type, short x, short y) override;
+  Result<bool> set_stick_conditioning(STICK_POSITION stick, const StickConditioning &conditioning) override;
+  Result<bool> set_trigger_conditioning(const TriggerConditioning &conditioning) override;
+  Snapshot snapshot() const override;
   void set_on_rumble(const std::function<void(int low_freq, int high_freq)> &callback);
 
   static constexpr int touchpad_width = 1920;
@@ -410,6 +644,17 @@ public:
    */
   void set_motion(MOTION_TYPE type, float x, float y, float z);
 
+  struct MotionSample {
+    float acceleration[3]; // x, y, z
+    float gyroscope[3];    // x, y, z
+  };
+
+  /**
+   * Sends one report per sample, with both the acceleration and the gyroscope; the whole batch is converted at once
+   * using SIMD instructions. Meant for replaying or streaming high rate IMU data.
+   */
+  void set_motion(const MotionSample *samples, std::size_t count);
+
   enum BATTERY_STATE : uint8_t {
     BATTERY_DISCHARGING = 0x0,
     BATTERY_CHARGHING = 0x1,
@@ -423,6 +668,13 @@ public:
 
   void set_on_led(const std::function<void(int r, int g, int b)> &callback);
 
+  /**
+   * Waits for the HID driver to bind to the device (UHID_START) before checking the device nodes
+   */
+  bool wait_ready(std::chrono::milliseconds timeout) const override;
+
+  bool is_ready() const override;
+
 protected:
   typedef struct PS5JoypadState PS5JoypadState;
   std::shared_ptr<PS5JoypadState> _state;
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <inputtino/result.hpp>
+#include <mutex>
+#include <vector>
+
+namespace inputtino {
+
+/**
+ * Keeps a number of pre-created, idle devices around so that they can be handed out immediately.
+ *
+ * Creating a device is slow: the kernel has to publish the new nodes, udev has to probe them and compositors/games
+ * will have to pick them up. With a pool this only happens ahead of time (see `fill()`) and acquiring a device is
+ * just a matter of moving it out of the pool.
+ *
+ * A pool holds devices of a single type and definition, for example:
+ *
+ * ```
+ * auto pool = DevicePool<XboxOneJoypad>(4, []() { return XboxOneJoypad::create(); });
+ * pool.fill(); // can also be called from a background thread
+ * auto joypad = pool.acquire();
+ * ...
+ * pool.release(std::move(*joypad));
+ * ```
+ *
+ * Released devices are handed over (see `VirtualDevice::handover()`): callbacks set by the previous owner are dropped,
+ * set new ones after `acquire()`.
+ * All methods are thread safe.
+ */
+template <typename T> class DevicePool {
+public:
+  using Factory = std::function<Result<T>()>;
+
+  /**
+   * @param size: how many idle devices to keep around
+   * @param factory: used to create new devices, ex: `[]() { return Mouse::create(); }`
+   */
+  DevicePool(std::size_t size, Factory factory) : size(size), factory(std::move(factory)) {}
+
+  /**
+   * Creates devices until there are `size` idle devices in the pool.
+   * Devices are created without holding the lock, so that `acquire()` and `release()` can be called in the meantime.
+   *
+   * @return the number of idle devices or the first error encountered
+   */
+  Result<std::size_t> fill() {
+    while (idle() < size) {
+      auto device = factory();
+      if (!device) {
+        return Error(device.getErrorMessage());
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (devices.size() >= size) {
+        break; // Someone else has released a device in the meantime
+      }
+      devices.push_back(std::move(*device));
+    }
+    return idle();
+  }
+
+  /**
+   * Returns one of the idle devices; if there are none left a new one will be created on the spot.
+   */
+  Result<T> acquire() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!devices.empty()) {
+        T device = std::move(devices.back());
+        devices.pop_back();
+        return device;
+      }
+    }
+    return factory();
+  }
+
+  /**
+   * Hands the device over (see `VirtualDevice::handover()`) and puts it back in the pool.
+   * If the pool is already full the device will be destroyed instead.
+   */
+  void release(T &&device) {
+    T released = std::move(device); // Destroyed here, after unlocking, when the pool is full
+    released.handover();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (devices.size() < size) {
+      devices.push_back(std::move(released));
+    }
+  }
+
+  std::size_t idle() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return devices.size();
+  }
+
+private:
+  const std::size_t size;
+  const Factory factory;
+
+  mutable std::mutex mutex;
+  std::vector<T> devices;
+};
+
+} // namespace inputtino
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <inputtino/input.hpp>
+#include <inputtino/result.hpp>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace inputtino {
+
+struct NodePermissions {
+  /* Owner of the nodes, -1 to leave it to the current user/group */
+  uid_t uid = static_cast<uid_t>(-1);
+  gid_t gid = static_cast<gid_t>(-1);
+  mode_t mode = 0660;
+};
+
+/**
+ * Copies of the device nodes of a set of devices, created under a different /dev directory (ex: the rootfs of a
+ * container) so that only the devices of a single session have to be exposed, instead of bind mounting the whole of
+ * /dev/input.
+ *
+ * Nodes keep their path relative to /dev: given `target_dev = "/containers/1/rootfs/dev"`, /dev/input/event12 will be
+ * created as /containers/1/rootfs/dev/input/event12 and /dev/hidraw3 as /containers/1/rootfs/dev/hidraw3.
+ *
+ * ```
+ * auto mouse = Mouse::create();
+ * auto keyboard = Keyboard::create();
+ * auto nodes = ProvisionedNodes::create({&*mouse, &*keyboard}, "/containers/1/rootfs/dev");
+ * ```
+ *
+ * The nodes are removed when this object is destroyed: keep it together with the devices (ex: in the same struct),
+ * so that they'll go away at the same time.
+ * Creating nodes requires CAP_MKNOD.
+ */
+class ProvisionedNodes {
+public:
+  /**
+   * Creates the nodes of all the `devices` in one go: on error the nodes that have been created so far are removed.
+   *
+   * Each node is created under a temporary name and then renamed into place, so that it'll only show up once the
+   * owner and mode are set.
+   * Major and minor numbers are taken from sysfs: the nodes don't have to exist in our own /dev.
+   */
+  static Result<ProvisionedNodes> create(const std::vector<const VirtualDevice *> &devices,
+                                         const std::string &target_dev,
+                                         const NodePermissions &permissions = {});
+
+  ProvisionedNodes(ProvisionedNodes &&other) noexcept : target_dev(other.target_dev), permissions(other.permissions) {
+    std::swap(other.nodes, nodes);
+  }
+  ProvisionedNodes(const ProvisionedNodes &) = delete;
+  ProvisionedNodes &operator=(const ProvisionedNodes &) = delete;
+  ~ProvisionedNodes();
+
+  /**
+   * The full path of all the nodes that have been created
+   */
+  const std::vector<std::string> &get_nodes() const {
+    return nodes;
+  }
+
+  /**
+   * Brings the nodes in sync with `devices`, ex: after the absolute pointer of a Mouse has been created.
+   * Missing nodes are created and the ones that don't belong to any of the `devices` anymore are removed.
+   */
+  Result<bool> update(const std::vector<const VirtualDevice *> &devices);
+
+protected:
+  ProvisionedNodes(std::string target_dev, const NodePermissions &permissions)
+      : target_dev(std::move(target_dev)), permissions(permissions) {}
+
+  std::string target_dev;
+  NodePermissions permissions;
+  std::vector<std::string> nodes = {};
+};
+
+} // namespace inputtino
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <inputtino/input.hpp>
+#include <inputtino/result.hpp>
+#include <optional>
+#include <variant>
+#include <vector>
+
+namespace inputtino {
+
+/**
+ * Describes all the devices that should be created for a session.
+ * Devices are only created when the corresponding flag is set; when a definition is not provided the default one
+ * (see each class `create()` method) will be used.
+ */
+struct SessionSpec {
+  bool keyboard = false;
+  std::optional<DeviceDefinition> keyboard_definition = std::nullopt;
+
+  bool mouse = false;
+  std::optional<DeviceDefinition> mouse_definition = std::nullopt;
+
+  bool trackpad = false;
+  std::optional<DeviceDefinition> trackpad_definition = std::nullopt;
+
+  bool touch_screen = false;
+  std::optional<DeviceDefinition> touch_screen_definition = std::nullopt;
+
+  bool pen_tablet = false;
+  std::optional<DeviceDefinition> pen_tablet_definition = std::nullopt;
+
+  enum JOYPAD_TYPE {
+    XBOX,
+    NINTENDO,
+    PS5
+  };
+
+  struct Joypad {
+    JOYPAD_TYPE type;
+    std::optional<DeviceDefinition> definition = std::nullopt;
+  };
+
+  std::vector<Joypad> joypads = {};
+
+  /**
+   * The maximum number of devices that will be created at the same time
+   */
+  std::size_t max_parallelism = 4;
+};
+
+using AnyJoypad = std::variant<XboxOneJoypad, SwitchJoypad, PS5Joypad>;
+
+/**
+ * All the devices of a session, only the ones requested in the SessionSpec will be set.
+ * Joypads are in the same order as in `SessionSpec::joypads`
+ */
+struct Session {
+  std::optional<Keyboard> keyboard = std::nullopt;
+  std::optional<Mouse> mouse = std::nullopt;
+  std::optional<Trackpad> trackpad = std::nullopt;
+  std::optional<TouchScreen> touch_screen = std::nullopt;
+  std::optional<PenTablet> pen_tablet = std::nullopt;
+  std::vector<AnyJoypad> joypads = {};
+};
+
+/**
+ * Creates all the devices described in `spec` concurrently, on up to `spec.max_parallelism` threads;
+ * the time it takes is bound by the slowest device instead of the sum of all of them.
+ *
+ * This is all or nothing: if any device fails to be created, all the devices that have been created so far
+ * are destroyed and an Error is returned.
+ */
+Result<Session> create_session(const SessionSpec &spec);
+
+} // namespace inputtino
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <inputtino/result.hpp>
+#include <vector>
+
+namespace inputtino {
+
+/**
+ * How the threads that inputtino creates should be scheduled: joypad event listeners (rumble) and stick smoothing,
+ * keyboard key repeat, the uhid reactor, async writers (see `DeviceDefinition::async_writes`) and the workers of
+ * `create_session()`.
+ */
+struct ThreadConfig {
+  enum POLICY {
+    DEFAULT, // SCHED_OTHER, `priority` is ignored
+    FIFO,    // SCHED_FIFO
+    RR       // SCHED_RR
+  };
+
+  POLICY policy = DEFAULT;
+  /* Real time priority, between sched_get_priority_min() and sched_get_priority_max() (1-99 on Linux) */
+  int priority = 0;
+
+  /* The CPUs that the threads are allowed to run on, empty to let the scheduler choose */
+  std::vector<int> cpus = {};
+
+  /* Names threads as `inputtino-<role>`, so that they can be told apart in top, perf, ... */
+  bool set_names = true;
+};
+
+/**
+ * Only applies to the threads that will be created from now on, set it before creating any device.
+ *
+ * A real time policy requires CAP_SYS_NICE (or a big enough RLIMIT_RTPRIO): when it can't be set threads keep the
+ * default scheduling and the rest of the configuration (CPUs, names) is still applied, a warning is logged once.
+ * Returns an Error straight away if the configuration is not valid (ex: priority out of range).
+ */
+Result<bool> set_thread_config(const ThreadConfig &config);
+
+ThreadConfig get_thread_config();
+
+/**
+ * Applies the current configuration to the calling thread; called by inputtino at the start of each of its threads.
+ *
+ * @param role: a short name, at most 5 characters (Linux thread names are capped to 15), ex: "uhid"
+ */
+void apply_thread_config(const char *role);
+
+} // namespace inputtino
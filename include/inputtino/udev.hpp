@@ -0,0 +1,32 @@
+#pragma once
+
+#include <inputtino/input.hpp>
+#include <inputtino/result.hpp>
+
+namespace inputtino {
+
+/**
+ * Stands in for udevd, for containers where it isn't running: without it libinput, SDL and the like will never
+ * hear about the devices that we create.
+ *
+ * For each node of `device` (see `VirtualDevice::get_nodes()`) this will:
+ *  - write the udev database entry (/run/udev/data/c<major>:<minor>) with the ID_INPUT_* properties that udev would
+ *    have assigned, based on the capabilities published in sysfs
+ *  - broadcast an `add` uevent on the udev netlink group, in the same format that udevd uses
+ *
+ * When udevd is running (/run/udev/control is a socket) this does nothing.
+ * Note: libudev monitors only subscribe to the udev netlink group when /run/udev/control exists or when /dev is a
+ * devtmpfs. /run/udev/control is not created here: anything checking for it would believe that udevd is running.
+ *
+ * Call it once the device has been created, ex: after `wait_ready()`. Broadcasting requires CAP_NET_ADMIN.
+ */
+Result<bool> udev_announce(const VirtualDevice &device);
+
+/**
+ * The opposite of `udev_announce()`: broadcasts a `remove` uevent for each node of `device` and removes their
+ * database entries.
+ * This has to be called before destroying the device, once the nodes are gone there's nothing left to look up.
+ */
+Result<bool> udev_withdraw(const VirtualDevice &device);
+
+} // namespace inputtino
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <inputtino/input.hpp>
+#include <inputtino/udev_monitor.hpp>
+#include <poll.h>
+#include <string>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace inputtino {
+
+/**
+ * The node has to exist and, if udev is running, udev has to be done with it:
+ * libinput and SDL will only pick up devices once their properties (ID_INPUT_*) are in the udev database.
+ */
+static bool is_node_ready(const std::string &node, bool udev_running) {
+  struct stat st {};
+  if (stat(node.c_str(), &st) != 0) {
+    return false;
+  }
+  if (!udev_running) {
+    return true;
+  }
+  auto db_entry = "/run/udev/data/c" + std::to_string(major(st.st_rdev)) + ":" + std::to_string(minor(st.st_rdev));
+  return access(db_entry.c_str(), F_OK) == 0;
+}
+
+void VirtualDevice::handover() {
+  reset();
+}
+
+static bool are_nodes_ready(const std::vector<std::string> &nodes, bool udev_running) {
+  return !nodes.empty() && std::all_of(nodes.begin(), nodes.end(), [udev_running](const std::string &node) {
+    return is_node_ready(node, udev_running);
+  });
+}
+
+bool VirtualDevice::is_ready() const {
+  return are_nodes_ready(get_nodes(), is_udevd_running());
+}
+
+bool VirtualDevice::wait_ready(std::chrono::milliseconds timeout) const {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  bool udev_running = is_udevd_running();
+
+  // Watches have to be in place before checking, otherwise we might miss the event that we are waiting for
+  int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd >= 0) {
+    auto mask = IN_CREATE | IN_MOVED_TO | IN_ATTRIB;
+    inotify_add_watch(inotify_fd, "/dev/input", mask);
+    inotify_add_watch(inotify_fd, "/dev", mask); // hidraw nodes
+    if (udev_running) {
+      inotify_add_watch(inotify_fd, "/run/udev/data", mask);
+    }
+  }
+
+  bool ready = false;
+  while (true) {
+    ready = are_nodes_ready(get_nodes(), udev_running);
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    if (ready || remaining.count() <= 0) {
+      break;
+    }
+
+    if (inotify_fd >= 0) {
+      pollfd pfd{};
+      pfd.fd = inotify_fd;
+      pfd.events = POLLIN;
+      if (poll(&pfd, 1, static_cast<int>(remaining.count())) > 0) {
+        char buffer[4096];
+        while (read(inotify_fd, buffer, sizeof(buffer)) > 0) {
+          // We don't care about the content, just re-check all the nodes
+        }
+      }
+    } else { // No inotify available, fallback to polling
+      std::this_thread::sleep_for(std::min(remaining, std::chrono::milliseconds(10)));
+    }
+  }
+
+  if (inotify_fd >= 0) {
+    close(inotify_fd);
+  }
+  return ready;
+}
+
+} // namespace inputtino
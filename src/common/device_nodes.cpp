@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <inputtino/device_nodes.hpp>
+#include <linux/netlink.h>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace inputtino {
+
+struct UeventMonitor {
+  std::mutex m;
+  int fd = -1;
+  std::uint64_t generation = 0;
+
+  UeventMonitor() {
+    fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    sockaddr_nl addr{};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1; // Kernel uevents
+    if (fd >= 0 && bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+
+  ~UeventMonitor() {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+};
+
+/**
+ * Kernel uevents start with an `<action>@<devpath>` header, followed by the NUL separated properties
+ */
+static bool is_hotplug(const char *msg, std::size_t size) {
+  std::string_view header(msg, strnlen(msg, size));
+  bool add_or_remove = header.rfind("add@", 0) == 0 || header.rfind("remove@", 0) == 0;
+  return add_or_remove && (header.find("/input/") != std::string_view::npos ||
+                           header.find("/hidraw/") != std::string_view::npos);
+}
+
+std::optional<std::uint64_t> hotplug_generation() {
+  static UeventMonitor monitor;
+  std::lock_guard<std::mutex> lock(monitor.m);
+  if (monitor.fd < 0) {
+    return std::nullopt;
+  }
+
+  char buffer[8192];
+  while (true) {
+    auto ret = recv(monitor.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (ret < 0) {
+      if (errno == ENOBUFS) { // The socket overflowed: we've lost some uevents, assume that anything could've changed
+        monitor.generation++;
+        continue;
+      }
+      break; // EAGAIN, nothing more to read
+    }
+    if (is_hotplug(buffer, ret)) {
+      monitor.generation++;
+    }
+  }
+
+  if (monitor.generation == 0) {
+    return std::nullopt;
+  }
+  return monitor.generation;
+}
+
+static bool starts_with(const std::string &str, const char *prefix) {
+  return str.rfind(prefix, 0) == 0;
+}
+
+static void find_dev_nodes(const std::string &syspath, int max_depth, std::vector<std::string> &nodes) {
+  auto dir = opendir(syspath.c_str());
+  if (!dir) {
+    return;
+  }
+  while (auto entry = readdir(dir)) {
+    // Skip symlinks (subsystem, device, driver, ...) they'll point outside of this device
+    if (entry->d_type != DT_DIR || entry->d_name[0] == '.') {
+      continue;
+    }
+    std::string name = entry->d_name;
+    if (starts_with(name, "event") || starts_with(name, "js")) {
+      nodes.emplace_back("/dev/input/" + name);
+    } else if (starts_with(name, "hidraw") && name.size() > 6) { // `hidraw` is the class dir, `hidraw3` the device
+      nodes.emplace_back("/dev/" + name);
+    } else if (max_depth > 0) {
+      find_dev_nodes(syspath + "/" + name, max_depth - 1, nodes);
+    }
+  }
+  closedir(dir);
+}
+
+std::vector<std::string> find_dev_nodes(const std::string &syspath) {
+  std::vector<std::string> nodes;
+  // ex: <hid device>/input/input42/event12
+  find_dev_nodes(syspath, 3, nodes);
+  std::sort(nodes.begin(), nodes.end());
+  return nodes;
+}
+
+} // namespace inputtino
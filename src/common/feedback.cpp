@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <inputtino/feedback.hpp>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#include <tuple>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace inputtino {
+
+/**
+ * Bounded MPSC ring buffer, see: https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ * Each cell carries a sequence number that tells producers and the consumer whose turn it is to use it.
+ */
+struct FeedbackQueueState {
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    FeedbackEvent event;
+  };
+
+  explicit FeedbackQueueState(std::size_t capacity) : cells(capacity), mask(capacity - 1) {
+    for (std::size_t i = 0; i < capacity; i++) {
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~FeedbackQueueState() {
+    if (event_fd >= 0) {
+      close(event_fd);
+    }
+  }
+
+  std::vector<Cell> cells;
+  const std::size_t mask;
+
+  alignas(64) std::atomic<std::size_t> enqueue_pos = 0;
+  alignas(64) std::size_t dequeue_pos = 0; // Only touched by the consumer
+
+  /* Set by the first producer after a drain, avoids a write() on the eventfd for every single event */
+  std::atomic<bool> signalled = false;
+  std::atomic<std::size_t> dropped = 0;
+  int event_fd = -1;
+
+  bool push(const FeedbackEvent &event) {
+    auto pos = enqueue_pos.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells[pos & mask];
+      auto seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) { // The consumer hasn't caught up yet, the queue is full
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      } else {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->event = event;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    if (!signalled.exchange(true)) {
+      uint64_t one = 1;
+      (void)write(event_fd, &one, sizeof(one));
+    }
+    return true;
+  }
+
+  bool pop(FeedbackEvent &event) {
+    auto &cell = cells[dequeue_pos & mask];
+    if (cell.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+      return false; // empty
+    }
+    event = cell.event;
+    cell.sequence.store(dequeue_pos + mask + 1, std::memory_order_release);
+    dequeue_pos++;
+    return true;
+  }
+};
+
+FeedbackQueue::FeedbackQueue() : _state(nullptr) {}
+
+FeedbackQueue::~FeedbackQueue() = default;
+
+Result<FeedbackQueue> FeedbackQueue::create(std::size_t capacity) {
+  std::size_t rounded = 1;
+  while (rounded < capacity) {
+    rounded <<= 1;
+  }
+
+  int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fd < 0) {
+    return Error(strerror(errno));
+  }
+
+  FeedbackQueue queue;
+  queue._state = std::make_shared<FeedbackQueueState>(std::max<std::size_t>(rounded, 2));
+  queue._state->event_fd = fd;
+  return queue;
+}
+
+int FeedbackQueue::get_fd() const {
+  return _state->event_fd;
+}
+
+bool FeedbackQueue::push(const FeedbackEvent &event) {
+  return _state->push(event);
+}
+
+std::size_t FeedbackQueue::drain(FeedbackEvent *events, std::size_t max_events) {
+  // Consume the wakeup before clearing the flag: a producer still publishing a claimed slot will signal the fd again.
+  // (exchange() syncs with the producers that found the flag already set, their events are visible to pop())
+  uint64_t count;
+  (void)read(_state->event_fd, &count, sizeof(count));
+  _state->signalled.exchange(false);
+
+  std::size_t n = 0;
+  while (n < max_events && _state->pop(events[n])) {
+    n++;
+  }
+
+  if (n == max_events && !_state->signalled.exchange(true)) {
+    // There might be more events left, make sure that the fd stays readable
+    uint64_t one = 1;
+    (void)write(_state->event_fd, &one, sizeof(one));
+  }
+  return n;
+}
+
+std::size_t FeedbackQueue::dropped() const {
+  return _state->dropped.load(std::memory_order_relaxed);
+}
+
+std::function<void(int, int)> FeedbackQueue::rumble_callback(uint32_t device_id) const {
+  return [state = _state, device_id](int low_freq, int high_freq) {
+    FeedbackEvent event{};
+    event.device_id = device_id;
+    event.kind = FeedbackEvent::RUMBLE;
+    event.payload.rumble = {low_freq, high_freq};
+    state->push(event);
+  };
+}
+
+std::function<void(int, int, int)> FeedbackQueue::led_callback(uint32_t device_id) const {
+  return [state = _state, device_id](int r, int g, int b) {
+    FeedbackEvent event{};
+    event.device_id = device_id;
+    event.kind = FeedbackEvent::LED;
+    event.payload.led = {r, g, b};
+    state->push(event);
+  };
+}
+
+struct FeedbackDispatcherState {
+  explicit FeedbackDispatcherState(FeedbackQueue queue) : queue(std::move(queue)) {}
+
+  ~FeedbackDispatcherState() {
+    for (auto fd : {epoll_fd, inotify_fd, timer_fd}) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  }
+
+  FeedbackQueue queue;
+  int epoll_fd = -1;
+  int inotify_fd = -1; // Device nodes showing up, see VirtualDevice::wait_ready()
+  int timer_fd = -1;   // Armed to the earliest readiness deadline
+
+  struct Waiting {
+    FeedbackDispatcher::WaitId id;
+    FeedbackDispatcher::FeedbackContinuation continuation;
+  };
+
+  struct Feedback {
+    std::optional<FeedbackEvent> unclaimed = std::nullopt;
+    std::vector<Waiting> waiting = {};
+  };
+
+  /* Keyed by device_id and kind, see key() */
+  std::unordered_map<uint64_t, Feedback> feedback;
+
+  struct ReadyWait {
+    FeedbackDispatcher::WaitId id;
+    const VirtualDevice *device;
+    std::chrono::steady_clock::time_point deadline;
+    FeedbackDispatcher::ReadyContinuation continuation;
+  };
+
+  std::vector<ReadyWait> ready_waits;
+
+  /* All the continuations that haven't been called (nor cancelled) yet, with their key or READY_KEY */
+  std::unordered_map<FeedbackDispatcher::WaitId, uint64_t> pending;
+  FeedbackDispatcher::WaitId next_id = 1;
+  static constexpr uint64_t READY_KEY = UINT64_MAX;
+
+  static uint64_t key(uint32_t device_id, FeedbackEvent::KIND kind) {
+    return (static_cast<uint64_t>(device_id) << 8) | kind;
+  }
+
+  /**
+   * Fires on the earliest readiness deadline, or straight away to check the new waits
+   */
+  void arm_timer(bool now = false) {
+    itimerspec spec{}; // all zeros disarms it
+    if (!ready_waits.empty()) {
+      auto ns = std::chrono::nanoseconds(1); // 0 would disarm it
+      if (!now) {
+        auto earliest = std::min_element(ready_waits.begin(), ready_waits.end(), [](const auto &a, const auto &b) {
+                          return a.deadline < b.deadline;
+                        })->deadline;
+        auto remaining = earliest - std::chrono::steady_clock::now();
+        ns = std::max(ns, std::chrono::duration_cast<std::chrono::nanoseconds>(remaining));
+      }
+      spec.it_value.tv_sec = ns.count() / 1000000000;
+      spec.it_value.tv_nsec = ns.count() % 1000000000;
+    }
+    timerfd_settime(timer_fd, 0, &spec, nullptr);
+  }
+};
+
+FeedbackDispatcher::FeedbackDispatcher() : _state(nullptr) {}
+
+FeedbackDispatcher::~FeedbackDispatcher() = default;
+
+Result<FeedbackDispatcher> FeedbackDispatcher::create(FeedbackQueue queue) {
+  auto state = std::make_shared<FeedbackDispatcherState>(std::move(queue));
+  state->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  state->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (state->epoll_fd < 0 || state->timer_fd < 0) {
+    return Error(strerror(errno));
+  }
+
+  // Same watches as VirtualDevice::wait_ready(); without inotify we'll only wake up on the deadline
+  state->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (state->inotify_fd >= 0) {
+    auto mask = IN_CREATE | IN_MOVED_TO | IN_ATTRIB;
+    inotify_add_watch(state->inotify_fd, "/dev/input", mask);
+    inotify_add_watch(state->inotify_fd, "/dev", mask);
+    inotify_add_watch(state->inotify_fd, "/run/udev/data", mask);
+  }
+
+  for (auto fd : {state->queue.get_fd(), state->inotify_fd, state->timer_fd}) {
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (fd >= 0 && epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      return Error(strerror(errno));
+    }
+  }
+
+  FeedbackDispatcher dispatcher;
+  dispatcher._state = std::move(state);
+  return dispatcher;
+}
+
+const FeedbackQueue &FeedbackDispatcher::queue() const {
+  return _state->queue;
+}
+
+int FeedbackDispatcher::get_fd() const {
+  return _state->epoll_fd;
+}
+
+std::optional<FeedbackEvent> FeedbackDispatcher::take(uint32_t device_id, FeedbackEvent::KIND kind) {
+  auto found = _state->feedback.find(FeedbackDispatcherState::key(device_id, kind));
+  if (found == _state->feedback.end() || !found->second.unclaimed) {
+    return std::nullopt;
+  }
+  auto event = found->second.unclaimed;
+  found->second.unclaimed = std::nullopt;
+  return event;
+}
+
+FeedbackDispatcher::WaitId
+FeedbackDispatcher::on_next(uint32_t device_id, FeedbackEvent::KIND kind, FeedbackContinuation continuation) {
+  auto id = _state->next_id++;
+  auto key = FeedbackDispatcherState::key(device_id, kind);
+  _state->feedback[key].waiting.push_back({id, std::move(continuation)});
+  _state->pending[id] = key;
+  return id;
+}
+
+FeedbackDispatcher::WaitId FeedbackDispatcher::on_ready(const VirtualDevice &device,
+                                                        std::chrono::milliseconds timeout,
+                                                        ReadyContinuation continuation) {
+  auto id = _state->next_id++;
+  _state->ready_waits.push_back({id, &device, std::chrono::steady_clock::now() + timeout, std::move(continuation)});
+  _state->pending[id] = FeedbackDispatcherState::READY_KEY;
+  _state->arm_timer(true);
+  return id;
+}
+
+void FeedbackDispatcher::cancel(WaitId id) {
+  auto found = _state->pending.find(id);
+  if (found == _state->pending.end()) {
+    return;
+  }
+  auto has_id = [id](const auto &wait) { return wait.id == id; };
+  if (found->second == FeedbackDispatcherState::READY_KEY) {
+    auto &waits = _state->ready_waits;
+    waits.erase(std::remove_if(waits.begin(), waits.end(), has_id), waits.end());
+    _state->arm_timer();
+  } else {
+    // Might be missing: it's being dispatched right now, `pending` will tell that it has been cancelled
+    auto &waiting = _state->feedback[found->second].waiting;
+    waiting.erase(std::remove_if(waiting.begin(), waiting.end(), has_id), waiting.end());
+  }
+  _state->pending.erase(found);
+}
+
+void FeedbackDispatcher::dispatch() {
+  // Empty all the fds first, they are level triggered
+  bool nodes_changed = false;
+  char buffer[4096];
+  while (_state->inotify_fd >= 0 && read(_state->inotify_fd, buffer, sizeof(buffer)) > 0) {
+    nodes_changed = true;
+  }
+  uint64_t expirations;
+  bool timer_fired = read(_state->timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations);
+
+  FeedbackEvent events[64];
+  std::size_t count;
+  do {
+    count = _state->queue.drain(events, std::size(events));
+    for (std::size_t i = 0; i < count; i++) {
+      auto &feedback = _state->feedback[FeedbackDispatcherState::key(events[i].device_id, events[i].kind)];
+      if (feedback.waiting.empty()) {
+        feedback.unclaimed = events[i];
+        continue;
+      }
+      // Continuations might start waiting again straight away, they'll get the next event
+      auto waiting = std::move(feedback.waiting);
+      feedback.waiting.clear();
+      feedback.unclaimed = std::nullopt;
+      for (auto &[id, continuation] : waiting) {
+        if (_state->pending.erase(id) > 0) { // Not cancelled by one of the continuations before it
+          continuation(events[i]);
+        }
+      }
+    }
+  } while (count == std::size(events));
+
+  // Readiness only changes when nodes show up, the timer covers the deadlines and the new waits
+  if (!_state->ready_waits.empty() && (nodes_changed || timer_fired)) {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<std::tuple<WaitId, ReadyContinuation, bool>> done;
+    auto &waits = _state->ready_waits;
+    for (auto it = waits.begin(); it != waits.end();) {
+      bool ready = it->device->is_ready();
+      if (ready || now >= it->deadline) {
+        done.emplace_back(it->id, std::move(it->continuation), ready);
+        it = waits.erase(it);
+      } else {
+        it++;
+      }
+    }
+    _state->arm_timer();
+    for (auto &[id, continuation, ready] : done) { // Might start new waits, don't touch ready_waits while iterating
+      if (_state->pending.erase(id) > 0) {
+        continuation(ready);
+      }
+    }
+  }
+}
+
+} // namespace inputtino
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <inputtino/provision.hpp>
+#include <optional>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+namespace inputtino {
+
+/**
+ * Reads the device number from sysfs, ex: /dev/input/event12 -> /sys/class/input/event12/dev -> "13:76"
+ */
+static std::optional<dev_t> sysfs_devnum(const std::string &devnode) {
+  auto name = devnode.substr(devnode.find_last_of('/') + 1);
+  std::string subsystem;
+  if (devnode.rfind("/dev/input/", 0) == 0) {
+    subsystem = "input";
+  } else { // ex: hidraw3 -> hidraw
+    subsystem = name.substr(0, name.find_last_not_of("0123456789") + 1);
+  }
+
+  std::ifstream file("/sys/class/" + subsystem + "/" + name + "/dev");
+  unsigned int major_nr = 0, minor_nr = 0;
+  char separator = 0;
+  if (!(file >> major_nr >> separator >> minor_nr) || separator != ':') {
+    return std::nullopt;
+  }
+  return makedev(major_nr, minor_nr);
+}
+
+static Result<bool> create_node(const std::string &path, dev_t devnum, const NodePermissions &permissions) {
+  auto dir = path.substr(0, path.find_last_of('/'));
+  if (mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST) {
+    return Error("Unable to create " + dir + ": " + strerror(errno));
+  }
+
+  auto tmp_path = dir + "/." + path.substr(dir.size() + 1) + ".tmp";
+  unlink(tmp_path.c_str());
+  if (mknod(tmp_path.c_str(), S_IFCHR | permissions.mode, devnum) < 0) {
+    return Error("Unable to create " + path + ": " + strerror(errno));
+  }
+  // mknod() is subject to the umask, set the mode explicitly
+  if (chown(tmp_path.c_str(), permissions.uid, permissions.gid) < 0 || chmod(tmp_path.c_str(), permissions.mode) < 0 ||
+      rename(tmp_path.c_str(), path.c_str()) < 0) {
+    auto err = errno;
+    unlink(tmp_path.c_str());
+    return Error("Unable to create " + path + ": " + strerror(err));
+  }
+  return true;
+}
+
+Result<ProvisionedNodes> ProvisionedNodes::create(const std::vector<const VirtualDevice *> &devices,
+                                                  const std::string &target_dev,
+                                                  const NodePermissions &permissions) {
+  ProvisionedNodes provisioned(target_dev, permissions);
+  if (auto result = provisioned.update(devices); !result) {
+    return Error(result.getErrorMessage());
+  }
+  return provisioned;
+}
+
+Result<bool> ProvisionedNodes::update(const std::vector<const VirtualDevice *> &devices) {
+  std::vector<std::string> wanted;
+  std::vector<std::string> created;
+  auto undo = [&created]() {
+    for (const auto &node : created) {
+      unlink(node.c_str());
+    }
+  };
+
+  for (const auto device : devices) {
+    for (const auto &devnode : device->get_nodes()) {
+      auto devnum = sysfs_devnum(devnode);
+      if (devnode.rfind("/dev/", 0) != 0 || !devnum) {
+        undo();
+        return Error("Unable to find the device number of " + devnode);
+      }
+
+      auto path = target_dev + devnode.substr(std::strlen("/dev"));
+      wanted.push_back(path);
+      // Always (re)created: the device might have been replaced by a new one with the same name
+      if (auto result = create_node(path, *devnum, permissions); !result) {
+        undo();
+        return result;
+      }
+      if (std::find(nodes.begin(), nodes.end(), path) == nodes.end()) {
+        created.push_back(path);
+      }
+    }
+  }
+
+  for (const auto &node : nodes) {
+    if (std::find(wanted.begin(), wanted.end(), node) == wanted.end()) {
+      unlink(node.c_str());
+    }
+  }
+  nodes = std::move(wanted);
+  return true;
+}
+
+ProvisionedNodes::~ProvisionedNodes() {
+  for (const auto &node : nodes) {
+    unlink(node.c_str());
+  }
+}
+
+} // namespace inputtino
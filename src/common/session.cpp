@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <inputtino/session.hpp>
+#include <inputtino/threads.hpp>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace inputtino {
+
+/**
+ * Creates a device using either the given definition or the class default one,
+ * on success the device is moved into `out`.
+ * Returns an error message on failure.
+ */
+template <typename T>
+static std::optional<std::string> create_into(std::optional<T> &out,
+                                              const std::optional<DeviceDefinition> &definition) {
+  auto device = definition ? T::create(*definition) : T::create();
+  if (!device) {
+    return device.getErrorMessage();
+  }
+  out.emplace(std::move(*device));
+  return std::nullopt;
+}
+
+template <typename T>
+static std::optional<std::string> create_joypad(std::optional<AnyJoypad> &out,
+                                                const std::optional<DeviceDefinition> &definition) {
+  std::optional<T> joypad;
+  auto err = create_into(joypad, definition);
+  if (joypad) {
+    out.emplace(std::move(*joypad));
+  }
+  return err;
+}
+
+static std::optional<std::string> create_joypad(std::optional<AnyJoypad> &out, const SessionSpec::Joypad &spec) {
+  switch (spec.type) {
+  case SessionSpec::XBOX:
+    return create_joypad<XboxOneJoypad>(out, spec.definition);
+  case SessionSpec::NINTENDO:
+    return create_joypad<SwitchJoypad>(out, spec.definition);
+  case SessionSpec::PS5:
+    return create_joypad<PS5Joypad>(out, spec.definition);
+  }
+  return "Unknown joypad type";
+}
+
+Result<Session> create_session(const SessionSpec &spec) {
+  Session session;
+  std::vector<std::optional<AnyJoypad>> joypads(spec.joypads.size());
+
+  // Each job creates a single device, writing into its own slot: no need to lock the session
+  std::vector<std::function<std::optional<std::string>()>> jobs;
+  if (spec.keyboard) {
+    jobs.emplace_back([&]() { return create_into(session.keyboard, spec.keyboard_definition); });
+  }
+  if (spec.mouse) {
+    jobs.emplace_back([&]() { return create_into(session.mouse, spec.mouse_definition); });
+  }
+  if (spec.trackpad) {
+    jobs.emplace_back([&]() { return create_into(session.trackpad, spec.trackpad_definition); });
+  }
+  if (spec.touch_screen) {
+    jobs.emplace_back([&]() { return create_into(session.touch_screen, spec.touch_screen_definition); });
+  }
+  if (spec.pen_tablet) {
+    jobs.emplace_back([&]() { return create_into(session.pen_tablet, spec.pen_tablet_definition); });
+  }
+  for (std::size_t i = 0; i < spec.joypads.size(); i++) {
+    jobs.emplace_back([&, i]() { return create_joypad(joypads[i], spec.joypads[i]); });
+  }
+
+  std::atomic<std::size_t> next_job = 0;
+  std::atomic<bool> failed = false;
+  std::mutex errors_m;
+  std::string errors;
+  auto worker = [&]() {
+    std::size_t job;
+    // Once a device has failed there's no point in creating the remaining ones
+    while (!failed && (job = next_job.fetch_add(1)) < jobs.size()) {
+      if (auto err = jobs[job]()) {
+        failed = true;
+        std::lock_guard<std::mutex> lock(errors_m);
+        errors += (errors.empty() ? "" : "; ") + *err;
+      }
+    }
+  };
+
+  auto nr_threads = std::min(std::max<std::size_t>(spec.max_parallelism, 1), jobs.size());
+  std::vector<std::thread> workers;
+  for (std::size_t i = 1; i < nr_threads; i++) {
+    workers.emplace_back([&worker]() {
+      apply_thread_config("init");
+      worker();
+    });
+  }
+  worker(); // The calling thread does its share of the work too
+  for (auto &t : workers) {
+    t.join();
+  }
+
+  if (failed) {
+    // Going out of scope, `session` and `joypads` will destroy all the devices created so far
+    return Error(errors);
+  }
+
+  for (auto &joypad : joypads) {
+    session.joypads.emplace_back(std::move(*joypad));
+  }
+  return session;
+}
+
+} // namespace inputtino
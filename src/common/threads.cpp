@@ -0,0 +1,84 @@
+#include <atomic>
+#include <cstring>
+#include <inputtino/threads.hpp>
+#include <iostream>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+
+namespace inputtino {
+
+static std::mutex config_m;
+static ThreadConfig config = {};
+
+/* Warn only once: without CAP_SYS_NICE every single thread will fail in the same way */
+static std::atomic<bool> warned_policy = false;
+
+static int to_linux_policy(ThreadConfig::POLICY policy) {
+  switch (policy) {
+  case ThreadConfig::FIFO:
+    return SCHED_FIFO;
+  case ThreadConfig::RR:
+    return SCHED_RR;
+  default:
+    return SCHED_OTHER;
+  }
+}
+
+Result<bool> set_thread_config(const ThreadConfig &new_config) {
+  if (new_config.policy != ThreadConfig::DEFAULT) {
+    auto policy = to_linux_policy(new_config.policy);
+    if (new_config.priority < sched_get_priority_min(policy) || new_config.priority > sched_get_priority_max(policy)) {
+      return Error("Invalid priority " + std::to_string(new_config.priority));
+    }
+  }
+  for (auto cpu : new_config.cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      return Error("Invalid CPU " + std::to_string(cpu));
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(config_m);
+  config = new_config;
+  warned_policy = false;
+  return true;
+}
+
+ThreadConfig get_thread_config() {
+  std::lock_guard<std::mutex> lock(config_m);
+  return config;
+}
+
+void apply_thread_config(const char *role) {
+  auto current = get_thread_config();
+  auto self = pthread_self();
+
+  if (current.set_names) {
+    auto name = "inputtino-" + std::string(role);
+    pthread_setname_np(self, name.substr(0, 15).c_str());
+  }
+
+  if (!current.cpus.empty()) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (auto cpu : current.cpus) {
+      CPU_SET(cpu, &cpus);
+    }
+    if (auto err = pthread_setaffinity_np(self, sizeof(cpus), &cpus); err != 0) {
+      std::cerr << "Unable to set the CPU affinity of inputtino-" << role << ": " << strerror(err) << std::endl;
+    }
+  }
+
+  if (current.policy != ThreadConfig::DEFAULT) {
+    sched_param param{.sched_priority = current.priority};
+    auto err = pthread_setschedparam(self, to_linux_policy(current.policy), &param);
+    if (err != 0 && !warned_policy.exchange(true)) {
+      // Most likely EPERM (no CAP_SYS_NICE): the thread is left with the default policy
+      std::cerr << "Unable to set a real time scheduling policy, using the default one: " << strerror(err)
+                << std::endl;
+    }
+  }
+}
+
+} // namespace inputtino
@@ -0,0 +1,395 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <endian.h>
+#include <fstream>
+#include <inputtino/udev.hpp>
+#include <inputtino/udev_monitor.hpp>
+#include <linux/netlink.h>
+#include <optional>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace inputtino {
+
+/**
+ * Same layout as in libudev (see `struct monitor_netlink_header` in systemd's device-monitor.c):
+ * the magic and the filter hashes are in network byte order, the sizes and offsets are in host byte order.
+ */
+struct udev_monitor_netlink_header {
+  char prefix[8];        // "libudev"
+  std::uint32_t magic;   // 0xfeedcafe
+  std::uint32_t header_size;
+  std::uint32_t properties_off;
+  std::uint32_t properties_len;
+  std::uint32_t filter_subsystem_hash;
+  std::uint32_t filter_devtype_hash;
+  std::uint32_t filter_tag_bloom_hi;
+  std::uint32_t filter_tag_bloom_lo;
+};
+
+static constexpr std::uint32_t UDEV_MONITOR_MAGIC = 0xfeedcafe;
+static constexpr std::uint32_t UDEV_MONITOR_GROUP = 2; // 1 is for the kernel uevents
+
+std::uint32_t udev_murmur_hash2(std::string_view data, std::uint32_t seed) {
+  constexpr std::uint32_t m = 0x5bd1e995;
+  constexpr int r = 24;
+  auto h = seed ^ static_cast<std::uint32_t>(data.size());
+  auto bytes = reinterpret_cast<const unsigned char *>(data.data());
+  auto len = data.size();
+
+  for (; len >= 4; bytes += 4, len -= 4) {
+    std::uint32_t k;
+    std::memcpy(&k, bytes, sizeof(k));
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h *= m;
+    h ^= k;
+  }
+
+  switch (len) {
+  case 3:
+    h ^= bytes[2] << 16;
+    [[fallthrough]];
+  case 2:
+    h ^= bytes[1] << 8;
+    [[fallthrough]];
+  case 1:
+    h ^= bytes[0];
+    h *= m;
+  }
+
+  h ^= h >> 13;
+  h *= m;
+  h ^= h >> 15;
+  return h;
+}
+
+std::vector<char> udev_monitor_message(const std::vector<std::string> &properties,
+                                       const std::string &subsystem,
+                                       const std::string &devtype,
+                                       const std::vector<std::string> &tags) {
+  std::uint64_t tag_bloom = 0;
+  for (const auto &tag : tags) {
+    auto hash = udev_murmur_hash2(tag);
+    tag_bloom |= std::uint64_t{1} << (hash & 63);
+    tag_bloom |= std::uint64_t{1} << ((hash >> 6) & 63);
+    tag_bloom |= std::uint64_t{1} << ((hash >> 12) & 63);
+    tag_bloom |= std::uint64_t{1} << ((hash >> 18) & 63);
+  }
+
+  std::size_t properties_len = 0;
+  for (const auto &property : properties) {
+    properties_len += property.size() + 1;
+  }
+
+  udev_monitor_netlink_header header = {};
+  std::memcpy(header.prefix, "libudev", sizeof("libudev"));
+  header.magic = htobe32(UDEV_MONITOR_MAGIC);
+  header.header_size = sizeof(header);
+  header.properties_off = sizeof(header);
+  header.properties_len = static_cast<std::uint32_t>(properties_len);
+  header.filter_subsystem_hash = htobe32(udev_murmur_hash2(subsystem));
+  header.filter_devtype_hash = devtype.empty() ? 0 : htobe32(udev_murmur_hash2(devtype));
+  header.filter_tag_bloom_hi = htobe32(tag_bloom >> 32);
+  header.filter_tag_bloom_lo = htobe32(tag_bloom & 0xffffffff);
+
+  std::vector<char> message(reinterpret_cast<char *>(&header), reinterpret_cast<char *>(&header) + sizeof(header));
+  message.reserve(sizeof(header) + properties_len);
+  for (const auto &property : properties) {
+    message.insert(message.end(), property.c_str(), property.c_str() + property.size() + 1);
+  }
+  return message;
+}
+
+Result<bool> udev_broadcast(const std::vector<char> &message) {
+  int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+  if (fd < 0) {
+    return Error(strerror(errno));
+  }
+
+  sockaddr_nl dest{};
+  dest.nl_family = AF_NETLINK;
+  dest.nl_groups = UDEV_MONITOR_GROUP;
+  auto sent = sendto(fd, message.data(), message.size(), 0, reinterpret_cast<sockaddr *>(&dest), sizeof(dest));
+  auto err = errno;
+  close(fd);
+
+  if (sent < 0) {
+    return Error("Unable to broadcast udev event: " + std::string(strerror(err)));
+  }
+  return true;
+}
+
+/**
+ * Sysfs exposes bitmaps as a sequence of `unsigned long` in hex, the most significant one first.
+ * ex: "1000000000007 ff9f207ac14057ff febeffdfffefffff fffffffffffffffe"
+ */
+template <std::size_t BITS> static void read_sysfs_bitmap(const std::string &path, Bitmap<BITS> &bitmap) {
+  std::ifstream file(path);
+  std::vector<unsigned long> words;
+  std::string word;
+  while (file >> word) {
+    words.push_back(std::strtoul(word.c_str(), nullptr, 16));
+  }
+
+  constexpr int WORD_BITS = sizeof(unsigned long) * CHAR_BIT;
+  for (std::size_t i = 0; i < words.size(); i++) {
+    auto value = words[words.size() - 1 - i];
+    for (int bit = 0; bit < WORD_BITS; bit++) {
+      auto code = i * WORD_BITS + bit;
+      if (((value >> bit) & 1) && code < BITS) {
+        bitmap.set(static_cast<int>(code));
+      }
+    }
+  }
+}
+
+UinputTemplate read_sysfs_capabilities(const std::string &syspath) {
+  UinputTemplate capabilities;
+  read_sysfs_bitmap(syspath + "/capabilities/key", capabilities.keys);
+  read_sysfs_bitmap(syspath + "/capabilities/rel", capabilities.rels);
+  read_sysfs_bitmap(syspath + "/capabilities/abs", capabilities.abs);
+  read_sysfs_bitmap(syspath + "/capabilities/msc", capabilities.msc);
+  read_sysfs_bitmap(syspath + "/capabilities/ff", capabilities.ff);
+  read_sysfs_bitmap(syspath + "/properties", capabilities.props);
+  return capabilities;
+}
+
+/**
+ * A simplified version of udev's `input_id` builtin, see: systemd/src/udev/udev-builtin-input_id.c
+ */
+std::vector<std::string> udev_input_properties(const UinputTemplate &capabilities) {
+  const auto &keys = capabilities.keys;
+  const auto &abs = capabilities.abs;
+
+  auto any_key = [&keys](int from, int to) {
+    for (int code = from; code < to; code++) {
+      if (keys.test(code)) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  bool has_abs_coordinates = abs.test(ABS_X) && abs.test(ABS_Y);
+  bool has_mt_coordinates = abs.test(ABS_MT_POSITION_X) && abs.test(ABS_MT_POSITION_Y);
+  bool has_rel_coordinates = capabilities.rels.test(REL_X) && capabilities.rels.test(REL_Y);
+  bool is_direct = capabilities.props.test(INPUT_PROP_DIRECT);
+  bool has_mouse_button = keys.test(BTN_LEFT);
+  bool has_stylus = keys.test(BTN_STYLUS) || keys.test(BTN_TOOL_PEN);
+  bool has_finger_but_no_pen = keys.test(BTN_TOOL_FINGER) && !keys.test(BTN_TOOL_PEN);
+  bool has_joystick_buttons = any_key(BTN_JOYSTICK, BTN_DIGI) || any_key(BTN_TRIGGER_HAPPY, BTN_TRIGGER_HAPPY40 + 1);
+  bool has_joystick_axes = abs.test(ABS_RX) || abs.test(ABS_RY) || abs.test(ABS_RZ) || abs.test(ABS_THROTTLE) ||
+                           abs.test(ABS_RUDDER) || abs.test(ABS_WHEEL) || abs.test(ABS_GAS) || abs.test(ABS_BRAKE) ||
+                           abs.test(ABS_HAT0X);
+
+  std::vector<std::string> properties = {"ID_INPUT=1"};
+  if (capabilities.props.test(INPUT_PROP_ACCELEROMETER)) {
+    properties.emplace_back("ID_INPUT_ACCELEROMETER=1");
+    return properties;
+  }
+
+  if (has_abs_coordinates || has_mt_coordinates) {
+    if (has_stylus) {
+      properties.emplace_back("ID_INPUT_TABLET=1");
+    } else if (has_finger_but_no_pen && !is_direct) {
+      properties.emplace_back("ID_INPUT_TOUCHPAD=1");
+    } else if (has_mouse_button) {
+      properties.emplace_back("ID_INPUT_MOUSE=1");
+    } else if (keys.test(BTN_TOUCH) || is_direct) {
+      properties.emplace_back("ID_INPUT_TOUCHSCREEN=1");
+    } else if (has_joystick_buttons || has_joystick_axes) {
+      properties.emplace_back("ID_INPUT_JOYSTICK=1");
+    }
+  } else if (has_joystick_buttons && has_joystick_axes) {
+    properties.emplace_back("ID_INPUT_JOYSTICK=1");
+  }
+
+  bool is_mouse = std::find(properties.begin(), properties.end(), "ID_INPUT_MOUSE=1") != properties.end();
+  if (has_rel_coordinates && has_mouse_button && !is_mouse) {
+    properties.emplace_back("ID_INPUT_MOUSE=1");
+  }
+
+  // Keys (KEY_ESC..KEY_MISC) and multimedia keys (KEY_OK..KEY_MAX)
+  if (any_key(KEY_ESC, BTN_MISC) || any_key(KEY_OK, BTN_DPAD_UP) || any_key(KEY_ALS_TOGGLE, BTN_TRIGGER_HAPPY)) {
+    properties.emplace_back("ID_INPUT_KEY=1");
+  }
+  // A full keyboard, with at least all the keys from KEY_ESC to KEY_D
+  bool is_keyboard = true;
+  for (int code = KEY_ESC; code <= KEY_D; code++) {
+    is_keyboard &= keys.test(code);
+  }
+  if (is_keyboard) {
+    properties.emplace_back("ID_INPUT_KEYBOARD=1");
+  }
+
+  return properties;
+}
+
+static std::string basename_of(const std::string &path) {
+  return path.substr(path.find_last_of('/') + 1);
+}
+
+static std::string dirname_of(const std::string &path) {
+  return path.substr(0, path.find_last_of('/'));
+}
+
+/**
+ * Everything that udevd would know about a device node
+ */
+struct UdevNode {
+  std::string devnode;   // ex: /dev/input/event12
+  std::string syspath;   // ex: /sys/devices/virtual/input/input42/event12
+  std::string subsystem; // ex: input
+  unsigned int major;
+  unsigned int minor;
+};
+
+static std::optional<UdevNode> lookup_node(const std::string &devnode) {
+  struct stat st {};
+  if (stat(devnode.c_str(), &st) != 0 || !S_ISCHR(st.st_mode)) {
+    return std::nullopt;
+  }
+
+  UdevNode node{};
+  node.devnode = devnode;
+  node.major = major(st.st_rdev);
+  node.minor = minor(st.st_rdev);
+  char path[PATH_MAX];
+  auto dev_link = "/sys/dev/char/" + std::to_string(node.major) + ":" + std::to_string(node.minor);
+  if (!realpath(dev_link.c_str(), path)) {
+    return std::nullopt;
+  }
+  node.syspath = path;
+  if (!realpath((node.syspath + "/subsystem").c_str(), path)) {
+    return std::nullopt;
+  }
+  node.subsystem = basename_of(path);
+  return node;
+}
+
+static std::string db_entry_path(const UdevNode &node) {
+  return "/run/udev/data/c" + std::to_string(node.major) + ":" + std::to_string(node.minor);
+}
+
+/**
+ * Same format as udevd, see: systemd/src/libsystemd/sd-device/device-private.c
+ * Written to a temporary file first: readers should never see a partial entry.
+ */
+static Result<bool> write_db_entry(const UdevNode &node,
+                                   const std::vector<std::string> &id_properties,
+                                   const std::vector<std::string> &tags,
+                                   std::uint64_t usec) {
+  auto path = db_entry_path(node);
+  auto tmp_path = path + ".tmp";
+  {
+    std::ofstream db(tmp_path, std::ios::trunc);
+    db << "I:" << usec << "\n";
+    for (const auto &property : id_properties) {
+      db << "E:" << property << "\n";
+    }
+    for (const auto &tag : tags) {
+      db << "G:" << tag << "\n";
+      db << "Q:" << tag << "\n";
+    }
+    db << "V:1\n";
+    if (!db) {
+      return Error("Unable to write " + tmp_path);
+    }
+  }
+  if (rename(tmp_path.c_str(), path.c_str()) < 0) {
+    return Error("Unable to write " + path + ": " + strerror(errno));
+  }
+  return true;
+}
+
+static Result<bool> remove_db_entry(const UdevNode &node) {
+  unlink(db_entry_path(node).c_str());
+  return true;
+}
+
+static std::uint64_t now_usec() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<std::uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Sends an `action` uevent for each node of `device`, `on_node` is called for each of them before broadcasting
+ */
+template <typename Fn> static Result<bool> udev_send(const VirtualDevice &device, const char *action, Fn &&on_node) {
+  static std::atomic<std::uint64_t> seqnum = 1;
+
+  for (const auto &devnode : device.get_nodes()) {
+    auto node = lookup_node(devnode);
+    if (!node) {
+      continue;
+    }
+
+    std::vector<std::string> tags = {"uaccess"};
+    std::vector<std::string> id_properties;
+    if (node->subsystem == "input") { // The capabilities are in the parent, ex: input42/event12
+      tags.emplace_back("seat");
+      id_properties = udev_input_properties(read_sysfs_capabilities(dirname_of(node->syspath)));
+    }
+
+    auto usec = now_usec();
+    if (auto result = on_node(*node, id_properties, tags, usec); !result) {
+      return result;
+    }
+
+    std::string tag_list = ":";
+    for (const auto &tag : tags) {
+      tag_list += tag + ":";
+    }
+    std::vector<std::string> properties = {"ACTION=" + std::string(action),
+                                           "DEVPATH=" + node->syspath.substr(std::strlen("/sys")),
+                                           "SUBSYSTEM=" + node->subsystem,
+                                           "DEVNAME=" + node->devnode,
+                                           "MAJOR=" + std::to_string(node->major),
+                                           "MINOR=" + std::to_string(node->minor),
+                                           "SEQNUM=" + std::to_string(seqnum++),
+                                           "USEC_INITIALIZED=" + std::to_string(usec),
+                                           "TAGS=" + tag_list,
+                                           "CURRENT_TAGS=" + tag_list};
+    properties.insert(properties.end(), id_properties.begin(), id_properties.end());
+
+    if (auto result = udev_broadcast(udev_monitor_message(properties, node->subsystem, "", tags)); !result) {
+      return result;
+    }
+  }
+  return true;
+}
+
+bool is_udevd_running() {
+  struct stat st {};
+  return stat("/run/udev/control", &st) == 0 && S_ISSOCK(st.st_mode);
+}
+
+Result<bool> udev_announce(const VirtualDevice &device) {
+  if (is_udevd_running()) {
+    return true;
+  }
+
+  mkdir("/run/udev", 0755);
+  mkdir("/run/udev/data", 0755);
+  return udev_send(device, "add", write_db_entry);
+}
+
+Result<bool> udev_withdraw(const VirtualDevice &device) {
+  if (is_udevd_running()) {
+    return true;
+  }
+
+  return udev_send(device, "remove", [](const UdevNode &node, auto &&...) { return remove_db_entry(node); });
+}
+
+} // namespace inputtino
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <inputtino/input.hpp>
+#include <linux/input-event-codes.h>
+#include <memory>
+
+namespace uhid {
+
+class Device;
+
+/**
+ * Usages 0x00 - 0xE7 of the Keyboard/Keypad page (0x07), modifiers (0xE0 - 0xE7) included
+ */
+static constexpr int NKRO_USAGE_MAX = 0xE7;
+static constexpr int NKRO_REPORT_SIZE = (NKRO_USAGE_MAX + 1) / 8;
+
+/**
+ * An N-Key Rollover keyboard: instead of the usual 6 keys array we report one bit per usage, this way any number
+ * of keys can be held at the same time and the full state of the keyboard fits in a single report.
+ * The kernel `hid-input` driver will take care of generating the EV_KEY events (and autorepeat) for us.
+ *
+ * Verified manually using hid-decode
+ */
+static constexpr unsigned char nkro_keyboard_rdesc[] = {
+    0x05, 0x01,       // Usage Page (Generic Desktop Ctrls)
+    0x09, 0x06,       // Usage (Keyboard)
+    0xA1, 0x01,       // Collection (Application)
+    0x05, 0x07,       //   Usage Page (Kbrd/Keypad)
+    0x19, 0x00,       //   Usage Minimum (0x00)
+    0x29, 0xE7,       //   Usage Maximum (0xE7)
+    0x15, 0x00,       //   Logical Minimum (0)
+    0x25, 0x01,       //   Logical Maximum (1)
+    0x75, 0x01,       //   Report Size (1)
+    0x96, 0xE8, 0x00, //   Report Count (232)
+    0x81, 0x02,       //   Input (Data,Var,Abs,No Wrap,Linear,Preferred State,No Null Position)
+    0x05, 0x08,       //   Usage Page (LEDs)
+    0x19, 0x01,       //   Usage Minimum (Num Lock)
+    0x29, 0x05,       //   Usage Maximum (Kana)
+    0x95, 0x05,       //   Report Count (5)
+    0x75, 0x01,       //   Report Size (1)
+    0x91, 0x02,       //   Output (Data,Var,Abs,No Wrap,Linear,Preferred State,No Null Position,Non-volatile)
+    0x95, 0x01,       //   Report Count (1)
+    0x75, 0x03,       //   Report Size (3)
+    0x91, 0x01,       //   Output (Const,Array,Abs,No Wrap,Linear,Preferred State,No Null Position,Non-volatile)
+    0xC0,             // End Collection
+};
+
+/**
+ * Bit N of the report is set when the key with HID usage N is pressed
+ */
+struct nkro_keyboard_report {
+  uint8_t keys[NKRO_REPORT_SIZE] = {};
+};
+
+/**
+ * Maps a Linux KEY_* code to the corresponding HID usage in the Keyboard/Keypad page.
+ * This is the inverse of `hid_keyboard[]` in drivers/hid/hid-input.c, limited to the keys that we can receive.
+ *
+ * Returns 0 (Reserved) when the key can't be represented: KEY_CLEAR, KEY_PRINT, KEY_SELECT and KEY_SLEEP are only
+ * reachable through the Consumer and Generic Desktop pages, which this keyboard doesn't report.
+ */
+static constexpr uint8_t linux_to_hid_usage(int linux_code) {
+  if (linux_code >= KEY_1 && linux_code <= KEY_9) {
+    return 0x1E + (linux_code - KEY_1);
+  }
+  if (linux_code >= KEY_F1 && linux_code <= KEY_F10) {
+    return 0x3A + (linux_code - KEY_F1);
+  }
+  if (linux_code >= KEY_KP1 && linux_code <= KEY_KP3) {
+    return 0x59 + (linux_code - KEY_KP1);
+  }
+  if (linux_code >= KEY_KP4 && linux_code <= KEY_KP6) {
+    return 0x5C + (linux_code - KEY_KP4);
+  }
+  if (linux_code >= KEY_KP7 && linux_code <= KEY_KP9) {
+    return 0x5F + (linux_code - KEY_KP7);
+  }
+
+  switch (linux_code) {
+  // clang-format off
+  case KEY_A: return 0x04;          case KEY_B: return 0x05;          case KEY_C: return 0x06;
+  case KEY_D: return 0x07;          case KEY_E: return 0x08;          case KEY_F: return 0x09;
+  case KEY_G: return 0x0A;          case KEY_H: return 0x0B;          case KEY_I: return 0x0C;
+  case KEY_J: return 0x0D;          case KEY_K: return 0x0E;          case KEY_L: return 0x0F;
+  case KEY_M: return 0x10;          case KEY_N: return 0x11;          case KEY_O: return 0x12;
+  case KEY_P: return 0x13;          case KEY_Q: return 0x14;          case KEY_R: return 0x15;
+  case KEY_S: return 0x16;          case KEY_T: return 0x17;          case KEY_U: return 0x18;
+  case KEY_V: return 0x19;          case KEY_W: return 0x1A;          case KEY_X: return 0x1B;
+  case KEY_Y: return 0x1C;          case KEY_Z: return 0x1D;          case KEY_0: return 0x27;
+  case KEY_ENTER: return 0x28;      case KEY_ESC: return 0x29;        case KEY_BACKSPACE: return 0x2A;
+  case KEY_TAB: return 0x2B;        case KEY_SPACE: return 0x2C;      case KEY_MINUS: return 0x2D;
+  case KEY_EQUAL: return 0x2E;      case KEY_LEFTBRACE: return 0x2F;  case KEY_RIGHTBRACE: return 0x30;
+  case KEY_BACKSLASH: return 0x31;  case KEY_SEMICOLON: return 0x33;  case KEY_APOSTROPHE: return 0x34;
+  case KEY_GRAVE: return 0x35;      case KEY_COMMA: return 0x36;      case KEY_DOT: return 0x37;
+  case KEY_SLASH: return 0x38;      case KEY_CAPSLOCK: return 0x39;   case KEY_F11: return 0x44;
+  case KEY_F12: return 0x45;        case KEY_SYSRQ: return 0x46;      case KEY_SCROLLLOCK: return 0x47;
+  case KEY_PAUSE: return 0x48;      case KEY_INSERT: return 0x49;     case KEY_HOME: return 0x4A;
+  case KEY_PAGEUP: return 0x4B;     case KEY_DELETE: return 0x4C;     case KEY_END: return 0x4D;
+  case KEY_PAGEDOWN: return 0x4E;   case KEY_RIGHT: return 0x4F;      case KEY_LEFT: return 0x50;
+  case KEY_DOWN: return 0x51;       case KEY_UP: return 0x52;         case KEY_NUMLOCK: return 0x53;
+  case KEY_KPSLASH: return 0x54;    case KEY_KPASTERISK: return 0x55; case KEY_KPMINUS: return 0x56;
+  case KEY_KPPLUS: return 0x57;     case KEY_KPENTER: return 0x58;    case KEY_KP0: return 0x62;
+  case KEY_KPDOT: return 0x63;      case KEY_102ND: return 0x64;      case KEY_HELP: return 0x75;
+  case KEY_KPCOMMA: return 0x85;    case KEY_KATAKANAHIRAGANA: return 0x88;
+  case KEY_HANGEUL: return 0x90;    case KEY_HANJA: return 0x91;      case KEY_KATAKANA: return 0x92;
+  case KEY_LEFTCTRL: return 0xE0;   case KEY_LEFTSHIFT: return 0xE1;  case KEY_LEFTALT: return 0xE2;
+  case KEY_LEFTMETA: return 0xE3;   case KEY_RIGHTCTRL: return 0xE4;  case KEY_RIGHTSHIFT: return 0xE5;
+  case KEY_RIGHTALT: return 0xE6;   case KEY_RIGHTMETA: return 0xE7;
+  // clang-format on
+  default:
+    return 0;
+  }
+}
+
+} // namespace uhid
+
+namespace inputtino {
+
+struct KeyboardState;
+
+Result<std::shared_ptr<uhid::Device>> create_nkro_keyboard(const DeviceDefinition &device);
+
+/**
+ * Updates the key bitmap and sends the full state to the kernel in a single report
+ */
+void nkro_set_key(KeyboardState &state, int linux_code, bool pressed);
+
+/**
+ * Releases all the currently pressed keys with a single report
+ */
+void nkro_release_all(KeyboardState &state);
+
+} // namespace inputtino
@@ -1,17 +1,35 @@
 #pragma once
+#include <condition_variable>
 #include <functional>
+#include <inputtino/conditioning.hpp>
+#include <inputtino/input.hpp>
+#include <inputtino/seqlock.hpp>
+#include <inputtino/serial_writer.hpp>
+#include <mutex>
 #include <optional>
 #include <uhid/ps5.hpp>
 #include <uhid/uhid.hpp>
 
 namespace inputtino {
 struct PS5JoypadState {
+  /* All the changes to the joypad go through here, see VirtualDevice */
+  SerialWriter writer;
   std::shared_ptr<uhid::Device> dev;
 
+  /* Only touched by the writer, readers should use `snapshot` */
   uhid::dualsense_input_report_usb current_state;
+  SeqLock<Joypad::Snapshot> snapshot;
+  JoypadConditioning conditioning;
   uint8_t touch_points_ids[2] = {0};
 
+  /* Callbacks are called from the uhid thread, they can be swapped at any time (see handover()) */
+  std::mutex callbacks_m;
   std::optional<std::function<void(int, int)>> on_rumble = std::nullopt;
   std::optional<std::function<void(int, int, int)>> on_led = std::nullopt;
+
+  /* Set once the HID driver has bound to the device, see PS5Joypad::wait_ready() */
+  std::mutex started_m;
+  std::condition_variable started_cv;
+  bool started = false;
 };
 } // namespace inputtino
\ No newline at end of file
@@ -1,12 +1,16 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <errno.h>
 #include <fcntl.h>
 #include <functional>
+#include <inputtino/device_nodes.hpp>
 #include <inputtino/result.hpp>
 #include <linux/uhid.h>
+#include <map>
 #include <memory>
-#include <poll.h>
+#include <mutex>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,12 +22,6 @@
 #include <vector>
 
 namespace uhid {
-struct ThreadState {
-  int fd;
-  std::function<void(const uhid_event &ev, int fd)> on_event;
-  bool stop_repeat_thread = false;
-};
-
 struct DeviceDefinition {
   std::string name;
   std::string phys;
@@ -36,6 +34,17 @@ struct DeviceDefinition {
   std::vector<unsigned char> report_description;
 };
 
+struct DeviceState {
+  int fd;
+  std::function<void(const uhid_event &ev, int fd)> on_event;
+  /* Set by the reactor when the kernel hangs up, no more events will be read or sent */
+  std::atomic<bool> dead = false;
+
+  /* Used to find the HID device that the kernel has created for us (its phys is unique), see Device::get_nodes() */
+  DeviceDefinition definition;
+  inputtino::NodeCache nodes;
+};
+
 static inputtino::Result<bool> uhid_write(int fd, const struct uhid_event *ev) {
   ssize_t ret = write(fd, ev, sizeof(*ev));
   if (ret < 0) {
@@ -47,121 +56,94 @@ static inputtino::Result<bool> uhid_write(int fd, const struct uhid_event *ev) {
   }
 }
 
+/**
+ * All the uhid devices are served by a single thread that waits on an epoll instance,
+ * events are dispatched to the `on_event` of the corresponding device using a registry keyed by fd.
+ *
+ * The thread is started when the first device is added and it's stopped (via an eventfd) once the last one is removed.
+ * When the kernel hangs up on a device (EPOLLHUP/EPOLLERR or EOF) it's removed and marked as `dead`.
+ */
+class Reactor {
+public:
+  static Reactor &get();
+
+  inputtino::Result<bool> add(const std::shared_ptr<DeviceState> &device);
+
+  /**
+   * Once this returns, `on_event` for this device will not be called anymore
+   * (unless we are being called from inside `on_event` itself)
+   */
+  void remove(int fd);
+
+  ~Reactor();
+
+private:
+  Reactor() = default;
+  void run();
+  void stop(std::unique_lock<std::mutex> &lock);
+  void close_fds();
+
+  std::mutex mutex;
+  std::condition_variable lifecycle;
+  std::map<int /* fd */, std::shared_ptr<DeviceState>> devices;
+  int epoll_fd = -1;
+  int stop_fd = -1;
+  int dispatching_fd = -1;
+  bool stopping = false;
+  std::thread thread;
+};
+
 class Device {
 private:
-  Device(std::shared_ptr<std::thread> ev_thread, std::shared_ptr<ThreadState> state)
-      : ev_thread(std::move(ev_thread)), state(std::move(state)){};
-  std::shared_ptr<std::thread> ev_thread;
-  std::shared_ptr<ThreadState> state;
-  std::shared_ptr<std::function<void(const uhid_event &ev, int fd)>> on_event;
+  explicit Device(std::shared_ptr<DeviceState> state) : state(std::move(state)){};
+  std::shared_ptr<DeviceState> state;
 
 public:
+  /**
+   * The device phys will be `definition.phys` followed by a unique suffix (ex: `/inputtino-1a2b3c4d-0`),
+   * this way we can always tell our HID device apart from the others.
+   */
   static inputtino::Result<Device> create(const DeviceDefinition &definition,
                                           const std::function<void(const uhid_event &ev, int fd)> &on_event);
 
-  Device(Device &&j) noexcept : ev_thread(nullptr), state(nullptr), on_event(nullptr) {
-    std::swap(j.ev_thread, ev_thread);
+  Device(Device &&j) noexcept : state(nullptr) {
     std::swap(j.state, state);
-    std::swap(j.on_event, on_event);
   }
 
   Device(Device const &) = delete;
   Device &operator=(Device const &) = delete;
 
   inline inputtino::Result<bool> send(const uhid_event &ev) {
+    if (state->dead) {
+      return inputtino::Error("The uhid device has been hung up");
+    }
     return uhid_write(state->fd, &ev);
   }
 
-  inline void stop_thread() {
-    state->stop_repeat_thread = true;
-    if (ev_thread->joinable()) {
-      ev_thread->join(); // let's wait for the thread to finish
-    }
+  /**
+   * The device nodes created by the HID driver bound to this device (ex: /dev/hidraw*, /dev/input/event*),
+   * discovered once and cached until the next hotplug.
+   */
+  std::vector<std::string> get_nodes() const;
+
+  /**
+   * Stop receiving events from the kernel, the device will still be alive until destroyed
+   */
+  inline void stop_events() {
+    Reactor::get().remove(state->fd);
   }
 
   ~Device() {
     if (state) {
+      Reactor::get().remove(state->fd);
+
       struct uhid_event ev {};
       ev.type = UHID_DESTROY;
       uhid_write(state->fd, &ev);
 
-      close(state->fd); // This should also close the thread by causing a POLLHUP
-
-      state->stop_repeat_thread = true;
-      if (ev_thread->joinable()) {
-        ev_thread->join(); // let's wait for the thread to finish
-      }
+      close(state->fd);
     }
   }
 };
 
-static void set_c_str(const std::string &str, unsigned char *c_str) {
-  std::copy(str.begin(), str.end(), c_str);
-  c_str[str.length()] = 0;
-}
-
-inputtino::Result<Device> Device::create(const DeviceDefinition &definition,
-                                         const std::function<void(const uhid_event &ev, int fd)> &on_event) {
-
-  int fd = open("/dev/uhid", O_RDWR | O_CLOEXEC);
-  if (fd < 0) {
-    return inputtino::Error(strerror(errno));
-  }
-
-  auto ev = uhid_event{};
-  ev.type = UHID_CREATE2, ev.u.create2.bus = definition.bus, ev.u.create2.vendor = definition.vendor,
-  ev.u.create2.product = definition.product, ev.u.create2.version = definition.version,
-  ev.u.create2.country = definition.country,
-  ev.u.create2.rd_size = static_cast<__u16>(definition.report_description.size()),
-  std::copy(definition.report_description.begin(), definition.report_description.end(), ev.u.create2.rd_data);
-  set_c_str(definition.name, ev.u.create2.name);
-  set_c_str(definition.phys, ev.u.create2.phys);
-  set_c_str(definition.uniq, ev.u.create2.uniq);
-
-  auto res = uhid_write(fd, &ev);
-  if (res) {
-    auto state = std::make_shared<ThreadState>();
-    state->fd = fd;
-    state->on_event = on_event;
-    auto thread = std::make_shared<std::thread>([state]() {
-      ssize_t ret;
-      struct pollfd pfds[1];
-      pfds[0].fd = state->fd;
-      pfds[0].events = POLLIN;
-
-      while (!state->stop_repeat_thread) {
-        ret = poll(pfds, 1, -1);
-        if (ret < 0) {
-          fprintf(stderr, "Cannot poll for fds: %m\n");
-          break;
-        }
-        if (pfds[0].revents & POLLHUP) {
-          fprintf(stderr, "Received HUP on uhid-cdev\n");
-          break;
-        }
-        if (pfds[0].revents & POLLIN) {
-          struct uhid_event ev {};
-          ret = read(state->fd, &ev, sizeof(ev));
-          if (ret == 0) {
-            fprintf(stderr, "Read HUP on uhid-cdev\n");
-          } else if (ret < 0) {
-            fprintf(stderr, "Cannot read uhid-cdev: %m\n");
-          } else if (ret != sizeof(ev)) {
-            fprintf(stderr, "Invalid size read from uhid-dev: %zd != %zu\n", ret, sizeof(ev));
-          } else {
-            if (state->on_event) {
-              state->on_event(ev, state->fd);
-            }
-          }
-        }
-      }
-    });
-    thread->detach();
-    return inputtino::Result<Device>({std::move(thread), std::move(state)});
-  } else {
-    close(fd);
-    return inputtino::Error(res.getErrorMessage());
-  }
-}
-
 } // namespace uhid
\ No newline at end of file
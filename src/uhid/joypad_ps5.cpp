@@ -1,12 +1,35 @@
+#include <algorithm>
 #include <cmath>
 #include <endian.h>
+#include <inputtino/axis.hpp>
 #include <inputtino/input.hpp>
+#include <inputtino/joypad_buttons.hpp>
 #include <uhid/protected_types.hpp>
 #include <uhid/ps5.hpp>
 #include <uhid/uhid.hpp>
 
 namespace inputtino {
 
+/**
+ * The position of each button in the 32 bits of `dualsense_input_report_usb::buttons` (little endian),
+ * the lowest 4 bits are the HAT switch. TODO: L2/R2 ??
+ */
+static constexpr ButtonTable ps5_buttons = make_button_table(std::array<ButtonMapping, 13>{{
+    {Joypad::X, 4},              // SQUARE
+    {Joypad::A, 5},              // CROSS
+    {Joypad::B, 6},              // CIRCLE
+    {Joypad::Y, 7},              // TRIANGLE
+    {Joypad::LEFT_BUTTON, 8},    // L1
+    {Joypad::RIGHT_BUTTON, 9},   // R1
+    {Joypad::BACK, 12},          // CREATE
+    {Joypad::START, 13},         // OPTIONS
+    {Joypad::LEFT_STICK, 14},    // L3
+    {Joypad::RIGHT_STICK, 15},   // R3
+    {Joypad::HOME, 16},          // PS_HOME
+    {Joypad::TOUCHPAD_FLAG, 17}, // TOUCHPAD
+    {Joypad::MISC_FLAG, 18},     // MIC_MUTE
+}});
+
 static void send_report(PS5JoypadState &state) {
   { // setup timestamp and increase seq_number
     state.current_state.seq_number++;
@@ -32,8 +55,64 @@ static void send_report(PS5JoypadState &state) {
   state.dev->send(ev);
 }
 
+/**
+ * Conditions and sends a stick position, only called by the writer
+ */
+static void write_stick(PS5JoypadState &state, Joypad::STICK_POSITION stick_type, short raw_x, short raw_y) {
+  auto [x, y] = state.conditioning.stick(stick_type, raw_x, raw_y);
+  switch (stick_type) {
+  case Joypad::RS: {
+    state.current_state.rx = stick_to_ps5(x);
+    state.current_state.ry = stick_to_ps5(y);
+    send_report(state);
+    break;
+  }
+  case Joypad::LS: {
+    state.current_state.x = stick_to_ps5(x);
+    state.current_state.y = stick_to_ps5(y);
+    send_report(state);
+    break;
+  }
+  }
+  state.snapshot.write([stick_type, x = x, y = y](Joypad::Snapshot &snapshot) {
+    (stick_type == Joypad::LS ? snapshot.ls_x : snapshot.rs_x) = x;
+    (stick_type == Joypad::LS ? snapshot.ls_y : snapshot.rs_y) = y;
+  });
+}
+
+/**
+ * Moves the smoothed sticks one more step towards their last position, see JoypadConditioning::on_settle()
+ */
+static void settle_sticks(PS5JoypadState &state) {
+  state.writer.run([state = &state]() {
+    for (auto stick_type : {Joypad::LS, Joypad::RS}) {
+      if (state->conditioning.settling(stick_type)) {
+        auto [x, y] = state->conditioning.last_stick(stick_type);
+        write_stick(*state, stick_type, x, y);
+      }
+    }
+  });
+}
+
+/**
+ * Callbacks are copied while holding `callbacks_m` and called after releasing it: they are free to call back into the
+ * joypad, even to swap the callbacks or to hand it over.
+ */
+template <typename Callback> static Callback get_callback(PS5JoypadState &state, const Callback &callback) {
+  std::lock_guard<std::mutex> lock(state.callbacks_m);
+  return callback;
+}
+
 static void on_uhid_event(std::shared_ptr<PS5JoypadState> state, uhid_event ev, int fd) {
   switch (ev.type) {
+  case UHID_START: {
+    {
+      std::lock_guard<std::mutex> lock(state->started_m);
+      state->started = true;
+    }
+    state->started_cv.notify_all();
+    break;
+  }
   case UHID_GET_REPORT: {
     uhid_event answer{};
     answer.type = UHID_GET_REPORT_REPLY;
@@ -80,8 +159,8 @@ static void on_uhid_event(std::shared_ptr<PS5JoypadState> state, uhid_event ev,
     if (report->valid_flag0 & uhid::MOTOR_OR_COMPATIBLE_VIBRATION || report->valid_flag2 & uhid::COMPATIBLE_VIBRATION) {
       auto left = (report->motor_left / 255.0f) * 0xFFFF;
       auto right = (report->motor_right / 255.0f) * 0xFFFF;
-      if (state->on_rumble) {
-        (*state->on_rumble)(left, right);
+      if (auto on_rumble = get_callback(*state, state->on_rumble)) {
+        (*on_rumble)(left, right);
       }
     }
 
@@ -89,9 +168,9 @@ static void on_uhid_event(std::shared_ptr<PS5JoypadState> state, uhid_event ev,
      * LED
      */
     if (report->valid_flag1 & uhid::LIGHTBAR_ENABLE) {
-      if (state->on_led) {
+      if (auto on_led = get_callback(*state, state->on_led)) {
         // TODO: should we blend brightness?
-        (*state->on_led)(report->lightbar_red, report->lightbar_green, report->lightbar_blue);
+        (*on_led)(report->lightbar_red, report->lightbar_green, report->lightbar_blue);
       }
     }
   }
@@ -104,7 +183,9 @@ PS5Joypad::PS5Joypad() : _state(std::make_shared<PS5JoypadState>()) {}
 
 PS5Joypad::~PS5Joypad() {
   if (this->_state && this->_state->dev) {
-    this->_state->dev->stop_thread();
+    this->_state->conditioning.stop_settling();
+    this->_state->writer.flush();
+    this->_state->dev->stop_events();
     this->_state->dev.reset(); // Will trigger ~Device and ultimately destroy the device
   }
 }
@@ -122,190 +203,271 @@ Result<PS5Joypad> PS5Joypad::create(const DeviceDefinition &device) {
       .report_description = {&uhid::ps5_rdesc[0], &uhid::ps5_rdesc[0] + sizeof(uhid::ps5_rdesc)}};
 
   auto joypad = PS5Joypad();
+  joypad._state->conditioning.on_settle([state = joypad._state.get()]() { settle_sticks(*state); });
   auto dev =
       uhid::Device::create(def, [state = joypad._state](uhid_event ev, int fd) { on_uhid_event(state, ev, fd); });
   if (dev) {
     joypad._state->dev = std::make_shared<uhid::Device>(std::move(*dev));
+    if (device.async_writes) {
+      joypad._state->writer.start_thread(device.writer_cpu);
+    }
     return joypad;
   }
   return Error(dev.getErrorMessage());
 }
 
-static int scale_value(int input, int input_start, int input_end, int output_start, int output_end) {
-  auto slope = 1.0 * (output_end - output_start) / (input_end - input_start);
-  return output_start + std::round(slope * (input - input_start));
-}
-
 std::vector<std::string> PS5Joypad::get_nodes() const {
-  // TODO
-  return std::vector<std::string>();
+  if (!_state->dev) {
+    return {};
+  }
+  // hid-playstation will create a hidraw node plus the gamepad, motion sensors and touchpad input devices
+  return _state->dev->get_nodes();
 }
 
-void PS5Joypad::set_pressed_buttons(int pressed) {
-  { // First reset everything to non-pressed
-    this->_state->current_state.buttons[0] = 0;
-    this->_state->current_state.buttons[1] = 0;
-    this->_state->current_state.buttons[2] = 0;
-    this->_state->current_state.buttons[3] = 0;
-  }
-  {
-    if (DPAD_UP & pressed) {     // Pressed UP
-      if (DPAD_LEFT & pressed) { // NW
-        this->_state->current_state.buttons[0] |= uhid::HAT_NW;
-      } else if (DPAD_RIGHT & pressed) { // NE
-        this->_state->current_state.buttons[0] |= uhid::HAT_NE;
-      } else { // N
-        this->_state->current_state.buttons[0] |= uhid::HAT_N;
-      }
+void PS5Joypad::reset() {
+  _state->writer.run([state = _state.get()]() {
+    auto &report = state->current_state;
+    for (auto &byte : report.buttons) {
+      byte = 0;
     }
-
-    if (DPAD_DOWN & pressed) {   // Pressed DOWN
-      if (DPAD_LEFT & pressed) { // SW
-        this->_state->current_state.buttons[0] |= uhid::HAT_SW;
-      } else if (DPAD_RIGHT & pressed) { // SE
-        this->_state->current_state.buttons[0] |= uhid::HAT_SE;
-      } else { // S
-        this->_state->current_state.buttons[0] |= uhid::HAT_S;
+    report.buttons[0] = uhid::HAT_NEUTRAL;
+    report.x = report.y = report.rx = report.ry = stick_to_ps5(0);
+    report.z = report.rz = trigger_to_ps5(0);
+    for (int finger_nr = 0; finger_nr <= 1; finger_nr++) {
+      if (report.points[finger_nr].contact == 0) { // 0 means that the finger is on the touchpad
+        state->touch_points_ids[finger_nr] = (state->touch_points_ids[finger_nr] + 1) & 0x7F;
+        report.points[finger_nr].contact = 1;
       }
     }
+    send_report(*state);
+    state->snapshot.write([](Joypad::Snapshot &snapshot) { snapshot = {}; });
+    state->conditioning.reset();
+  });
 
-    if (DPAD_LEFT & pressed) {                              // Pressed LEFT
-      if (!(DPAD_UP & pressed) && !(DPAD_DOWN & pressed)) { // Pressed only LEFT
-        this->_state->current_state.buttons[0] |= uhid::HAT_W;
-      }
+  // The motors are driven by the client: there's no effect to stop on our side, just tell it to stop.
+  // Not from the writer: the callback might call handover(), which waits for the writer to be done.
+  if (auto on_rumble = get_callback(*_state, _state->on_rumble)) {
+    (*on_rumble)(0, 0);
+  }
+}
+
+void PS5Joypad::handover() {
+  reset();
+  _state->writer.flush();
+  _state->conditioning.restore_defaults(_state->writer);
+  std::lock_guard<std::mutex> lock(_state->callbacks_m);
+  _state->on_rumble = std::nullopt;
+  _state->on_led = std::nullopt;
+}
+
+void PS5Joypad::set_pressed_buttons(int pressed) {
+  _state->writer.run([state = _state.get(), pressed]() {
+    auto &buttons = state->current_state.buttons;
+    // Only the buttons that have changed are flipped, the rest of the report is left as it is
+    std::uint32_t report = 0;
+    for (int i = 0; i < 4; i++) {
+      report |= static_cast<std::uint32_t>(buttons[i]) << (i * 8);
     }
 
-    if (DPAD_RIGHT & pressed) {                             // Pressed RIGHT
-      if (!(DPAD_UP & pressed) && !(DPAD_DOWN & pressed)) { // Pressed only RIGHT
-        this->_state->current_state.buttons[0] |= uhid::HAT_E;
+    auto changed = static_cast<std::uint32_t>(state->snapshot.current().pressed_buttons ^ pressed);
+    for_each_bit(changed & ~DPAD_MASK, [&](int bit) {
+      if (auto position = ps5_buttons[bit]; position >= 0) {
+        report ^= 1u << position;
       }
-    }
+    });
+    report = (report & ~0x0Fu) | HAT_LUT[pressed & DPAD_MASK].hid;
 
-    if (!(DPAD_UP & pressed) && !(DPAD_DOWN & pressed) && !(DPAD_LEFT & pressed) && !(DPAD_RIGHT & pressed)) {
-      this->_state->current_state.buttons[0] |= uhid::HAT_NEUTRAL;
+    for (int i = 0; i < 4; i++) {
+      buttons[i] = (report >> (i * 8)) & 0xFF;
     }
-
-    // TODO: L2/R2 ??
-
-    if (X & pressed)
-      this->_state->current_state.buttons[0] |= uhid::SQUARE;
-    if (Y & pressed)
-      this->_state->current_state.buttons[0] |= uhid::TRIANGLE;
-    if (A & pressed)
-      this->_state->current_state.buttons[0] |= uhid::CROSS;
-    if (B & pressed)
-      this->_state->current_state.buttons[0] |= uhid::CIRCLE;
-    if (LEFT_BUTTON & pressed)
-      this->_state->current_state.buttons[1] |= uhid::L1;
-    if (RIGHT_BUTTON & pressed)
-      this->_state->current_state.buttons[1] |= uhid::R1;
-    if (LEFT_STICK & pressed)
-      this->_state->current_state.buttons[1] |= uhid::L3;
-    if (RIGHT_STICK & pressed)
-      this->_state->current_state.buttons[1] |= uhid::R3;
-    if (START & pressed)
-      this->_state->current_state.buttons[1] |= uhid::OPTIONS;
-    if (BACK & pressed)
-      this->_state->current_state.buttons[1] |= uhid::CREATE;
-    if (TOUCHPAD_FLAG & pressed)
-      this->_state->current_state.buttons[2] |= uhid::TOUCHPAD;
-    if (HOME & pressed)
-      this->_state->current_state.buttons[2] |= uhid::PS_HOME;
-    if (MISC_FLAG & pressed)
-      this->_state->current_state.buttons[2] |= uhid::MIC_MUTE;
-  }
-  send_report(*this->_state);
+    state->snapshot.write([pressed](Joypad::Snapshot &snapshot) { snapshot.pressed_buttons = pressed; });
+    send_report(*state);
+  });
 }
 void PS5Joypad::set_triggers(int16_t left, int16_t right) {
-  this->_state->current_state.z = scale_value(left, 0, 255, uhid::PS5_AXIS_MIN, uhid::PS5_AXIS_MAX);
-  this->_state->current_state.rz = scale_value(right, 0, 255, uhid::PS5_AXIS_MIN, uhid::PS5_AXIS_MAX);
-  send_report(*this->_state);
+  _state->writer.run([state = _state.get(), raw_left = left, raw_right = right]() {
+    auto [left, right] = state->conditioning.triggers(raw_left, raw_right);
+    state->current_state.z = trigger_to_ps5(left);
+    state->current_state.rz = trigger_to_ps5(right);
+    state->snapshot.write([left = left, right = right](Joypad::Snapshot &snapshot) {
+      snapshot.left_trigger = left;
+      snapshot.right_trigger = right;
+    });
+    send_report(*state);
+  });
 }
 void PS5Joypad::set_stick(Joypad::STICK_POSITION stick_type, short x, short y) {
-  switch (stick_type) {
-  case RS: {
-    this->_state->current_state.rx = scale_value(x, -32768, 32767, uhid::PS5_AXIS_MIN, uhid::PS5_AXIS_MAX);
-    this->_state->current_state.ry = scale_value(y, -32768, 32767, uhid::PS5_AXIS_MIN, uhid::PS5_AXIS_MAX);
-    send_report(*this->_state);
-    break;
-  }
-  case LS: {
-    this->_state->current_state.x = scale_value(x, -32768, 32767, uhid::PS5_AXIS_MIN, uhid::PS5_AXIS_MAX);
-    this->_state->current_state.y = scale_value(y, -32768, 32767, uhid::PS5_AXIS_MIN, uhid::PS5_AXIS_MAX);
-    send_report(*this->_state);
-    break;
-  }
-  }
+  _state->writer.run([state = _state.get(), stick_type, x, y]() { write_stick(*state, stick_type, x, y); });
 }
+
+Result<bool> PS5Joypad::set_stick_conditioning(STICK_POSITION stick, const StickConditioning &conditioning) {
+  return _state->conditioning.configure(_state->writer, stick, conditioning);
+}
+
+Result<bool> PS5Joypad::set_trigger_conditioning(const TriggerConditioning &conditioning) {
+  return _state->conditioning.configure(_state->writer, conditioning);
+}
+
+Joypad::Snapshot PS5Joypad::snapshot() const {
+  return _state->snapshot.read();
+}
+
 void PS5Joypad::set_on_rumble(const std::function<void(int, int)> &callback) {
+  std::lock_guard<std::mutex> lock(this->_state->callbacks_m);
   this->_state->on_rumble = callback;
 }
 
-static inline float rad2deg(float rad) {
-  return rad * (180.0f / (float)M_PI);
+/**
+ * The whole conversion factor for each motion channel, see motion_to_ps5():
+ * acceleration from m/s^2 to 1/100 g, gyroscope from rad/s to the calibrated units
+ */
+static_assert(uhid::gyro_calib_bias == 0, "motion_to_ps5() doesn't apply a bias");
+static constexpr float gyro_scale(int calib_denom) {
+  return 180.0 / M_PI / calib_denom * uhid::PS5_GYRO_RES_PER_DEG_S * 5;
 }
+static constexpr std::array<float, 6> motion_scale = {uhid::SDL_STANDARD_GRAVITY * 100,
+                                                      uhid::SDL_STANDARD_GRAVITY * 100,
+                                                      uhid::SDL_STANDARD_GRAVITY * 100,
+                                                      gyro_scale(uhid::gyro_calib_pitch_denom),
+                                                      gyro_scale(uhid::gyro_calib_yaw_denom),
+                                                      gyro_scale(uhid::gyro_calib_roll_denom)};
 
 void PS5Joypad::set_motion(PS5Joypad::MOTION_TYPE type, float x, float y, float z) {
-  switch (type) {
-  case ACCELERATION: {
-    this->_state->current_state.accel[0] = htole16((x * uhid::SDL_STANDARD_GRAVITY * 100));
-    this->_state->current_state.accel[1] = htole16((y * uhid::SDL_STANDARD_GRAVITY * 100));
-    this->_state->current_state.accel[2] = htole16((z * uhid::SDL_STANDARD_GRAVITY * 100));
-    send_report(*this->_state);
-    break;
-  }
-  case GYROSCOPE: {
-    this->_state->current_state.gyro[0] =
-        htole16(rad2deg((x + uhid::gyro_calib_bias) / uhid::gyro_calib_pitch_denom) * uhid::PS5_GYRO_RES_PER_DEG_S * 5);
-    this->_state->current_state.gyro[1] =
-        htole16(rad2deg((y + uhid::gyro_calib_bias) / uhid::gyro_calib_yaw_denom) * uhid::PS5_GYRO_RES_PER_DEG_S * 5);
-    this->_state->current_state.gyro[2] =
-        htole16(rad2deg((z + uhid::gyro_calib_bias) / uhid::gyro_calib_roll_denom) * uhid::PS5_GYRO_RES_PER_DEG_S * 5);
-    send_report(*this->_state);
-    break;
+  _state->writer.run([state = _state.get(), type, x, y, z]() {
+    switch (type) {
+    case ACCELERATION: {
+      state->current_state.accel[0] = htole16(motion_to_ps5(x, motion_scale[0]));
+      state->current_state.accel[1] = htole16(motion_to_ps5(y, motion_scale[1]));
+      state->current_state.accel[2] = htole16(motion_to_ps5(z, motion_scale[2]));
+      send_report(*state);
+      break;
+    }
+    case GYROSCOPE: {
+      state->current_state.gyro[0] = htole16(motion_to_ps5(x, motion_scale[3]));
+      state->current_state.gyro[1] = htole16(motion_to_ps5(y, motion_scale[4]));
+      state->current_state.gyro[2] = htole16(motion_to_ps5(z, motion_scale[5]));
+      send_report(*state);
+      break;
+    }
+    }
+  });
+}
+
+void PS5Joypad::set_motion(const MotionSample *samples, std::size_t count) {
+  constexpr std::size_t CHUNK = 64;
+  std::array<float, CHUNK * 6> values = {};
+  std::array<std::int16_t, CHUNK * 6> scaled = {};
+  for (std::size_t start = 0; start < count; start += CHUNK) {
+    auto chunk = std::min(CHUNK, count - start);
+    for (std::size_t i = 0; i < chunk; i++) {
+      std::copy_n(samples[start + i].acceleration, 3, &values[i * 6]);
+      std::copy_n(samples[start + i].gyroscope, 3, &values[i * 6 + 3]);
+    }
+    motion_to_ps5(values.data(), scaled.data(), chunk, motion_scale);
+
+    for (std::size_t i = 0; i < chunk; i++) {
+      std::array<std::int16_t, 6> motion = {};
+      std::copy_n(&scaled[i * 6], 6, motion.begin());
+      _state->writer.run([state = _state.get(), motion]() {
+        for (int axis = 0; axis < 3; axis++) {
+          state->current_state.accel[axis] = htole16(motion[axis]);
+          state->current_state.gyro[axis] = htole16(motion[axis + 3]);
+        }
+        send_report(*state);
+      });
+    }
   }
+}
+
+void PS5Joypad::set_battery(PS5Joypad::BATTERY_STATE battery_state, int percentage) {
+  _state->writer.run([state = _state.get(), battery_state, percentage]() {
+    /*
+     * Each unit of battery data corresponds to 10%
+     * 0 = 0-9%, 1 = 10-19%, .. and 10 = 100%
+     */
+    state->current_state.battery_charge = std::lround((percentage / 10));
+    state->current_state.battery_status = battery_state;
+    send_report(*state);
+  });
+}
+
+/**
+ * The driver creates the hidraw node first and the input devices only afterwards, we have to wait until we have both
+ */
+static bool has_input_nodes(const std::vector<std::string> &nodes) {
+  return std::any_of(nodes.begin(), nodes.end(), [](const std::string &node) {
+    return node.rfind("/dev/input/", 0) == 0;
+  });
+}
+
+bool PS5Joypad::is_ready() const {
+  {
+    std::lock_guard<std::mutex> lock(_state->started_m);
+    if (!_state->started) {
+      return false;
+    }
   }
+  return VirtualDevice::is_ready() && has_input_nodes(get_nodes());
 }
 
-void PS5Joypad::set_battery(PS5Joypad::BATTERY_STATE state, int percentage) {
-  /*
-   * Each unit of battery data corresponds to 10%
-   * 0 = 0-9%, 1 = 10-19%, .. and 10 = 100%
-   */
-  this->_state->current_state.battery_charge = std::lround((percentage / 10));
-  this->_state->current_state.battery_status = state;
-  send_report(*this->_state);
+bool PS5Joypad::wait_ready(std::chrono::milliseconds timeout) const {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  {
+    std::unique_lock<std::mutex> lock(_state->started_m);
+    if (!_state->started_cv.wait_until(lock, deadline, [this]() { return _state->started; })) {
+      return false;
+    }
+  }
+
+  while (true) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    if (!VirtualDevice::wait_ready(std::max(remaining, std::chrono::milliseconds(0)))) {
+      return false;
+    }
+    if (has_input_nodes(get_nodes())) {
+      return true;
+    }
+    if (remaining.count() <= 0) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
 }
 
 void PS5Joypad::set_on_led(const std::function<void(int, int, int)> &callback) {
+  std::lock_guard<std::mutex> lock(this->_state->callbacks_m);
   this->_state->on_led = callback;
 }
 
 void PS5Joypad::place_finger(int finger_nr, uint16_t x, uint16_t y) {
-  if (finger_nr <= 1) {
-    this->_state->current_state.points[finger_nr].contact = 0;
-    this->_state->current_state.points[finger_nr].id = this->_state->touch_points_ids[finger_nr] + 1;
+  _state->writer.run([state = _state.get(), finger_nr, x, y]() {
+    if (finger_nr <= 1) {
+      state->current_state.points[finger_nr].contact = 0;
+      state->current_state.points[finger_nr].id = state->touch_points_ids[finger_nr] + 1;
 
-    this->_state->current_state.points[finger_nr].x_lo = static_cast<uint8_t>(x & 0x00FF);
-    this->_state->current_state.points[finger_nr].x_hi = static_cast<uint8_t>((x & 0xFF00) >> 8);
+      state->current_state.points[finger_nr].x_lo = static_cast<uint8_t>(x & 0x00FF);
+      state->current_state.points[finger_nr].x_hi = static_cast<uint8_t>((x & 0xFF00) >> 8);
 
-    this->_state->current_state.points[finger_nr].y_lo = static_cast<uint8_t>(y & 0x00FF);
-    this->_state->current_state.points[finger_nr].y_hi = static_cast<uint8_t>((y & 0xFF00) >> 4);
+      state->current_state.points[finger_nr].y_lo = static_cast<uint8_t>(y & 0x00FF);
+      state->current_state.points[finger_nr].y_hi = static_cast<uint8_t>((y & 0xFF00) >> 4);
 
-    send_report(*this->_state);
-  }
+      send_report(*state);
+    }
+  });
 }
 
 void PS5Joypad::release_finger(int finger_nr) {
-  if (finger_nr <= 1) {
-    this->_state->touch_points_ids[finger_nr]++;
-    // if it goes above 0x7F we should reset it to 0
-    if (this->_state->touch_points_ids[finger_nr] > 0x7F) {
-      this->_state->touch_points_ids[finger_nr] = 0;
+  _state->writer.run([state = _state.get(), finger_nr]() {
+    if (finger_nr <= 1) {
+      state->touch_points_ids[finger_nr]++;
+      // if it goes above 0x7F we should reset it to 0
+      if (state->touch_points_ids[finger_nr] > 0x7F) {
+        state->touch_points_ids[finger_nr] = 0;
+      }
+      state->current_state.points[finger_nr].contact = 1;
+      send_report(*state);
     }
-    this->_state->current_state.points[finger_nr].contact = 1;
-    send_report(*this->_state);
-  }
+  });
 }
 
 } // namespace inputtino
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <inputtino/input.hpp>
+#include <inputtino/protected_types.hpp>
+#include <uhid/keyboard.hpp>
+#include <uhid/uhid.hpp>
+
+namespace inputtino {
+
+Result<std::shared_ptr<uhid::Device>> create_nkro_keyboard(const DeviceDefinition &device) {
+  auto def = uhid::DeviceDefinition{
+      .name = device.name,
+      .phys = device.device_phys,
+      .uniq = device.device_uniq,
+      .bus = BUS_USB,
+      .vendor = static_cast<uint32_t>(device.vendor_id),
+      .product = static_cast<uint32_t>(device.product_id),
+      .version = static_cast<uint32_t>(device.version),
+      .country = 0,
+      .report_description = {&uhid::nkro_keyboard_rdesc[0],
+                             &uhid::nkro_keyboard_rdesc[0] + sizeof(uhid::nkro_keyboard_rdesc)}};
+
+  // There are no feature reports to answer; LED output reports (caps lock, num lock, ...) are ignored for now
+  auto dev = uhid::Device::create(def, [](const uhid_event &, int) {});
+  if (dev) {
+    return std::make_shared<uhid::Device>(std::move(*dev));
+  }
+  return Error(dev.getErrorMessage());
+}
+
+static void send_report(KeyboardState &state) {
+  struct uhid_event ev {};
+  ev.type = UHID_INPUT2;
+  std::copy(&state.nkro_report.keys[0], &state.nkro_report.keys[0] + sizeof(state.nkro_report.keys), ev.u.input2.data);
+  ev.u.input2.size = sizeof(state.nkro_report.keys);
+  state.nkro_kb->send(ev);
+}
+
+void nkro_set_key(KeyboardState &state, int linux_code, bool pressed) {
+  if (!state.nkro_kb) {
+    return;
+  }
+  auto usage = uhid::linux_to_hid_usage(linux_code);
+  if (usage == 0) {
+    if (pressed) {
+      fprintf(stderr, "Key %d has no HID usage, it can't be sent by the UHID keyboard\n", linux_code);
+    }
+    return;
+  }
+
+  auto &byte = state.nkro_report.keys[usage / 8];
+  uint8_t bit = 1 << (usage % 8);
+  if (pressed == ((byte & bit) != 0)) {
+    return; // Nothing changed, no need to send a new report
+  }
+  byte = pressed ? (byte | bit) : (byte & ~bit);
+  send_report(state);
+}
+
+void nkro_release_all(KeyboardState &state) {
+  auto &keys = state.nkro_report.keys;
+  if (!state.nkro_kb || std::all_of(std::begin(keys), std::end(keys), [](uint8_t byte) { return byte == 0; })) {
+    return;
+  }
+  state.nkro_report = {};
+  send_report(state);
+}
+
+} // namespace inputtino
@@ -0,0 +1,298 @@
+#include <atomic>
+#include <dirent.h>
+#include <fstream>
+#include <inputtino/threads.hpp>
+#include <random>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <uhid/uhid.hpp>
+
+namespace uhid {
+
+static void set_c_str(const std::string &str, unsigned char *c_str) {
+  std::copy(str.begin(), str.end(), c_str);
+  c_str[str.length()] = 0;
+}
+
+/**
+ * The kernel doesn't tell us which HID device it has created for our fd, and devices created from the same definition
+ * (ex: two PS5 pads) would look exactly the same in sysfs. Each device gets its own phys instead: the one from the
+ * definition followed by an id that is unique to this process and device, that's what find_hid_syspath() looks for.
+ */
+static std::string unique_phys(const std::string &phys) {
+  static const auto process_id = std::random_device{}(); // pids aren't unique across containers
+  static std::atomic<unsigned int> next_device = 0;
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), "/inputtino-%08x-%u", process_id, next_device++);
+  constexpr auto max_length = sizeof(uhid_create2_req::phys) - 1; // NUL terminated
+  return phys.substr(0, max_length - strlen(suffix)) + suffix;
+}
+
+inputtino::Result<Device> Device::create(const DeviceDefinition &device_definition,
+                                         const std::function<void(const uhid_event &ev, int fd)> &on_event) {
+  auto definition = device_definition;
+  definition.phys = unique_phys(device_definition.phys);
+
+  inputtino::hotplug_generation(); // Start listening for uevents before the device is created, see NodeCache
+  int fd = open("/dev/uhid", O_RDWR | O_CLOEXEC | O_NONBLOCK);
+  if (fd < 0) {
+    return inputtino::Error(strerror(errno));
+  }
+
+  auto ev = uhid_event{};
+  ev.type = UHID_CREATE2, ev.u.create2.bus = definition.bus, ev.u.create2.vendor = definition.vendor,
+  ev.u.create2.product = definition.product, ev.u.create2.version = definition.version,
+  ev.u.create2.country = definition.country,
+  ev.u.create2.rd_size = static_cast<__u16>(definition.report_description.size()),
+  std::copy(definition.report_description.begin(), definition.report_description.end(), ev.u.create2.rd_data);
+  set_c_str(definition.name, ev.u.create2.name);
+  set_c_str(definition.phys, ev.u.create2.phys);
+  set_c_str(definition.uniq, ev.u.create2.uniq);
+
+  auto res = uhid_write(fd, &ev);
+  if (!res) {
+    close(fd);
+    return inputtino::Error(res.getErrorMessage());
+  }
+
+  auto state = std::make_shared<DeviceState>();
+  state->fd = fd;
+  state->on_event = on_event;
+  state->definition = definition;
+  auto registered = Reactor::get().add(state);
+  if (!registered) {
+    ev = {};
+    ev.type = UHID_DESTROY;
+    uhid_write(fd, &ev);
+    close(fd);
+    return inputtino::Error(registered.getErrorMessage());
+  }
+  return Device(std::move(state));
+}
+
+/**
+ * HID devices are named `<bus>:<vendor>:<product>.<instance>` and there's no way of knowing which instance number the
+ * kernel picked for us; we look for the one that matches our definition (and our unique phys) instead.
+ */
+static std::optional<std::string> find_hid_syspath(const DeviceDefinition &definition) {
+  char hid_id[64];
+  snprintf(hid_id, sizeof(hid_id), "HID_ID=%04X:%08X:%08X", definition.bus, definition.vendor, definition.product);
+  auto hid_name = "HID_NAME=" + definition.name;
+  auto hid_phys = "HID_PHYS=" + definition.phys;
+
+  std::optional<std::string> result = std::nullopt;
+  auto dir = opendir("/sys/bus/hid/devices");
+  if (!dir) {
+    return result;
+  }
+  while (auto entry = readdir(dir)) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    auto syspath = std::string("/sys/bus/hid/devices/") + entry->d_name;
+    std::ifstream uevent(syspath + "/uevent");
+    int matches = 0;
+    for (std::string line; std::getline(uevent, line);) {
+      matches += line == hid_id || line == hid_name || line == hid_phys;
+    }
+    if (matches == 3) {
+      result = syspath;
+      break;
+    }
+  }
+  closedir(dir);
+  return result;
+}
+
+std::vector<std::string> Device::get_nodes() const {
+  return state->nodes.get([this]() {
+    auto syspath = find_hid_syspath(state->definition);
+    return syspath ? inputtino::find_dev_nodes(*syspath) : std::vector<std::string>{};
+  });
+}
+
+Reactor &Reactor::get() {
+  static Reactor reactor;
+  return reactor;
+}
+
+inputtino::Result<bool> Reactor::add(const std::shared_ptr<DeviceState> &device) {
+  std::unique_lock<std::mutex> lock(mutex);
+  bool on_reactor_thread = std::this_thread::get_id() == thread.get_id();
+  // If the last device has just been removed, let the thread shut down before starting a new one
+  lifecycle.wait(lock, [this, on_reactor_thread]() { return !stopping || on_reactor_thread; });
+
+  if (epoll_fd < 0) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd < 0 || stop_fd < 0) {
+      auto error = inputtino::Error(strerror(errno));
+      close_fds();
+      return error;
+    }
+
+    struct epoll_event stop_ev {};
+    stop_ev.events = EPOLLIN;
+    stop_ev.data.fd = stop_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &stop_ev);
+  }
+
+  struct epoll_event dev_ev {};
+  dev_ev.events = EPOLLIN;
+  dev_ev.data.fd = device->fd;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, device->fd, &dev_ev) < 0) {
+    auto error = inputtino::Error(strerror(errno));
+    if (devices.empty() && !thread.joinable()) {
+      close_fds();
+    }
+    return error;
+  }
+  devices[device->fd] = device;
+
+  if (!thread.joinable()) {
+    thread = std::thread(&Reactor::run, this);
+  }
+  return true;
+}
+
+void Reactor::remove(int fd) {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (devices.erase(fd) == 0) {
+    return;
+  }
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+
+  if (std::this_thread::get_id() != thread.get_id()) {
+    // Wait for any in flight on_event() call for this device to complete
+    lifecycle.wait(lock, [this, fd]() { return dispatching_fd != fd; });
+  }
+
+  if (devices.empty()) {
+    stop(lock);
+  }
+}
+
+void Reactor::stop(std::unique_lock<std::mutex> &lock) {
+  if (!thread.joinable()) {
+    return;
+  }
+
+  stopping = true;
+  uint64_t value = 1;
+  write(stop_fd, &value, sizeof(value));
+
+  if (std::this_thread::get_id() == thread.get_id()) {
+    return; // A device has been removed from inside its own on_event(), run() will exit once it's done
+  }
+
+  auto to_join = std::move(thread);
+  lock.unlock();
+  to_join.join();
+  lock.lock();
+}
+
+void Reactor::close_fds() {
+  if (epoll_fd >= 0) {
+    close(epoll_fd);
+    epoll_fd = -1;
+  }
+  if (stop_fd >= 0) {
+    close(stop_fd);
+    stop_fd = -1;
+  }
+}
+
+Reactor::~Reactor() {
+  std::unique_lock<std::mutex> lock(mutex);
+  devices.clear();
+  stop(lock);
+}
+
+void Reactor::run() {
+  inputtino::apply_thread_config("uhid");
+  struct epoll_event events[16];
+  while (true) {
+    int nfds = epoll_wait(epoll_fd, events, 16, -1);
+    if (nfds < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "Cannot poll for uhid fds: %m\n");
+      return;
+    }
+
+    for (int i = 0; i < nfds; i++) {
+      if (events[i].data.fd == stop_fd) {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t value;
+        read(stop_fd, &value, sizeof(value));
+        if (!devices.empty()) {
+          stopping = false; // A new device has been added from inside on_event(), keep going
+          continue;
+        }
+
+        close_fds();
+        stopping = false;
+        if (std::this_thread::get_id() == thread.get_id()) {
+          thread.detach();
+        }
+        lifecycle.notify_all();
+        return;
+      }
+
+      std::shared_ptr<DeviceState> device;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto search = devices.find(events[i].data.fd);
+        if (search == devices.end()) {
+          continue; // Removed after epoll_wait() returned
+        }
+        device = search->second;
+        dispatching_fd = device->fd;
+      }
+
+      bool hung_up = events[i].events & (EPOLLHUP | EPOLLERR);
+      if (hung_up) {
+        fprintf(stderr, "Received HUP on uhid-cdev\n");
+      } else {
+        // A single read: on_event() might destroy the device, if there's more to read epoll will wake us up again
+        struct uhid_event ev {};
+        ssize_t ret = read(device->fd, &ev, sizeof(ev));
+        if (ret == 0) {
+          fprintf(stderr, "Read HUP on uhid-cdev\n");
+          hung_up = true;
+        } else if (ret < 0) {
+          if (errno != EAGAIN) {
+            fprintf(stderr, "Cannot read uhid-cdev: %m\n");
+          }
+        } else if (ret != sizeof(ev)) {
+          fprintf(stderr, "Invalid size read from uhid-dev: %zd != %zu\n", ret, sizeof(ev));
+        } else if (device->on_event) {
+          device->on_event(ev, device->fd);
+        }
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        dispatching_fd = -1;
+      }
+      lifecycle.notify_all();
+
+      if (hung_up) {
+        // epoll is level triggered: if we keep the fd registered we'll be woken up again straight away, forever
+        device->dead = true;
+        std::unique_lock<std::mutex> lock(mutex);
+        auto search = devices.find(device->fd);
+        if (search != devices.end() && search->second == device) { // on_event() might have replaced it already
+          devices.erase(search);
+          epoll_ctl(epoll_fd, EPOLL_CTL_DEL, device->fd, nullptr);
+          if (devices.empty()) {
+            stop(lock);
+          }
+        }
+      }
+    }
+  }
+}
+
+} // namespace uhid
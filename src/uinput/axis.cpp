@@ -0,0 +1,253 @@
+#include <atomic>
+#include <inputtino/axis.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INPUTTINO_X86 1
+#endif
+
+namespace inputtino {
+
+static void to_device_units_scalar(const float *frames, int *out, std::size_t count, const std::array<int, 4> &max) {
+  for (std::size_t i = 0; i < count * 4; i++) {
+    out[i] = to_device_units(frames[i], max[i % 4]);
+  }
+}
+
+static void tilt_to_device_units_scalar(const float *degrees, int *out, std::size_t count, int resolution) {
+  for (std::size_t i = 0; i < count; i++) {
+    out[i] = tilt_to_device_units(degrees[i], resolution);
+  }
+}
+
+static void
+motion_to_ps5_scalar(const float *samples, std::int16_t *out, std::size_t count, const std::array<float, 6> &scale) {
+  for (std::size_t i = 0; i < count * 6; i++) {
+    out[i] = motion_to_ps5(samples[i], scale[i % 6]);
+  }
+}
+
+#ifdef INPUTTINO_X86
+
+/**
+ * The vectorised versions follow exactly the same steps as the scalar ones: the products are computed as floats,
+ * rounding half away from zero is done in double precision by adding +-0.5 and truncating.
+ * NaN is zeroed and everything else clamped before truncating: cvttpd/cvttps would turn them into INT_MIN.
+ * Clamps put the value as the second operand of max/min, so that NaN goes through them as it does with std::clamp().
+ */
+
+__attribute__((target("sse2"))) static inline __m128d saturate_to_int_sse2(__m128d values) {
+  const __m128d min = _mm_set1_pd(INT32_MIN), max = _mm_set1_pd(INT32_MAX);
+  values = _mm_and_pd(values, _mm_cmpord_pd(values, values)); // NaN to 0
+  return _mm_min_pd(_mm_max_pd(values, min), max);
+}
+
+__attribute__((target("sse2"))) static inline __m128i round_half_away_sse2(__m128 values) {
+  const __m128d sign_mask = _mm_set1_pd(-0.0);
+  const __m128d half = _mm_set1_pd(0.5);
+  __m128d low = _mm_cvtps_pd(values);
+  __m128d high = _mm_cvtps_pd(_mm_movehl_ps(values, values));
+  low = saturate_to_int_sse2(_mm_add_pd(low, _mm_or_pd(half, _mm_and_pd(low, sign_mask))));
+  high = saturate_to_int_sse2(_mm_add_pd(high, _mm_or_pd(half, _mm_and_pd(high, sign_mask))));
+  return _mm_unpacklo_epi64(_mm_cvttpd_epi32(low), _mm_cvttpd_epi32(high));
+}
+
+__attribute__((target("sse2"))) static void
+to_device_units_sse2(const float *frames, int *out, std::size_t count, const std::array<int, 4> &max) {
+  const __m128 scale = _mm_setr_ps(max[0], max[1], max[2], max[3]);
+  for (std::size_t i = 0; i < count; i++) {
+    __m128 scaled = _mm_mul_ps(_mm_loadu_ps(frames + i * 4), scale);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 4), round_half_away_sse2(scaled));
+  }
+}
+
+__attribute__((target("sse2"))) static void
+tilt_to_device_units_sse2(const float *degrees, int *out, std::size_t count, int resolution) {
+  const __m128 min = _mm_set1_ps(-90.0f), max = _mm_set1_ps(90.0f);
+  const __m128 scale = _mm_set1_ps(resolution);
+  const __m128d pi = _mm_set1_pd(M_PI), half_turn = _mm_set1_pd(180.0);
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 scaled = _mm_mul_ps(_mm_min_ps(max, _mm_max_ps(min, _mm_loadu_ps(degrees + i))), scale);
+    __m128d low = _mm_div_pd(_mm_mul_pd(pi, _mm_cvtps_pd(scaled)), half_turn);
+    __m128d high = _mm_div_pd(_mm_mul_pd(pi, _mm_cvtps_pd(_mm_movehl_ps(scaled, scaled))), half_turn);
+    __m128 radians = _mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), round_half_away_sse2(radians));
+  }
+  tilt_to_device_units_scalar(degrees + i, out + i, count - i, resolution);
+}
+
+__attribute__((target("sse2"))) static inline __m128i convert_motion_sse2(__m128 values, __m128 scale) {
+  const __m128 min = _mm_set1_ps(-32768.0f), max = _mm_set1_ps(32767.0f);
+  __m128 scaled = _mm_mul_ps(values, scale);
+  scaled = _mm_and_ps(scaled, _mm_cmpord_ps(scaled, scaled)); // NaN to 0
+  return _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(scaled, min), max));
+}
+
+__attribute__((target("sse2"))) static void
+motion_to_ps5_sse2(const float *samples, std::int16_t *out, std::size_t count, const std::array<float, 6> &scale) {
+  // 2 samples (12 channels) per iteration, so that the scale repeats every 3 vectors
+  const __m128 scale0 = _mm_setr_ps(scale[0], scale[1], scale[2], scale[3]);
+  const __m128 scale1 = _mm_setr_ps(scale[4], scale[5], scale[0], scale[1]);
+  const __m128 scale2 = _mm_setr_ps(scale[2], scale[3], scale[4], scale[5]);
+  std::size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    const float *in = samples + i * 6;
+    __m128i first = convert_motion_sse2(_mm_loadu_ps(in), scale0);
+    __m128i second = convert_motion_sse2(_mm_loadu_ps(in + 4), scale1);
+    __m128i third = convert_motion_sse2(_mm_loadu_ps(in + 8), scale2);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 6), _mm_packs_epi32(first, second));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i * 6 + 8), _mm_packs_epi32(third, third));
+  }
+  motion_to_ps5_scalar(samples + i * 6, out + i * 6, count - i, scale);
+}
+
+__attribute__((target("avx2"))) static inline __m256d saturate_to_int_avx2(__m256d values) {
+  const __m256d min = _mm256_set1_pd(INT32_MIN), max = _mm256_set1_pd(INT32_MAX);
+  values = _mm256_and_pd(values, _mm256_cmp_pd(values, values, _CMP_ORD_Q)); // NaN to 0
+  return _mm256_min_pd(_mm256_max_pd(values, min), max);
+}
+
+__attribute__((target("avx2"))) static inline __m256i round_half_away_avx2(__m256 values) {
+  const __m256d sign_mask = _mm256_set1_pd(-0.0);
+  const __m256d half = _mm256_set1_pd(0.5);
+  __m256d low = _mm256_cvtps_pd(_mm256_castps256_ps128(values));
+  __m256d high = _mm256_cvtps_pd(_mm256_extractf128_ps(values, 1));
+  low = saturate_to_int_avx2(_mm256_add_pd(low, _mm256_or_pd(half, _mm256_and_pd(low, sign_mask))));
+  high = saturate_to_int_avx2(_mm256_add_pd(high, _mm256_or_pd(half, _mm256_and_pd(high, sign_mask))));
+  return _mm256_set_m128i(_mm256_cvttpd_epi32(high), _mm256_cvttpd_epi32(low));
+}
+
+__attribute__((target("avx2"))) static void
+to_device_units_avx2(const float *frames, int *out, std::size_t count, const std::array<int, 4> &max) {
+  const __m256 scale = _mm256_setr_ps(max[0], max[1], max[2], max[3], max[0], max[1], max[2], max[3]);
+  std::size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m256 scaled = _mm256_mul_ps(_mm256_loadu_ps(frames + i * 4), scale);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i * 4), round_half_away_avx2(scaled));
+  }
+  to_device_units_scalar(frames + i * 4, out + i * 4, count - i, max);
+}
+
+__attribute__((target("avx2"))) static void
+tilt_to_device_units_avx2(const float *degrees, int *out, std::size_t count, int resolution) {
+  const __m256 min = _mm256_set1_ps(-90.0f), max = _mm256_set1_ps(90.0f);
+  const __m256 scale = _mm256_set1_ps(resolution);
+  const __m256d pi = _mm256_set1_pd(M_PI), half_turn = _mm256_set1_pd(180.0);
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 scaled = _mm256_mul_ps(_mm256_min_ps(max, _mm256_max_ps(min, _mm256_loadu_ps(degrees + i))), scale);
+    __m256d low = _mm256_div_pd(_mm256_mul_pd(pi, _mm256_cvtps_pd(_mm256_castps256_ps128(scaled))), half_turn);
+    __m256d high = _mm256_div_pd(_mm256_mul_pd(pi, _mm256_cvtps_pd(_mm256_extractf128_ps(scaled, 1))), half_turn);
+    __m256 radians = _mm256_set_m128(_mm256_cvtpd_ps(high), _mm256_cvtpd_ps(low));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), round_half_away_avx2(radians));
+  }
+  tilt_to_device_units_scalar(degrees + i, out + i, count - i, resolution);
+}
+
+__attribute__((target("avx2"))) static inline __m128i convert_motion_avx2(__m256 values, __m256 scale) {
+  const __m256 min = _mm256_set1_ps(-32768.0f), max = _mm256_set1_ps(32767.0f);
+  __m256 scaled = _mm256_mul_ps(values, scale);
+  scaled = _mm256_and_ps(scaled, _mm256_cmp_ps(scaled, scaled, _CMP_ORD_Q)); // NaN to 0
+  __m256i converted = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(scaled, min), max));
+  return _mm_packs_epi32(_mm256_castsi256_si128(converted), _mm256_extracti128_si256(converted, 1));
+}
+
+__attribute__((target("avx2"))) static void
+motion_to_ps5_avx2(const float *samples, std::int16_t *out, std::size_t count, const std::array<float, 6> &scale) {
+  // 4 samples (24 channels) per iteration, so that the scale repeats every 3 vectors
+  std::array<float, 24> repeated = {};
+  for (std::size_t i = 0; i < repeated.size(); i++) {
+    repeated[i] = scale[i % 6];
+  }
+  const __m256 scale0 = _mm256_loadu_ps(repeated.data());
+  const __m256 scale1 = _mm256_loadu_ps(repeated.data() + 8);
+  const __m256 scale2 = _mm256_loadu_ps(repeated.data() + 16);
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const float *in = samples + i * 6;
+    auto *converted = reinterpret_cast<__m128i *>(out + i * 6);
+    _mm_storeu_si128(converted, convert_motion_avx2(_mm256_loadu_ps(in), scale0));
+    _mm_storeu_si128(converted + 1, convert_motion_avx2(_mm256_loadu_ps(in + 8), scale1));
+    _mm_storeu_si128(converted + 2, convert_motion_avx2(_mm256_loadu_ps(in + 16), scale2));
+  }
+  motion_to_ps5_scalar(samples + i * 6, out + i * 6, count - i, scale);
+}
+
+static SimdLevel supported_simd_level() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::AVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SimdLevel::SSE2;
+  }
+  return SimdLevel::SCALAR;
+}
+
+#else
+
+static SimdLevel supported_simd_level() {
+  return SimdLevel::SCALAR;
+}
+
+#endif
+
+static std::atomic<SimdLevel> &simd_level() {
+  static std::atomic<SimdLevel> level = supported_simd_level();
+  return level;
+}
+
+SimdLevel get_simd_level() {
+  return simd_level().load(std::memory_order_relaxed);
+}
+
+SimdLevel set_simd_level(SimdLevel level) {
+  auto supported = supported_simd_level();
+  if (static_cast<int>(level) > static_cast<int>(supported)) {
+    level = supported;
+  }
+  simd_level().store(level, std::memory_order_relaxed);
+  return level;
+}
+
+void to_device_units(const float *frames, int *out, std::size_t count, const std::array<int, 4> &max) {
+  switch (get_simd_level()) {
+#ifdef INPUTTINO_X86
+  case SimdLevel::AVX2:
+    return to_device_units_avx2(frames, out, count, max);
+  case SimdLevel::SSE2:
+    return to_device_units_sse2(frames, out, count, max);
+#endif
+  default:
+    return to_device_units_scalar(frames, out, count, max);
+  }
+}
+
+void tilt_to_device_units(const float *degrees, int *out, std::size_t count, int resolution) {
+  switch (get_simd_level()) {
+#ifdef INPUTTINO_X86
+  case SimdLevel::AVX2:
+    return tilt_to_device_units_avx2(degrees, out, count, resolution);
+  case SimdLevel::SSE2:
+    return tilt_to_device_units_sse2(degrees, out, count, resolution);
+#endif
+  default:
+    return tilt_to_device_units_scalar(degrees, out, count, resolution);
+  }
+}
+
+void motion_to_ps5(const float *samples, std::int16_t *out, std::size_t count, const std::array<float, 6> &scale) {
+  switch (get_simd_level()) {
+#ifdef INPUTTINO_X86
+  case SimdLevel::AVX2:
+    return motion_to_ps5_avx2(samples, out, count, scale);
+  case SimdLevel::SSE2:
+    return motion_to_ps5_sse2(samples, out, count, scale);
+#endif
+  default:
+    return motion_to_ps5_scalar(samples, out, count, scale);
+  }
+}
+
+} // namespace inputtino
@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cmath>
+#include <inputtino/conditioning.hpp>
+#include <inputtino/threads.hpp>
+
+namespace inputtino {
+
+static constexpr float AXIS_MAX = 32767.0f;
+static constexpr float TRIGGER_MAX = 255.0f;
+
+/**
+ * The conditioned magnitude, both in [0.0, 1.0]
+ */
+static float response(float magnitude,
+                      float deadzone,
+                      float anti_deadzone,
+                      float exponent,
+                      const std::function<float(float)> &curve) {
+  if (magnitude <= deadzone) {
+    return 0.0f;
+  }
+  float value = std::min(1.0f, (magnitude - deadzone) / (1.0f - deadzone));
+  value = curve ? std::clamp(curve(value), 0.0f, 1.0f) : std::pow(value, exponent);
+  return anti_deadzone + (1.0f - anti_deadzone) * value;
+}
+
+static Result<bool> validate(float deadzone, float anti_deadzone, float exponent) {
+  if (!(deadzone >= 0.0f && deadzone < 1.0f)) {
+    return Error("Invalid deadzone " + std::to_string(deadzone) + ", it must be in [0.0, 1.0)");
+  }
+  if (!(anti_deadzone >= 0.0f && anti_deadzone < 1.0f)) {
+    return Error("Invalid anti deadzone " + std::to_string(anti_deadzone) + ", it must be in [0.0, 1.0)");
+  }
+  if (!(exponent > 0.0f)) {
+    return Error("Invalid exponent " + std::to_string(exponent) + ", it must be > 0.0");
+  }
+  return true;
+}
+
+static short to_short(float value) {
+  auto rounded = static_cast<int>(value + (value < 0 ? -0.5f : 0.5f));
+  return static_cast<short>(std::clamp(rounded, -32768, 32767));
+}
+
+/**
+ * One step of the moving average, snapped to the target once it would round to it anyway: this way settling() ends
+ */
+static float smooth(float current, short target, float weight) {
+  float next = current + weight * (target - current);
+  return std::abs(target - next) < 0.5f ? target : next;
+}
+
+std::pair<short, short> JoypadConditioning::stick(Joypad::STICK_POSITION stick, short x, short y) {
+  const auto &tables = stick_tables[stick][active_stick[stick]];
+  auto &[smoothed_x, smoothed_y] = smoothed[stick];
+  last[stick] = {x, y};
+  if (!tables.enabled) {
+    smoothed_x = x;
+    smoothed_y = y;
+    update_settling();
+    return {x, y};
+  }
+
+  smoothed_x = smooth(smoothed_x, x, tables.smoothing);
+  smoothed_y = smooth(smoothed_y, y, tables.smoothing);
+  update_settling();
+  auto value_x = to_short(smoothed_x);
+  auto value_y = to_short(smoothed_y);
+
+  if (tables.deadzone_type == StickConditioning::AXIAL) {
+    return {tables.axial[value_x + 32768], tables.axial[value_y + 32768]};
+  }
+
+  auto magnitude = static_cast<std::uint32_t>(value_x * value_x) + static_cast<std::uint32_t>(value_y * value_y);
+  auto gain = tables.radial[magnitude >> StickTables::RADIAL_SHIFT];
+  return {to_short(value_x * gain), to_short(value_y * gain)};
+}
+
+std::pair<std::int16_t, std::int16_t> JoypadConditioning::triggers(std::int16_t left, std::int16_t right) const {
+  const auto &tables = trigger_tables[active_trigger];
+  if (!tables.enabled) {
+    return {left, right};
+  }
+  return {tables.values[std::clamp<std::int16_t>(left, 0, 255)],
+          tables.values[std::clamp<std::int16_t>(right, 0, 255)]};
+}
+
+void JoypadConditioning::reset() {
+  smoothed = {};
+  last = {};
+  unsettled = false;
+}
+
+std::pair<short, short> JoypadConditioning::last_stick(Joypad::STICK_POSITION stick) const {
+  return {last[stick][0], last[stick][1]};
+}
+
+bool JoypadConditioning::settling(Joypad::STICK_POSITION stick) const {
+  return smoothed[stick][0] != last[stick][0] || smoothed[stick][1] != last[stick][1];
+}
+
+void JoypadConditioning::update_settling() {
+  bool settling_now = settling(Joypad::LS) || settling(Joypad::RS);
+  if (settling_now == unsettled.load(std::memory_order_relaxed)) {
+    return;
+  }
+  if (settling_now) { // Once per movement: only here we have to wake up the settle thread
+    {
+      std::lock_guard<std::mutex> lock(settle_m);
+      unsettled = true;
+    }
+    settle_cv.notify_one();
+  } else {
+    unsettled = false; // At worst the settle thread calls `settle` once more
+  }
+}
+
+void JoypadConditioning::on_settle(const std::function<void()> &settle) {
+  std::lock_guard<std::mutex> lock(configure_m);
+  this->settle = settle;
+}
+
+void JoypadConditioning::settle_loop() {
+  apply_thread_config("stick");
+  std::unique_lock<std::mutex> lock(settle_m);
+  while (true) {
+    settle_cv.wait(lock, [this]() { return settle_stopping || unsettled; });
+    if (settle_cv.wait_for(lock, SETTLE_INTERVAL, [this]() { return settle_stopping; })) {
+      return;
+    }
+    lock.unlock();
+    settle();
+    lock.lock();
+  }
+}
+
+void JoypadConditioning::stop_settling() {
+  std::lock_guard<std::mutex> lock(configure_m);
+  {
+    std::lock_guard<std::mutex> settle_lock(settle_m);
+    settle_stopping = true;
+  }
+  settle_cv.notify_one();
+  if (settle_thread.joinable()) {
+    settle_thread.join();
+  }
+}
+
+JoypadConditioning::~JoypadConditioning() {
+  stop_settling();
+}
+
+Result<bool> JoypadConditioning::configure(SerialWriter &writer,
+                                           Joypad::STICK_POSITION stick,
+                                           const StickConditioning &conditioning) {
+  if (auto valid = validate(conditioning.deadzone, conditioning.anti_deadzone, conditioning.exponent); !valid) {
+    return valid;
+  }
+  if (!(conditioning.smoothing > 0.0f && conditioning.smoothing <= 1.0f)) {
+    return Error("Invalid smoothing " + std::to_string(conditioning.smoothing) + ", it must be in (0.0, 1.0]");
+  }
+
+  std::lock_guard<std::mutex> lock(configure_m);
+  int next = 1 - configured_stick[stick];
+  auto &tables = stick_tables[stick][next];
+  tables.enabled = conditioning.deadzone > 0.0f || conditioning.anti_deadzone > 0.0f || conditioning.exponent != 1.0f ||
+                   conditioning.curve || conditioning.smoothing < 1.0f;
+  tables.deadzone_type = conditioning.deadzone_type;
+  tables.smoothing = conditioning.smoothing;
+  auto conditioned = [&conditioning](float magnitude) {
+    return response(std::min(magnitude, 1.0f),
+                    conditioning.deadzone,
+                    conditioning.anti_deadzone,
+                    conditioning.exponent,
+                    conditioning.curve);
+  };
+
+  if (tables.enabled && conditioning.deadzone_type == StickConditioning::AXIAL) {
+    tables.axial.resize(65536);
+    for (int value = -32768; value <= 32767; value++) {
+      float magnitude = conditioned(std::abs(value) / AXIS_MAX);
+      tables.axial[value + 32768] = to_short(value < 0 ? -magnitude * AXIS_MAX : magnitude * AXIS_MAX);
+    }
+  } else if (tables.enabled) {
+    // Each entry covers a range of squared magnitudes: use the one in the middle, at 10% of the range the entries
+    // are ~20 units apart
+    tables.radial.resize(StickTables::RADIAL_SIZE);
+    for (std::size_t i = 0; i < tables.radial.size(); i++) {
+      float radius = std::sqrt((i + 0.5f) * (1u << StickTables::RADIAL_SHIFT));
+      tables.radial[i] = conditioned(radius / AXIS_MAX) * AXIS_MAX / radius;
+    }
+  }
+
+  configured_stick[stick] = next;
+  if (conditioning.smoothing < 1.0f && settle && !settle_thread.joinable()) {
+    std::lock_guard<std::mutex> settle_lock(settle_m);
+    if (!settle_stopping) {
+      settle_thread = std::thread(&JoypadConditioning::settle_loop, this);
+    }
+  }
+  writer.run([this, stick, next]() { active_stick[stick] = next; });
+  writer.flush();
+  return true;
+}
+
+Result<bool> JoypadConditioning::configure(SerialWriter &writer, const TriggerConditioning &conditioning) {
+  if (auto valid = validate(conditioning.deadzone, conditioning.anti_deadzone, conditioning.exponent); !valid) {
+    return valid;
+  }
+
+  std::lock_guard<std::mutex> lock(configure_m);
+  int next = 1 - configured_trigger;
+  auto &tables = trigger_tables[next];
+  tables.enabled = conditioning.deadzone > 0.0f || conditioning.anti_deadzone > 0.0f || conditioning.exponent != 1.0f ||
+                   conditioning.curve;
+  for (int value = 0; value <= 255; value++) {
+    auto magnitude = response(value / TRIGGER_MAX,
+                              conditioning.deadzone,
+                              conditioning.anti_deadzone,
+                              conditioning.exponent,
+                              conditioning.curve);
+    tables.values[value] = static_cast<std::uint8_t>(std::lround(magnitude * TRIGGER_MAX));
+  }
+
+  configured_trigger = next;
+  writer.run([this, next]() { active_trigger = next; });
+  writer.flush();
+  return true;
+}
+
+void JoypadConditioning::restore_defaults(SerialWriter &writer) {
+  configure(writer, Joypad::LS, StickConditioning{});
+  configure(writer, Joypad::RS, StickConditioning{});
+  configure(writer, TriggerConditioning{});
+}
+
+} // namespace inputtino
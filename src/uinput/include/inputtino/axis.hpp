@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace inputtino {
+
+/**
+ * Conversions from the values that we get from the clients (int16 sticks, normalised floats, degrees, pixels) to the
+ * units of the virtual devices.
+ * They are all exact: they return the same results as the floating point formulas that they replace
+ * (see testAxis.cpp), without any libm call. The batch variants are plain loops that the compiler can vectorise.
+ */
+
+/**
+ * A stick axis [-32768, 32767] to a PS5 byte [0, 255], same as `std::round((value + 32768) * 255.0 / 65535)`.
+ * The slope is exactly 1/257; since 257 is odd we are never half way between two results, so an integer division is
+ * enough.
+ */
+constexpr std::uint8_t stick_to_ps5(std::int16_t value) {
+  return static_cast<std::uint8_t>((value + 32768 + 128) / 257);
+}
+
+inline void stick_to_ps5(const std::int16_t *values, std::uint8_t *out, std::size_t count) {
+  for (std::size_t i = 0; i < count; i++) {
+    out[i] = stick_to_ps5(values[i]);
+  }
+}
+
+/**
+ * A trigger [0, 255] to a PS5 byte, out of range values are clamped
+ */
+constexpr std::uint8_t trigger_to_ps5(std::int16_t value) {
+  return static_cast<std::uint8_t>(std::clamp<std::int16_t>(value, 0, 255));
+}
+
+/**
+ * A normalised value (ex: [0.0, 1.0]) to the device units [0, max], same as `std::lround(max * value)`.
+ * The float product is rounded half away from zero; adding 0.5 to a float is exact in double precision, so truncating
+ * the sum gives the same result as lround().
+ * NaN gives 0, results out of the int range are saturated.
+ */
+constexpr int to_device_units(float value, int max) {
+  float scaled = max * value;
+  if (scaled != scaled) { // NaN
+    return 0;
+  }
+  double rounded = scaled < 0 ? static_cast<double>(scaled) - 0.5 : static_cast<double>(scaled) + 0.5;
+  return static_cast<int>(std::clamp(rounded, static_cast<double>(INT32_MIN), static_cast<double>(INT32_MAX)));
+}
+
+inline void to_device_units(const float *values, int *out, std::size_t count, int max) {
+  for (std::size_t i = 0; i < count; i++) {
+    out[i] = to_device_units(values[i], max);
+  }
+}
+
+/**
+ * Pen tilt in degrees, clamped to [-90, 90], to ABS_TILT units (`resolution` units per radian); NaN gives 0
+ */
+constexpr int tilt_to_device_units(float degrees, int resolution) {
+  float scaled = std::clamp(degrees, -90.0f, 90.0f) * resolution;
+  return to_device_units(static_cast<float>(M_PI * scaled / 180.0), 1);
+}
+
+/**
+ * A motion sensor value to the PS5 int16 units; `scale` is the whole conversion factor (see PS5Joypad::set_motion()).
+ * Truncated like a cast, saturated to the int16 range; NaN gives 0.
+ */
+constexpr std::int16_t motion_to_ps5(float value, float scale) {
+  float scaled = value * scale;
+  if (scaled != scaled) { // NaN
+    return 0;
+  }
+  return static_cast<std::int16_t>(std::clamp(scaled, -32768.0f, 32767.0f));
+}
+
+/**
+ * `value` in [0, range] to [0, max], rounded to the nearest integer (half away from zero); `range` must be > 0.
+ * Integer only: there's no intermediate rounding, ex: 1280 pixels to 19200 units is exactly 15 units per pixel.
+ */
+constexpr int scale_to_range(int value, int range, int max) {
+  auto scaled = static_cast<std::int64_t>(value) * max * 2;
+  auto half = scaled < 0 ? -static_cast<std::int64_t>(range) : range;
+  return static_cast<int>((scaled + half) / (2 * static_cast<std::int64_t>(range)));
+}
+
+/**
+ * Batch kernels, meant for high rate touch, pen and motion samples.
+ * They use AVX2 or SSE2 (picked at runtime, see get_simd_level()) and fall back to plain loops otherwise; the results
+ * are always the same as the scalar versions above, NaN and out of range values included.
+ */
+
+/* `count` frames of 4 channels (ex: {x, y, pressure, distance}), `max` has one entry per channel */
+void to_device_units(const float *frames, int *out, std::size_t count, const std::array<int, 4> &max);
+
+void tilt_to_device_units(const float *degrees, int *out, std::size_t count, int resolution);
+
+/* `count` samples of 6 channels ({accel x, y, z, gyro x, y, z}), `scale` has one entry per channel */
+void motion_to_ps5(const float *samples, std::int16_t *out, std::size_t count, const std::array<float, 6> &scale);
+
+enum class SimdLevel {
+  SCALAR,
+  SSE2,
+  AVX2
+};
+
+/* Defaults to the best level supported by the CPU */
+SimdLevel get_simd_level();
+
+/* Mostly for tests and benchmarks: levels above what the CPU supports are capped, returns the level in use */
+SimdLevel set_simd_level(SimdLevel level);
+
+} // namespace inputtino
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <inputtino/input.hpp>
+#include <inputtino/serial_writer.hpp>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace inputtino {
+
+/**
+ * The lookup tables built from a StickConditioning
+ */
+struct StickTables {
+  bool enabled = false;
+  StickConditioning::DEADZONE_TYPE deadzone_type = StickConditioning::RADIAL;
+  /* AXIAL: the conditioned value for each input, indexed by `value + 32768` */
+  std::vector<std::int16_t> axial;
+  /* RADIAL: the gain to apply to both axes, indexed by `(x * x + y * y) >> RADIAL_SHIFT` */
+  std::vector<float> radial;
+  /* The weight of the new sample, 1.0 disables the smoothing */
+  float smoothing = 1.0f;
+
+  static constexpr int RADIAL_SHIFT = 17;
+  static constexpr std::size_t RADIAL_SIZE = ((2u * 32768 * 32768) >> RADIAL_SHIFT) + 1;
+};
+
+struct TriggerTables {
+  bool enabled = false;
+  /* The conditioned value for each input in [0, 255] */
+  std::array<std::uint8_t, 256> values = {};
+};
+
+/**
+ * The stick and trigger conditioning of a joypad.
+ *
+ * Every table is double buffered: `configure()` builds the new one in the buffer that isn't in use and then asks the
+ * writer to switch to it, so `stick()` and `triggers()` (which only run on the writer) never wait.
+ * Buffers are allocated the first time that they are needed and then reused.
+ *
+ * Clients only send the sticks when they move: while the smoothing hasn't caught up with the last values, the
+ * `settle` callback is called every SETTLE_INTERVAL from a thread of our own. It has to apply `last_stick()` again on
+ * the writer, so that a released stick gets back to the center.
+ */
+class JoypadConditioning {
+public:
+  static constexpr std::chrono::milliseconds SETTLE_INTERVAL{10};
+
+  ~JoypadConditioning();
+
+  /* Only called by the writer */
+  std::pair<short, short> stick(Joypad::STICK_POSITION stick, short x, short y);
+  std::pair<std::int16_t, std::int16_t> triggers(std::int16_t left, std::int16_t right) const;
+  /* Forgets the smoothed values, only called by the writer */
+  void reset();
+  /* The last values passed to stick(), only called by the writer */
+  std::pair<short, short> last_stick(Joypad::STICK_POSITION stick) const;
+  /* The smoothing hasn't reached last_stick() yet, only called by the writer */
+  bool settling(Joypad::STICK_POSITION stick) const;
+
+  /* Blocks until the writer is using the new tables */
+  Result<bool> configure(SerialWriter &writer, Joypad::STICK_POSITION stick, const StickConditioning &conditioning);
+  Result<bool> configure(SerialWriter &writer, const TriggerConditioning &conditioning);
+  /* Back to StickConditioning{} and TriggerConditioning{}, see Joypad::handover() */
+  void restore_defaults(SerialWriter &writer);
+
+  /* Set it before configuring any smoothing, the thread is only started once some smoothing is configured */
+  void on_settle(const std::function<void()> &settle);
+  /* Joins the settle thread: call it before the writer, or anything that `settle` uses, goes away */
+  void stop_settling();
+
+private:
+  void update_settling();
+  void settle_loop();
+
+  /* Indexed by STICK_POSITION, then by buffer */
+  std::array<std::array<StickTables, 2>, 2> stick_tables;
+  std::array<TriggerTables, 2> trigger_tables;
+
+  /* Only touched by the writer */
+  std::array<int, 2> active_stick = {0, 0};
+  int active_trigger = 0;
+  std::array<std::array<float, 2>, 2> smoothed = {};
+  std::array<std::array<short, 2>, 2> last = {};
+
+  /* Serialises configure() calls, guards the indexes below: the buffers that will be active once the writer has
+   * caught up */
+  std::mutex configure_m;
+  std::array<int, 2> configured_stick = {0, 0};
+  int configured_trigger = 0;
+
+  /* The settle thread sleeps until the writer sets `unsettled`, `settle_m` guards the transition to true */
+  std::function<void()> settle;
+  std::thread settle_thread;
+  std::mutex settle_m;
+  std::condition_variable settle_cv;
+  std::atomic<bool> unsettled = false;
+  bool settle_stopping = false;
+};
+
+} // namespace inputtino
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace inputtino {
+
+/**
+ * A counter that is bumped every time the kernel announces that an input or hidraw device has been added or removed.
+ *
+ * Uevents are read from a NETLINK_KOBJECT_UEVENT socket which is drained, without blocking, on each call:
+ * there's no thread involved.
+ *
+ * Returns std::nullopt until the first uevent has been received; this way, when uevents are not delivered to us
+ * (ex: a container in its own network namespace), callers will know that they can't rely on this.
+ */
+std::optional<std::uint64_t> hotplug_generation();
+
+/**
+ * Returns the device nodes (/dev/input/event*, /dev/input/js*, /dev/hidraw*) of the device at `syspath`
+ * and of all its children (ex: the input devices that the HID driver creates for a uhid device).
+ */
+std::vector<std::string> find_dev_nodes(const std::string &syspath);
+
+/**
+ * Caches the result of `discover()` until the next hotplug event, see `hotplug_generation()`
+ */
+class NodeCache {
+public:
+  template <typename Fn> std::vector<std::string> get(Fn &&discover) {
+    std::lock_guard<std::mutex> lock(m);
+    auto current = hotplug_generation(); // Before discovering: a device added in between will invalidate the result
+    if (!current || current != generation) {
+      nodes = discover();
+      // Nodes might still be on their way, don't cache an empty result
+      generation = nodes.empty() ? std::nullopt : current;
+    }
+    return nodes;
+  }
+
+private:
+  std::mutex m;
+  std::vector<std::string> nodes = {};
+  std::optional<std::uint64_t> generation = std::nullopt;
+};
+
+} // namespace inputtino
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <inputtino/input.hpp>
+
+namespace inputtino {
+
+/**
+ * Button remapping profiles, picked at compile time: define INPUTTINO_BUTTON_PROFILE (see the CMake option with the
+ * same name) to one of the profiles below to apply it to all the joypads.
+ *
+ * A profile swaps what the buttons sent by the client will do: `remap(A) == B` means that pressing A on the client
+ * will press B on the virtual joypad.
+ */
+struct DefaultButtonProfile {
+  static constexpr Joypad::CONTROLLER_BTN remap(Joypad::CONTROLLER_BTN button) {
+    return button;
+  }
+};
+
+/**
+ * Nintendo layout: A and B, X and Y are swapped
+ */
+struct SwapABXYButtonProfile {
+  static constexpr Joypad::CONTROLLER_BTN remap(Joypad::CONTROLLER_BTN button) {
+    switch (button) {
+    case Joypad::A:
+      return Joypad::B;
+    case Joypad::B:
+      return Joypad::A;
+    case Joypad::X:
+      return Joypad::Y;
+    case Joypad::Y:
+      return Joypad::X;
+    default:
+      return button;
+    }
+  }
+};
+
+#ifdef INPUTTINO_BUTTON_PROFILE
+using ButtonProfile = INPUTTINO_BUTTON_PROFILE;
+#else
+using ButtonProfile = DefaultButtonProfile;
+#endif
+
+/**
+ * A CONTROLLER_BTN and what it maps to on a specific backend: a Linux EV_KEY code (ex: BTN_SOUTH) or the position of
+ * a bit in a HID report
+ */
+struct ButtonMapping {
+  Joypad::CONTROLLER_BTN button;
+  int code;
+};
+
+/* Indexed by the position of the bit in CONTROLLER_BTN, -1 when the button isn't mapped */
+using ButtonTable = std::array<int, 32>;
+
+/**
+ * Builds the table for the buttons as they are sent by the client: `Profile` is applied here, at compile time.
+ */
+template <typename Profile = ButtonProfile, std::size_t N>
+constexpr ButtonTable make_button_table(const std::array<ButtonMapping, N> &mappings) {
+  ButtonTable table = {};
+  for (std::size_t bit = 0; bit < table.size(); bit++) {
+    auto button = Profile::remap(static_cast<Joypad::CONTROLLER_BTN>(1u << bit));
+    table[bit] = -1;
+    for (const auto &mapping : mappings) {
+      if (mapping.button == button) {
+        table[bit] = mapping.code;
+      }
+    }
+  }
+  return table;
+}
+
+/**
+ * Calls `fn(bit)` for each bit set in `bits`, lowest first
+ */
+template <typename Fn> inline void for_each_bit(std::uint32_t bits, Fn &&fn) {
+  for (; bits != 0; bits &= bits - 1) {
+    fn(__builtin_ctz(bits));
+  }
+}
+
+static constexpr int DPAD_MASK = Joypad::DPAD_UP | Joypad::DPAD_DOWN | Joypad::DPAD_LEFT | Joypad::DPAD_RIGHT;
+
+/**
+ * Where the dpad points, for each combination of the DPAD_* bits (the lowest 4 bits of CONTROLLER_BTN).
+ * When opposite directions are pressed at the same time UP and LEFT win.
+ */
+struct HatPosition {
+  std::int8_t x; // -1 left, 1 right
+  std::int8_t y; // -1 up, 1 down
+  /* HID hat switch: 0 = N, going clockwise up to 7 = NW, 8 = neutral */
+  std::uint8_t hid;
+};
+
+constexpr std::array<HatPosition, 16> make_hat_lut() {
+  std::array<HatPosition, 16> lut = {};
+  for (int dpad = 0; dpad < 16; dpad++) {
+    std::int8_t y = dpad & Joypad::DPAD_UP ? -1 : (dpad & Joypad::DPAD_DOWN ? 1 : 0);
+    std::int8_t x = dpad & Joypad::DPAD_LEFT ? -1 : (dpad & Joypad::DPAD_RIGHT ? 1 : 0);
+    // Indexed by [y + 1][x + 1]
+    constexpr std::uint8_t hid[3][3] = {{7, 0, 1}, {6, 8, 2}, {5, 4, 3}};
+    lut[dpad] = {x, y, hid[y + 1][x + 1]};
+  }
+  return lut;
+}
+
+static constexpr auto HAT_LUT = make_hat_lut();
+
+} // namespace inputtino
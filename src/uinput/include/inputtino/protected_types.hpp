@@ -1,70 +1,121 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstring>
+#include <inputtino/conditioning.hpp>
 #include <inputtino/input.hpp>
+#include <inputtino/seqlock.hpp>
+#include <inputtino/serial_writer.hpp>
+#include <inputtino/uinput.hpp>
 #include <iostream>
-#include <libevdev/libevdev-uinput.h>
-#include <libevdev/libevdev.h>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <thread>
+#include <uhid/keyboard.hpp>
 #include <unistd.h>
 
 namespace inputtino {
 
-using libevdev_uinput_ptr = std::shared_ptr<libevdev_uinput>;
-using libevdev_event_ptr = std::shared_ptr<input_event>;
-
 /**
- * Given a uinput fd will read all queued events available at this time up to max_events
+ * A non owning view over a contiguous sequence of events, can be used in range based for loops
  */
-static std::vector<libevdev_event_ptr> fetch_events(int uinput_fd, int max_events = 50) {
-  std::vector<libevdev_event_ptr> events = {};
-  struct input_event ev {};
-  int ret, read_events = 0;
-  while (read_events < max_events && (ret = read(uinput_fd, &ev, sizeof(ev))) == sizeof(ev)) {
-    events.push_back(std::make_shared<input_event>(ev));
-    read_events++;
+struct input_events_span {
+  const input_event *first = nullptr;
+  std::size_t count = 0;
+
+  const input_event *begin() const {
+    return first;
+  }
+
+  const input_event *end() const {
+    return first + count;
+  }
+
+  std::size_t size() const {
+    return count;
   }
-  if (ret < 0 && errno != EAGAIN) {
-    std::cerr << "Failed reading uinput fd; ret=" << strerror(errno);
-  } else if (ret > 0) {
+};
+
+/**
+ * Given a (non blocking) uinput fd will read all queued events available at this time, up to the size of `buffer`.
+ * uinput will hand us as many whole events as fit, so this is a single read() syscall and no allocations.
+ */
+template <std::size_t N> static input_events_span fetch_events(int uinput_fd, std::array<input_event, N> &buffer) {
+  auto ret = read(uinput_fd, buffer.data(), sizeof(input_event) * N);
+  if (ret < 0) {
+    if (errno != EAGAIN) {
+      std::cerr << "Failed reading uinput fd; ret=" << strerror(errno);
+    }
+    return {};
+  } else if (ret % sizeof(input_event) != 0) {
     std::cerr << "Uinput incorrect read size of " << ret;
   }
 
-  return events;
+  return {buffer.data(), static_cast<std::size_t>(ret) / sizeof(input_event)};
 }
 
 struct PenTabletState {
-  libevdev_uinput_ptr pen_tablet = nullptr;
+  /* All the changes to the device go through here, see VirtualDevice */
+  SerialWriter writer;
+  uinput_ptr pen_tablet = nullptr;
   PenTablet::TOOL_TYPE last_tool = PenTablet::SAME_AS_BEFORE;
 };
 
 struct BaseJoypadState {
-  libevdev_uinput_ptr joy = nullptr;
-  int currently_pressed_btns = 0;
+  /* All the changes to the joypad go through here, see VirtualDevice */
+  SerialWriter writer;
+  uinput_ptr joy = nullptr;
+  SeqLock<Joypad::Snapshot> snapshot;
+  JoypadConditioning conditioning;
 
-  bool stop_listening_events = false;
+  std::atomic<bool> stop_listening_events = false;
   std::thread events_thread;
+  /* Set by reset(), the events thread will stop all the playing effects */
+  std::atomic<bool> stop_rumble = false;
 
+  /* Callbacks are called from the events thread, they can be swapped at any time (see handover()) */
+  std::mutex callbacks_m;
   std::optional<std::function<void(int low_freq, int high_freq)>> on_rumble = std::nullopt;
+  std::optional<std::function<void(Joypad::FF_EVENT_TYPE type, const ff_effect &effect)>> on_ff_effect = std::nullopt;
 };
 
 struct XboxOneJoypadState : BaseJoypadState {};
 struct SwitchJoypadState : BaseJoypadState {};
 
 struct KeyboardState {
+  /* All the changes to the device go through here, see VirtualDevice */
+  SerialWriter writer;
   std::thread repeat_press_t;
-  bool stop_repeat_thread = false;
-  libevdev_uinput_ptr kb = nullptr;
+  std::atomic<bool> stop_repeat_thread = false;
+  uinput_ptr kb = nullptr;
   std::vector<short> cur_press_keys = {};
+
+  /* Only set when using the Keyboard::UHID backend, see uhid/keyboard.hpp */
+  std::shared_ptr<uhid::Device> nkro_kb = nullptr;
+  uhid::nkro_keyboard_report nkro_report = {};
 };
 
 struct MouseState {
-  libevdev_uinput_ptr mouse_rel = nullptr;
-  libevdev_uinput_ptr mouse_abs = nullptr;
+  /* All the changes to the device go through here, see VirtualDevice */
+  SerialWriter writer;
+  uinput_ptr mouse_rel = nullptr;
+  /* What's left of the fractional moves, always in (-1.0, 1.0); only touched by the writer */
+  float remainder_x = 0.0f;
+  float remainder_y = 0.0f;
+
+  /* Created lazily, see Mouse::create_abs_device() */
+  std::mutex mouse_abs_m;
+  uinput_ptr mouse_abs = nullptr;
+  /* Set when move_abs() fails to create it: it won't be tried again there, only by Mouse::create_abs_device() */
+  std::optional<std::string> mouse_abs_error = std::nullopt;
 };
 
 struct TouchScreenState {
-  libevdev_uinput_ptr touch_screen = nullptr;
+  /* All the changes to the device go through here, see VirtualDevice */
+  SerialWriter writer;
+  uinput_ptr touch_screen = nullptr;
 
   /**
    * Multi touch protocol type B is stateful; see: https://docs.kernel.org/input/multi-touch-protocol.html
@@ -86,7 +137,9 @@ struct TouchScreenState {
 };
 
 struct TrackpadState {
-  libevdev_uinput_ptr trackpad = nullptr;
+  /* All the changes to the device go through here, see VirtualDevice */
+  SerialWriter writer;
+  uinput_ptr trackpad = nullptr;
 
   /**
    * Multi touch protocol type B is stateful; see: https://docs.kernel.org/input/multi-touch-protocol.html
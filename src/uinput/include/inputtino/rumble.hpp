@@ -0,0 +1,392 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <linux/input.h>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace inputtino {
+
+struct RumbleSample {
+  std::uint16_t weak, strong;
+};
+
+/**
+ * Signed levels (-0x7FFF - 0x7FFF) are turned into a motor magnitude (0 - 0xFFFF), like ff-memless does
+ */
+static std::uint16_t rumble_level_to_magnitude(int level) {
+  return static_cast<std::uint16_t>(std::min(std::abs(level), 0x7FFF) * 0xFFFF / 0x7FFF);
+}
+
+/**
+ * An FF effect compiled at upload time into tables of sampled magnitudes.
+ * Playing it back is just a lookup, no matter how complex the original effect was.
+ *
+ * Periodic effects can oscillate much faster than the step that we can afford over their whole length: only one period
+ * of the waveform and the attack and fade of the envelope are sampled, they are combined in `at()`.
+ */
+struct RumbleTable {
+  /* Upper bound to the number of samples in each table, long effects will be sampled with a coarser step */
+  static constexpr std::size_t MAX_SAMPLES = 1024;
+
+  std::chrono::milliseconds delay{0};
+  std::chrono::milliseconds length{0}; // 0 means that the effect will play until stopped
+  std::chrono::milliseconds step{1};
+  /* (weak, strong) over the whole effect sampled every `step`, infinite effects hold the last sample. Unused for
+   * FF_PERIODIC */
+  std::vector<RumbleSample> samples;
+
+  struct Periodic {
+    std::chrono::milliseconds period{0};
+    std::chrono::milliseconds period_step{1};
+    std::vector<float> waveform; // One period (phase included) between -1 and 1, sampled every `period_step`
+    int offset = 0;
+
+    int magnitude = 0; // The amplitude outside of the attack and the fade
+    /* The amplitude during the attack and the fade (only for finite effects) */
+    std::chrono::milliseconds attack_length{0}, attack_step{1};
+    std::vector<int> attack;
+    std::chrono::milliseconds fade_start{0}, fade_step{1};
+    std::vector<int> fade;
+  };
+  std::optional<Periodic> periodic;
+
+  /**
+   * @param t: time elapsed since the effect started playing (delay included)
+   */
+  RumbleSample at(std::chrono::milliseconds t) const {
+    if (t < delay) {
+      return {0, 0}; // needs to be delayed
+    }
+    auto elapsed = t - delay;
+    if (periodic) {
+      return periodic_at(*periodic, elapsed);
+    }
+    if (samples.empty()) {
+      return {0, 0};
+    }
+    auto idx = std::min(static_cast<std::size_t>(elapsed / step), samples.size() - 1);
+    return samples[idx];
+  }
+
+  /**
+   * Returns true when a finite effect has played for its whole length
+   */
+  bool ended(std::chrono::milliseconds t) const {
+    return length.count() != 0 && t >= delay + length;
+  }
+
+private:
+  RumbleSample periodic_at(const Periodic &p, std::chrono::milliseconds elapsed) const {
+    int amplitude = p.magnitude;
+    if (elapsed < p.attack_length && !p.attack.empty()) {
+      amplitude = p.attack[std::min(static_cast<std::size_t>(elapsed / p.attack_step), p.attack.size() - 1)];
+    } else if (!p.fade.empty() && elapsed > p.fade_start) {
+      auto idx = static_cast<std::size_t>((elapsed - p.fade_start) / p.fade_step);
+      amplitude = p.fade[std::min(idx, p.fade.size() - 1)];
+    }
+    auto position = p.period.count() ? static_cast<std::size_t>((elapsed % p.period) / p.period_step) : 0;
+    auto level = p.offset + static_cast<int>(amplitude * p.waveform[position]);
+    auto magnitude = rumble_level_to_magnitude(std::clamp(level, -0x7FFF, 0x7FFF));
+    return {magnitude, magnitude};
+  }
+};
+
+/**
+ * Same as `apply_envelope()` in drivers/input/ff-memless.c:
+ * the envelope level is linearly interpolated towards `level` during the attack and the fade
+ *
+ * @param t: ms since the effect started, @param length: 0 for infinite effects (they never fade)
+ */
+static int rumble_apply_envelope(int level, const ff_envelope &envelope, int t, int length) {
+  int envelope_level, time_from_level, time_of_envelope;
+  if (envelope.attack_length && t < envelope.attack_length) {
+    envelope_level = envelope.attack_level;
+    time_from_level = t;
+    time_of_envelope = envelope.attack_length;
+  } else if (envelope.fade_length && length && t > length - envelope.fade_length && t < length) {
+    envelope_level = envelope.fade_level;
+    time_from_level = length - t;
+    time_of_envelope = envelope.fade_length;
+  } else {
+    return level;
+  }
+
+  int difference = (std::abs(level) - envelope_level) * time_from_level / time_of_envelope;
+  return level < 0 ? -(difference + envelope_level) : (difference + envelope_level);
+}
+
+/**
+ * Samples one period of a periodic waveform
+ *
+ * @param position: 0 - 0xFFFF, the position inside the period
+ * @return a value between -1 and 1
+ */
+static double rumble_waveform(std::uint16_t waveform, std::uint32_t position) {
+  auto x = static_cast<double>(position & 0xFFFF) / 0x10000;
+  switch (waveform) {
+  case FF_SQUARE:
+    return x < 0.5 ? 1.0 : -1.0;
+  case FF_TRIANGLE:
+    return 1.0 - 4.0 * std::abs(x - 0.5);
+  case FF_SINE:
+    return std::sin(2 * M_PI * x);
+  case FF_SAW_UP:
+    return 2.0 * x - 1.0;
+  case FF_SAW_DOWN:
+    return 1.0 - 2.0 * x;
+  default: // FF_CUSTOM is not supported, play it as a constant effect
+    return 1.0;
+  }
+}
+
+/**
+ * The magnitude of `effect` after `t` ms of playback (delay excluded)
+ */
+static RumbleSample rumble_sample(const ff_effect &effect, int t) {
+  int length = effect.replay.length;
+  switch (effect.type) {
+  case FF_RUMBLE:
+    return {effect.u.rumble.weak_magnitude, effect.u.rumble.strong_magnitude};
+  case FF_CONSTANT: {
+    auto level = rumble_apply_envelope(effect.u.constant.level, effect.u.constant.envelope, t, length);
+    auto magnitude = rumble_level_to_magnitude(level);
+    return {magnitude, magnitude};
+  }
+  case FF_RAMP: {
+    int level = effect.u.ramp.start_level;
+    if (length) {
+      level += (effect.u.ramp.end_level - effect.u.ramp.start_level) * t / length;
+    }
+    auto magnitude = rumble_level_to_magnitude(rumble_apply_envelope(level, effect.u.ramp.envelope, t, length));
+    return {magnitude, magnitude};
+  }
+  case FF_PERIODIC: {
+    const auto &periodic = effect.u.periodic;
+    auto amplitude = rumble_apply_envelope(periodic.magnitude, periodic.envelope, t, length);
+    // phase is expressed as a fraction of the period: 0x10000 is a full period
+    auto position = periodic.period ? (static_cast<std::uint32_t>(t % periodic.period) * 0x10000 / periodic.period +
+                                       periodic.phase)
+                                    : 0;
+    auto level = periodic.offset + static_cast<int>(amplitude * rumble_waveform(periodic.waveform, position));
+    auto magnitude = rumble_level_to_magnitude(std::clamp(level, -0x7FFF, 0x7FFF));
+    return {magnitude, magnitude};
+  }
+  default: // Conditional effects (spring, friction, ...) need a position, we can't simulate them with a rumble
+    return {0, 0};
+  }
+}
+
+/**
+ * The step needed to sample `length` ms with at most RumbleTable::MAX_SAMPLES samples
+ */
+static int rumble_step(int length) {
+  return std::max<int>(1, (length + RumbleTable::MAX_SAMPLES - 1) / RumbleTable::MAX_SAMPLES);
+}
+
+static void compile_periodic_effect(const ff_effect &effect, int length, RumbleTable &table) {
+  const auto &periodic = effect.u.periodic;
+  const auto &envelope = periodic.envelope;
+  RumbleTable::Periodic compiled;
+  compiled.offset = periodic.offset;
+  compiled.magnitude = periodic.magnitude;
+
+  // The step is at most a 1/MAX_SAMPLES of the period, fast waveforms are never aliased
+  compiled.period = std::chrono::milliseconds{periodic.period};
+  auto period_step = rumble_step(periodic.period);
+  compiled.period_step = std::chrono::milliseconds{period_step};
+  compiled.waveform.resize(std::max<std::size_t>(1, (periodic.period + period_step - 1) / period_step));
+  for (std::size_t i = 0; i < compiled.waveform.size(); i++) {
+    // phase is expressed as a fraction of the period: 0x10000 is a full period
+    auto position = periodic.period ? static_cast<std::uint32_t>(i * period_step) * 0x10000 / periodic.period +
+                                          periodic.phase
+                                    : 0;
+    compiled.waveform[i] = static_cast<float>(rumble_waveform(periodic.waveform, position));
+  }
+
+  // The envelope is linear, a coarser step is fine here
+  int attack_length = std::min<int>(envelope.attack_length, 32767);
+  auto attack_step = rumble_step(attack_length);
+  compiled.attack_length = std::chrono::milliseconds{attack_length};
+  compiled.attack_step = std::chrono::milliseconds{attack_step};
+  compiled.attack.resize((attack_length + attack_step - 1) / attack_step);
+  for (std::size_t i = 0; i < compiled.attack.size(); i++) {
+    auto t = static_cast<int>(i) * attack_step;
+    compiled.attack[i] = rumble_apply_envelope(periodic.magnitude, envelope, t, length);
+  }
+
+  int fade_length = length ? std::min<int>(envelope.fade_length, length) : 0;
+  auto fade_step = rumble_step(fade_length);
+  compiled.fade_start = std::chrono::milliseconds{length - fade_length};
+  compiled.fade_step = std::chrono::milliseconds{fade_step};
+  compiled.fade.resize((fade_length + fade_step - 1) / fade_step);
+  for (std::size_t i = 0; i < compiled.fade.size(); i++) {
+    auto t = length - fade_length + static_cast<int>(i) * fade_step;
+    compiled.fade[i] = rumble_apply_envelope(periodic.magnitude, envelope, t, length);
+  }
+
+  table.step = std::chrono::milliseconds{1};
+  table.samples.clear();
+  table.periodic = std::move(compiled);
+}
+
+/**
+ * Samples `effect` into a RumbleTable.
+ * This is where all the work happens: envelopes, ramps and periodic waveforms are only evaluated here.
+ */
+static void compile_rumble_effect(const ff_effect &effect, RumbleTable &table) {
+  // All duration values are expressed in ms. Values above 32767 ms (0x7fff) should not be used
+  int length = std::clamp(effect.replay.length, (__u16)0, (__u16)32767);
+  table.delay = std::chrono::milliseconds{std::clamp(effect.replay.delay, (__u16)0, (__u16)32767)};
+  table.length = std::chrono::milliseconds{length};
+
+  if (effect.type == FF_PERIODIC) {
+    compile_periodic_effect(effect, length, table);
+    return;
+  }
+
+  int sampled_length = length; // The amount of time covered by the table
+  if (effect.type == FF_RUMBLE) {
+    sampled_length = 1; // Constant for the whole duration, a single sample is enough
+  } else if (length == 0) {
+    // After the attack an infinite effect is constant
+    const ff_envelope *envelope = nullptr;
+    switch (effect.type) {
+    case FF_CONSTANT:
+      envelope = &effect.u.constant.envelope;
+      break;
+    case FF_RAMP:
+      envelope = &effect.u.ramp.envelope;
+      break;
+    }
+    sampled_length = (envelope ? envelope->attack_length : 0) + 1;
+  }
+
+  auto step = rumble_step(sampled_length);
+  auto nr_samples = static_cast<std::size_t>((sampled_length + step - 1) / step);
+  table.step = std::chrono::milliseconds{step};
+  table.periodic.reset();
+  table.samples.resize(nr_samples);
+  for (std::size_t i = 0; i < nr_samples; i++) {
+    table.samples[i] = rumble_sample(effect, static_cast<int>(i) * step);
+  }
+}
+
+/**
+ * Keeps track of all the FF effects uploaded to a device and mixes the ones that are currently playing
+ * into a single (weak, strong) rumble output.
+ *
+ * Effects are stored in a fixed table indexed by the effect id assigned by the kernel and compiled into a RumbleTable
+ * on upload; contributions are summed, scaled by the device gain (FF_GAIN) and clamped.
+ */
+class RumbleMixer {
+public:
+  /* The kernel will assign ids in the range [0, ff_effects_max) */
+  static constexpr int MAX_EFFECTS = 16;
+  static constexpr std::uint32_t MAX_MAGNITUDE = 0xFFFF;
+
+  /**
+   * Returns false if the effect id is out of range
+   */
+  bool upload(const ff_effect &effect) {
+    if (effect.id < 0 || effect.id >= MAX_EFFECTS) {
+      return false;
+    }
+    auto &slot = slots[effect.id];
+    slot.uploaded = true;
+    slot.effect = effect;
+    compile_rumble_effect(effect, slot.table);
+    return true;
+  }
+
+  void erase(int effect_id) {
+    if (effect_id >= 0 && effect_id < MAX_EFFECTS) {
+      slots[effect_id] = {};
+    }
+  }
+
+  /**
+   * Returns the uploaded effect with the given id, nullptr if there's none
+   */
+  const ff_effect *effect(int effect_id) const {
+    if (effect_id >= 0 && effect_id < MAX_EFFECTS && slots[effect_id].uploaded) {
+      return &slots[effect_id].effect;
+    }
+    return nullptr;
+  }
+
+  /**
+   * @param gain A value between 0 and 0xFFFF, applies to all effects
+   */
+  void set_gain(int gain) {
+    this->gain = std::clamp(gain, 0, static_cast<int>(MAX_MAGNITUDE));
+  }
+
+  void play(int effect_id, const std::chrono::steady_clock::time_point &now) {
+    if (effect_id >= 0 && effect_id < MAX_EFFECTS && slots[effect_id].uploaded) {
+      auto &slot = slots[effect_id];
+      slot.playing = true;
+      slot.start_point = now;
+    }
+  }
+
+  void stop(int effect_id) {
+    if (effect_id >= 0 && effect_id < MAX_EFFECTS) {
+      slots[effect_id].playing = false;
+    }
+  }
+
+  bool playing(int effect_id) const {
+    return effect_id >= 0 && effect_id < MAX_EFFECTS && slots[effect_id].playing;
+  }
+
+  /**
+   * Mixes all the effects that are playing at `now`.
+   * Returns the new (weak, strong) output only if it's different from what was returned last time.
+   */
+  std::optional<std::pair<std::uint32_t, std::uint32_t>> tick(const std::chrono::steady_clock::time_point &now) {
+    std::uint64_t weak = 0, strong = 0;
+    for (auto &slot : slots) {
+      if (!slot.playing) {
+        continue;
+      }
+      auto t = std::chrono::duration_cast<std::chrono::milliseconds>(now - slot.start_point);
+      if (slot.table.ended(t)) {
+        slot.playing = false;
+        continue;
+      }
+      auto sample = slot.table.at(t);
+      weak += sample.weak;
+      strong += sample.strong;
+    }
+
+    std::pair<std::uint32_t, std::uint32_t> output = {
+        static_cast<std::uint32_t>(std::min<std::uint64_t>(weak * gain / MAX_MAGNITUDE, MAX_MAGNITUDE)),
+        static_cast<std::uint32_t>(std::min<std::uint64_t>(strong * gain / MAX_MAGNITUDE, MAX_MAGNITUDE))};
+    if (output == last_output) {
+      return std::nullopt;
+    }
+    last_output = output;
+    return output;
+  }
+
+private:
+  struct Slot {
+    bool uploaded = false;
+    bool playing = false;
+    ff_effect effect = {};
+    RumbleTable table = {};
+    std::chrono::steady_clock::time_point start_point = {};
+  };
+
+  std::array<Slot, MAX_EFFECTS> slots = {};
+  std::uint32_t gain = MAX_MAGNITUDE;
+  std::pair<std::uint32_t, std::uint32_t> last_output = {0, 0};
+};
+
+} // namespace inputtino
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace inputtino {
+
+/**
+ * A sequence lock: a single writer publishes a small, trivially copyable, value and any number of readers can take
+ * consistent snapshots of it without ever blocking the writer.
+ *
+ * Readers retry when the value has been updated while they were copying it.
+ * The value is stored as relaxed atomic words, so that concurrent reads and writes are not a data race.
+ */
+template <typename T> class SeqLock {
+  static_assert(std::is_trivially_copyable_v<T>, "SeqLock values are copied around byte by byte");
+
+public:
+  SeqLock() {
+    write([](T &) {}); // publish the initial value
+  }
+
+  /**
+   * Calls `fn(T &value)` and publishes the updated value.
+   * There must be a single writer at any time (see SerialWriter).
+   */
+  template <typename Fn> void write(Fn &&fn) {
+    fn(value);
+
+    auto seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed); // odd: write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::array<std::uint64_t, WORDS> buffer = {};
+    std::memcpy(buffer.data(), &value, sizeof(T));
+    for (std::size_t i = 0; i < WORDS; i++) {
+      words[i].store(buffer[i], std::memory_order_relaxed);
+    }
+
+    sequence.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * The current value, only meant to be used by the writer
+   */
+  const T &current() const {
+    return value;
+  }
+
+  /**
+   * A consistent snapshot of the last published value, can be called from any thread
+   */
+  T read() const {
+    std::array<std::uint64_t, WORDS> buffer = {};
+    while (true) {
+      auto before = sequence.load(std::memory_order_acquire);
+      if (before & 1) {
+        std::this_thread::yield();
+        continue;
+      }
+
+      for (std::size_t i = 0; i < WORDS; i++) {
+        buffer[i] = words[i].load(std::memory_order_relaxed);
+      }
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence.load(std::memory_order_relaxed) == before) {
+        break;
+      }
+    }
+
+    T result = {};
+    std::memcpy(static_cast<void *>(&result), buffer.data(), sizeof(T));
+    return result;
+  }
+
+private:
+  static constexpr std::size_t WORDS = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+  std::atomic<std::uint64_t> sequence = 0;
+  std::array<std::atomic<std::uint64_t>, WORDS> words = {};
+
+  /* The writer's own copy */
+  T value = {};
+};
+
+} // namespace inputtino
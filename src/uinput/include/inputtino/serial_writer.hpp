@@ -0,0 +1,267 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <inputtino/threads.hpp>
+#include <inputtino/uinput.hpp>
+#include <iostream>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+#include <type_traits>
+
+namespace inputtino {
+
+/**
+ * Runs the commands submitted from any number of threads one at a time, so that they can freely mutate the state of
+ * a device without any further synchronisation: at any time there's a single writer.
+ *
+ * By default there's no dedicated thread: this is flat combining. The caller that finds the writer idle becomes the
+ * combiner and runs, in order, all the queued commands and then its own one. Callers that find it busy push their
+ * command on a lock-free MPSC ring and return straight away; it'll be run by the current combiner.
+ * After `start_thread()` every command is pushed on the ring instead, and a dedicated thread runs them: callers never
+ * perform any I/O.
+ *
+ * Commands are small lambdas stored inline in the ring (nothing is allocated): they must be trivially copyable and
+ * fit in `COMMAND_SIZE`. Commands submitted by the same thread are run in order, but they might run after `run()` has
+ * returned: they must capture by value.
+ * uinput frames written by queued commands are batched together, see UinputBatch.
+ */
+class SerialWriter {
+public:
+  static constexpr std::size_t COMMAND_SIZE = 48;
+  static constexpr std::size_t RING_SIZE = 128;
+
+  SerialWriter() {
+    for (std::size_t i = 0; i < RING_SIZE; i++) {
+      ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  SerialWriter(const SerialWriter &) = delete;
+  SerialWriter &operator=(const SerialWriter &) = delete;
+
+  ~SerialWriter() {
+    if (thread.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(wakeup_m);
+        stopping = true;
+      }
+      wakeup.notify_one();
+      thread.join();
+    }
+  }
+
+  template <typename Fn> void run(Fn &&command) {
+    using Command = std::decay_t<Fn>;
+    static_assert(sizeof(Command) <= COMMAND_SIZE, "Commands must fit in a ring slot, capture less");
+    static_assert(std::is_trivially_copyable_v<Command> && std::is_trivially_destructible_v<Command>,
+                  "Commands are copied byte by byte into the ring, capture by value");
+
+    if (!async.load(std::memory_order_relaxed) && try_lock()) {
+      drain(); // Commands queued before this one go first
+      command();
+      unlock();
+      combine();
+      return;
+    }
+
+    while (!push(command)) { // The ring is full: help draining it
+      if (async.load(std::memory_order_relaxed)) {
+        wake_up();
+        std::this_thread::yield();
+      } else {
+        combine_or_yield();
+      }
+    }
+    pending.fetch_add(1);
+
+    if (async.load(std::memory_order_relaxed)) {
+      if (sleeping.load()) {
+        wake_up();
+      }
+    } else {
+      combine();
+    }
+  }
+
+  /**
+   * From now on, commands are only queued on the caller's thread and run by a dedicated thread.
+   * Multiple commands that have queued up while the thread was busy will be sent with a single write().
+   *
+   * @param cpu: pins the thread to the given CPU, -1 to use the CPUs of the ThreadConfig (see set_thread_config())
+   */
+  void start_thread(int cpu = -1) {
+    if (thread.joinable()) {
+      return;
+    }
+    thread = std::thread([this, cpu]() {
+      apply_thread_config("wr");
+      if (cpu >= 0) { // Overrides the CPUs of the ThreadConfig
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+          std::cerr << "Unable to pin the writer thread to CPU " << cpu << std::endl;
+        }
+      }
+      thread_loop();
+    });
+    async.store(true);
+  }
+
+  /**
+   * Blocks until all the submitted commands have been run; has to be called before tearing down the state that the
+   * commands are operating on.
+   */
+  void flush() {
+    while (true) {
+      if (try_lock()) {
+        drain();
+        unlock();
+        if (pending.load() <= 0) {
+          return;
+        }
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+private:
+  /**
+   * A slot of Dmitry Vyukov's bounded queue: `sequence` tells whether it's free to be written (== position) or it
+   * holds a command that is ready to be run (== position + 1)
+   */
+  struct alignas(64) Slot {
+    std::atomic<std::size_t> sequence;
+    void (*invoke)(void *command);
+    alignas(std::max_align_t) unsigned char command[COMMAND_SIZE];
+  };
+
+  std::array<Slot, RING_SIZE> ring;
+  alignas(64) std::atomic<std::size_t> enqueue_pos = 0;
+  /* Only touched while holding the lock */
+  std::size_t dequeue_pos = 0;
+
+  /* Commands queued and not yet run; incremented after the push, so it might go below 0 for a moment */
+  std::atomic<std::int64_t> pending = 0;
+  std::atomic<bool> busy = false;
+
+  /* Only used after start_thread() */
+  std::atomic<bool> async = false;
+  std::thread thread;
+  std::mutex wakeup_m;
+  std::condition_variable wakeup;
+  std::atomic<bool> sleeping = false;
+  bool stopping = false;
+
+  bool try_lock() {
+    return !busy.exchange(true);
+  }
+
+  void unlock() {
+    busy.store(false);
+  }
+
+  /**
+   * A command might have been pushed while we were releasing the lock, and its producer might've found it still
+   * taken: check again (both sides use sequentially consistent operations, one of them will see the other).
+   */
+  void combine() {
+    while (pending.load() > 0) {
+      if (!try_lock()) {
+        return; // The current combiner will take care of it
+      }
+      bool progress = drain();
+      unlock();
+      if (!progress) { // A producer is half way through a push, give it a chance to finish
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void combine_or_yield() {
+    if (try_lock()) {
+      drain();
+      unlock();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  bool drain() {
+    UinputBatch batch;
+    bool progress = false;
+    while (pop()) {
+      pending.fetch_sub(1);
+      progress = true;
+    }
+    return progress;
+  }
+
+  void thread_loop() {
+    while (true) {
+      if (pending.load() > 0) {
+        combine_or_yield();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(wakeup_m);
+      sleeping.store(true);
+      wakeup.wait(lock, [this]() { return stopping || pending.load() > 0; });
+      sleeping.store(false);
+      if (stopping) {
+        return;
+      }
+    }
+  }
+
+  void wake_up() {
+    std::lock_guard<std::mutex> lock(wakeup_m);
+    wakeup.notify_one();
+  }
+
+  template <typename Fn> bool push(Fn &command) {
+    using Command = std::decay_t<Fn>;
+    auto pos = enqueue_pos.load(std::memory_order_relaxed);
+    while (true) {
+      auto &slot = ring[pos % RING_SIZE];
+      auto sequence = slot.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          std::memcpy(slot.command, static_cast<const void *>(&command), sizeof(Command));
+          slot.invoke = [](void *command) { (*static_cast<Command *>(command))(); };
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * Only called while holding the lock. Runs the next command, returns false when the ring is empty or when the next
+   * command is still being pushed.
+   */
+  bool pop() {
+    auto &slot = ring[dequeue_pos % RING_SIZE];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+      return false;
+    }
+    slot.invoke(slot.command);
+    slot.sequence.store(dequeue_pos + RING_SIZE, std::memory_order_release);
+    dequeue_pos++;
+    return true;
+  }
+};
+
+} // namespace inputtino
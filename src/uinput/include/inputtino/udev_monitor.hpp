@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <inputtino/result.hpp>
+#include <inputtino/uinput.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace inputtino {
+
+/**
+ * The ID_INPUT_* properties that udev's `input_id` builtin would assign to a device with these capabilities,
+ * ex: {"ID_INPUT=1", "ID_INPUT_MOUSE=1"}
+ */
+std::vector<std::string> udev_input_properties(const UinputTemplate &capabilities);
+
+/**
+ * Reads back the capabilities of an input device (ex: /sys/devices/virtual/input/input42) from sysfs.
+ * Only the event types, codes and properties are filled in, not the ranges of the axes.
+ */
+UinputTemplate read_sysfs_capabilities(const std::string &syspath);
+
+/**
+ * MurmurHash2, used by libudev to filter monitor messages by subsystem, devtype and tags
+ */
+std::uint32_t udev_murmur_hash2(std::string_view data, std::uint32_t seed = 0);
+
+/**
+ * Builds a message in the format that libudev expects from udevd: a `libudev` header followed by the NUL separated
+ * `KEY=VALUE` properties.
+ *
+ * @param tags: used to fill in the tag bloom filter, they should also be listed in the TAGS property
+ */
+std::vector<char> udev_monitor_message(const std::vector<std::string> &properties,
+                                       const std::string &subsystem,
+                                       const std::string &devtype,
+                                       const std::vector<std::string> &tags);
+
+/**
+ * Sends `message` to the udev netlink group, where libudev monitors are listening
+ */
+Result<bool> udev_broadcast(const std::vector<char> &message);
+
+/**
+ * udevd is running when its control socket exists; a regular file in its place doesn't count
+ */
+bool is_udevd_running();
+
+} // namespace inputtino
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <inputtino/device_nodes.hpp>
+#include <inputtino/input.hpp>
+#include <inputtino/result.hpp>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace inputtino {
+
+/**
+ * A fixed size set of bits that can be built at compile time
+ */
+template <std::size_t BITS> struct Bitmap {
+  static constexpr std::size_t WORDS = (BITS + 63) / 64;
+  std::array<std::uint64_t, WORDS> words = {};
+
+  constexpr Bitmap &set(int bit) {
+    words[bit / 64] |= std::uint64_t{1} << (bit % 64);
+    return *this;
+  }
+
+  constexpr bool test(int bit) const {
+    return (words[bit / 64] >> (bit % 64)) & 1;
+  }
+
+  constexpr bool empty() const {
+    for (auto word : words) {
+      if (word != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Calls `fn(bit)` for each bit that is set, skipping over empty words
+   */
+  template <typename Fn> void for_each(Fn &&fn) const {
+    for (std::size_t i = 0; i < WORDS; i++) {
+      for (auto word = words[i]; word != 0; word &= word - 1) {
+        fn(static_cast<int>(i * 64 + __builtin_ctzll(word)));
+      }
+    }
+  }
+};
+
+/**
+ * The full set of capabilities of a uinput device: which events it can emit and the ranges of its axes.
+ *
+ * These are meant to be built at compile time (see the `*_template` constants in each device) and can be reused to
+ * create any number of identical devices.
+ */
+struct UinputTemplate {
+  Bitmap<KEY_CNT> keys = {};
+  Bitmap<REL_CNT> rels = {};
+  Bitmap<ABS_CNT> abs = {};
+  Bitmap<MSC_CNT> msc = {};
+  Bitmap<FF_CNT> ff = {};
+  Bitmap<INPUT_PROP_CNT> props = {};
+  std::array<input_absinfo, ABS_CNT> absinfo = {};
+
+  /* The maximum number of FF effects that can be uploaded at the same time, see RumbleMixer::MAX_EFFECTS */
+  std::uint32_t ff_effects_max = 0;
+
+  constexpr UinputTemplate &key(int code) {
+    keys.set(code);
+    return *this;
+  }
+
+  constexpr UinputTemplate &rel(int code) {
+    rels.set(code);
+    return *this;
+  }
+
+  constexpr UinputTemplate &abs_axis(int code, const input_absinfo &info) {
+    abs.set(code);
+    absinfo[code] = info;
+    return *this;
+  }
+
+  constexpr UinputTemplate &misc(int code) {
+    msc.set(code);
+    return *this;
+  }
+
+  constexpr UinputTemplate &force_feedback(int code, std::uint32_t max_effects) {
+    ff.set(code);
+    ff_effects_max = max_effects;
+    return *this;
+  }
+
+  constexpr UinputTemplate &property(int prop) {
+    props.set(prop);
+    return *this;
+  }
+};
+
+/**
+ * A device created through /dev/uinput, the device will be destroyed together with this object
+ */
+struct uinput_device {
+  int fd = -1;
+  std::string syspath; // ex: /sys/devices/virtual/input/input42
+  std::string devnode; // ex: /dev/input/event12
+  NodeCache nodes;     // devnode plus any other child (ex: /dev/input/js0), see uinput_get_nodes()
+  /* Never reused, unlike the address: events queued for a destroyed device can't end up on a new one */
+  const std::uint64_t generation;
+
+  uinput_device();
+  uinput_device(const uinput_device &) = delete;
+  uinput_device &operator=(const uinput_device &) = delete;
+  ~uinput_device();
+};
+
+using uinput_ptr = std::shared_ptr<uinput_device>;
+
+/**
+ * Creates a new device straight via the uinput ioctls (UI_SET_*BIT, UI_ABS_SETUP, UI_DEV_SETUP)
+ *
+ * @param name: overrides `device.name` when not null
+ */
+Result<uinput_ptr>
+create_uinput(const UinputTemplate &capabilities, const DeviceDefinition &device, const char *name = nullptr);
+
+/**
+ * Same as the kernel, the timestamp will be filled when the event is received.
+ *
+ * Events are queued up and sent with a single write() once the frame is complete (on SYN_REPORT); while a
+ * UinputBatch is alive on the current thread, whole frames are held back until the end of the batch instead.
+ * Until then the return value can only tell that the event has been queued.
+ *
+ * The queue is per thread: a frame has to be written from start to end on the same thread, different threads can
+ * write to the same device at the same time without corrupting each other's frames.
+ */
+int uinput_write_event(uinput_device *device, unsigned int type, unsigned int code, int value);
+
+/**
+ * Sends all the events queued on the current thread to the kernel with a single write()
+ */
+int uinput_flush(uinput_device *device);
+
+/**
+ * While alive, all the frames written on the current thread are queued up and only sent to the kernel when the
+ * batch goes away: consecutive commands (see SerialWriter) will cost a single write() per device.
+ * Batches can be nested, only the outermost one will flush. The devices must outlive the batch.
+ */
+class UinputBatch {
+public:
+  UinputBatch();
+  UinputBatch(const UinputBatch &) = delete;
+  UinputBatch &operator=(const UinputBatch &) = delete;
+  ~UinputBatch();
+
+private:
+  bool outermost = false;
+};
+
+static inline int uinput_get_fd(const uinput_device *device) {
+  return device->fd;
+}
+
+/* nullptr when the kernel hasn't given the device a node */
+static inline const char *uinput_get_devnode(const uinput_device *device) {
+  return device->devnode.empty() ? nullptr : device->devnode.c_str();
+}
+
+static inline const char *uinput_get_syspath(const uinput_device *device) {
+  return device->syspath.empty() ? nullptr : device->syspath.c_str();
+}
+
+/**
+ * All the device nodes that the kernel has created for this device, discovered once and cached until the next hotplug
+ */
+static inline std::vector<std::string> uinput_get_nodes(uinput_device *device) {
+  return device->nodes.get([device]() { return find_dev_nodes(device->syspath); });
+}
+
+} // namespace inputtino
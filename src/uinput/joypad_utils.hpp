@@ -2,9 +2,11 @@
 #include <chrono>
 #include <cstring>
 #include <fcntl.h>
-#include <filesystem>
 #include <inputtino/input.hpp>
+#include <inputtino/joypad_buttons.hpp>
 #include <inputtino/protected_types.hpp>
+#include <inputtino/rumble.hpp>
+#include <inputtino/threads.hpp>
 #include <iostream>
 #include <linux/input.h>
 #include <linux/uinput.h>
@@ -16,127 +18,106 @@ namespace inputtino {
 using namespace std::chrono_literals;
 
 /**
- * Joypads will also have one `/dev/input/js*` device as child, we want to expose that as well
+ * Callbacks are copied while holding `callbacks_m` and called after releasing it: they are free to call back into the
+ * joypad, even to swap the callbacks or to hand it over.
  */
-static std::vector<std::string> get_child_dev_nodes(libevdev_uinput *device) {
-  std::vector<std::string> result;
+template <typename Callback> static Callback get_callback(BaseJoypadState &state, const Callback &callback) {
+  std::lock_guard<std::mutex> lock(state.callbacks_m);
+  return callback;
+}
 
-  auto dev_path = libevdev_uinput_get_devnode(device);
-  if (dev_path) {
-    result.push_back(dev_path);
+/**
+ * Forwards the raw effect description to the `on_ff_effect` callback (if any), nothing is sent for unknown effects
+ */
+static void forward_ff_effect(BaseJoypadState &state, Joypad::FF_EVENT_TYPE type, const ff_effect *effect) {
+  if (!effect) {
+    return;
+  }
+  if (auto on_ff_effect = get_callback(state, state.on_ff_effect)) {
+    (*on_ff_effect)(type, *effect);
   }
+}
 
-  auto sys_path = libevdev_uinput_get_syspath(device);
-  if (sys_path) {
-    for (const auto &entry : std::filesystem::directory_iterator(sys_path)) {
-      if (entry.is_directory() && entry.path().filename().string().rfind("js", 0) == 0) { // starts with "js"?
-        result.push_back("/dev/input/" + entry.path().filename().string());
-      }
+/**
+ * Conditions and writes a stick position, only called by the writer
+ */
+static void write_stick(BaseJoypadState &state, Joypad::STICK_POSITION stick_type, short raw_x, short raw_y) {
+  auto [x, y] = state.conditioning.stick(stick_type, raw_x, raw_y);
+  if (auto controller = state.joy.get()) {
+    if (stick_type == Joypad::LS) {
+      uinput_write_event(controller, EV_ABS, ABS_X, x);
+      uinput_write_event(controller, EV_ABS, ABS_Y, -y);
+    } else {
+      uinput_write_event(controller, EV_ABS, ABS_RX, x);
+      uinput_write_event(controller, EV_ABS, ABS_RY, -y);
     }
-  }
 
-  return result;
+    uinput_write_event(controller, EV_SYN, SYN_REPORT, 0);
+  }
+  state.snapshot.write([stick_type, x = x, y = y](Joypad::Snapshot &snapshot) {
+    (stick_type == Joypad::LS ? snapshot.ls_x : snapshot.rs_x) = x;
+    (stick_type == Joypad::LS ? snapshot.ls_y : snapshot.rs_y) = y;
+  });
 }
 
-struct ActiveRumbleEffect {
-  int effect_id;
-
-  std::chrono::steady_clock::time_point start_point;
-  std::chrono::steady_clock::time_point end_point;
-  std::chrono::milliseconds length;
-  ff_envelope envelope;
-  struct {
-    std::uint32_t weak, strong;
-  } start;
-
-  struct {
-    std::uint32_t weak, strong;
-  } end;
-  int gain = 1;
-
-  std::pair<std::uint32_t, std::uint32_t> previous = {0, 0};
-};
-
-static std::uint32_t rumble_magnitude(std::chrono::milliseconds time_left,
-                                      std::uint32_t start,
-                                      std::uint32_t end,
-                                      std::chrono::milliseconds length) {
-  auto rel = end - start;
-  return start + (rel * time_left.count() / length.count());
+/**
+ * Moves the smoothed sticks one more step towards their last position, see JoypadConditioning::on_settle()
+ */
+static void settle_sticks(BaseJoypadState &state) {
+  state.writer.run([state = &state]() {
+    for (auto stick_type : {Joypad::LS, Joypad::RS}) {
+      if (state->conditioning.settling(stick_type)) {
+        auto [x, y] = state->conditioning.last_stick(stick_type);
+        write_stick(*state, stick_type, x, y);
+      }
+    }
+  });
 }
 
-static std::pair<std::uint32_t, std::uint32_t> simulate_rumble(const ActiveRumbleEffect &effect,
-                                                               const std::chrono::steady_clock::time_point &now) {
-  if (now < effect.start_point) {
-    return {0, 0}; // needs to be delayed
+/**
+ * Sets all the buttons and axes of the joypad to 0 in a single frame, the events thread will take care of stopping
+ * the rumble
+ */
+static void reset_joypad(BaseJoypadState &state, const UinputTemplate &capabilities) {
+  if (auto joy = state.joy.get()) {
+    capabilities.keys.for_each([joy](int code) { uinput_write_event(joy, EV_KEY, code, 0); });
+    capabilities.abs.for_each([joy](int code) { uinput_write_event(joy, EV_ABS, code, 0); });
+    uinput_write_event(joy, EV_SYN, SYN_REPORT, 0);
   }
+  state.snapshot.write([](Joypad::Snapshot &snapshot) { snapshot = {}; });
+  state.conditioning.reset();
+  state.stop_rumble = true;
+}
 
-  auto time_left = std::chrono::duration_cast<std::chrono::milliseconds>(effect.end_point - now);
-  auto t = effect.length - time_left;
-  std::uint32_t weak = 0, strong = 0;
-
-  if (t.count() < effect.envelope.attack_length) {
-    weak = (effect.envelope.attack_level * t.count() + weak * (effect.envelope.attack_length - t.count())) /
-           effect.envelope.attack_length;
-    strong = (effect.envelope.attack_level * t.count() + strong * (effect.envelope.attack_length - t.count())) /
-             effect.envelope.attack_length;
-  } else if (time_left.count() < effect.envelope.fade_length) {
-    auto dt = (t - effect.length).count() + effect.envelope.fade_length;
-
-    weak = (effect.envelope.fade_level * dt + weak * (effect.envelope.fade_length - dt)) / effect.envelope.fade_length;
-    strong = (effect.envelope.fade_level * dt + strong * (effect.envelope.fade_length - dt)) /
-             effect.envelope.fade_length;
-  } else {
-    weak = rumble_magnitude(t, effect.start.weak, effect.end.weak, effect.length);
-    strong = rumble_magnitude(t, effect.start.strong, effect.end.strong, effect.length);
+/**
+ * Writes the events for the buttons that have changed between `previous` and `pressed`, without the final SYN_REPORT.
+ * Only the changed bits are visited; the dpad is turned into the two hat axes, see HAT_LUT.
+ */
+static void write_buttons(uinput_device *joy, const ButtonTable &table, int previous, int pressed) {
+  auto changed = static_cast<std::uint32_t>(previous ^ pressed);
+  if (changed & DPAD_MASK) {
+    auto from = HAT_LUT[previous & DPAD_MASK];
+    auto to = HAT_LUT[pressed & DPAD_MASK];
+    if (from.y != to.y) {
+      uinput_write_event(joy, EV_ABS, ABS_HAT0Y, to.y);
+    }
+    if (from.x != to.x) {
+      uinput_write_event(joy, EV_ABS, ABS_HAT0X, to.x);
+    }
   }
 
-  weak = weak * effect.gain;
-  strong = strong * effect.gain;
-  return {weak, strong};
+  for_each_bit(changed & ~DPAD_MASK, [&](int bit) {
+    if (auto code = table[bit]; code >= 0) {
+      uinput_write_event(joy, EV_KEY, code, (pressed >> bit) & 1);
+    }
+  });
 }
 
-static ActiveRumbleEffect create_rumble_effect(int effect_id, int effect_gain, const ff_effect &effect) {
-  // All duration values are expressed in ms. Values above 32767 ms (0x7fff) should not be used
-  auto delay = std::chrono::milliseconds{std::clamp(effect.replay.delay, (__u16)0, (__u16)32767)};
-  auto length = std::chrono::milliseconds{std::clamp(effect.replay.length, (__u16)0, (__u16)32767)};
-  auto now = std::chrono::steady_clock::now();
-  ActiveRumbleEffect r_effect{.effect_id = effect_id,
-                              .start_point = now + delay,
-                              .end_point = now + delay + length,
-                              .length = length,
-                              .envelope = {},
-                              .gain = effect_gain};
-  switch (effect.type) {
-  case FF_CONSTANT:
-    r_effect.start.weak = effect.u.constant.level;
-    r_effect.start.strong = effect.u.constant.level;
-    r_effect.end.weak = effect.u.constant.level;
-    r_effect.end.strong = effect.u.constant.level;
-    r_effect.envelope = effect.u.constant.envelope;
-    break;
-  case FF_PERIODIC:
-    r_effect.start.weak = effect.u.periodic.magnitude;
-    r_effect.start.strong = effect.u.periodic.magnitude;
-    r_effect.end.weak = effect.u.periodic.magnitude;
-    r_effect.end.strong = effect.u.periodic.magnitude;
-    r_effect.envelope = effect.u.periodic.envelope;
-    break;
-  case FF_RAMP:
-    r_effect.start.weak = effect.u.ramp.start_level;
-    r_effect.start.strong = effect.u.ramp.start_level;
-    r_effect.end.weak = effect.u.ramp.end_level;
-    r_effect.end.strong = effect.u.ramp.end_level;
-    r_effect.envelope = effect.u.ramp.envelope;
-    break;
-  case FF_RUMBLE:
-    r_effect.start.weak = effect.u.rumble.weak_magnitude;
-    r_effect.start.strong = effect.u.rumble.strong_magnitude;
-    r_effect.end.weak = effect.u.rumble.weak_magnitude;
-    r_effect.end.strong = effect.u.rumble.strong_magnitude;
-    break;
-  }
-  return r_effect;
+static void handover_joypad(BaseJoypadState &state) {
+  state.conditioning.restore_defaults(state.writer);
+  std::lock_guard<std::mutex> lock(state.callbacks_m);
+  state.on_rumble = std::nullopt;
+  state.on_ff_effect = std::nullopt;
 }
 
 /**
@@ -152,9 +133,8 @@ static ActiveRumbleEffect create_rumble_effect(int effect_id, int effect_gain, c
  *   You can test the virtual devices that we create by simply using the utility `fftest`
  */
 static void event_listener(const std::shared_ptr<BaseJoypadState> &state) {
-  std::this_thread::sleep_for(100ms); // We have to sleep in order to be able to read from the newly created device
-
-  auto uinput_fd = libevdev_uinput_get_fd(state->joy.get());
+  apply_thread_config("ff");
+  auto uinput_fd = uinput_get_fd(state->joy.get());
   if (uinput_fd < 0) {
     std::cerr << "Unable to open uinput device, additional events will be disabled.";
     return;
@@ -164,86 +144,70 @@ static void event_listener(const std::shared_ptr<BaseJoypadState> &state) {
   int flags = fcntl(uinput_fd, F_GETFL, 0);
   fcntl(uinput_fd, F_SETFL, flags | O_NONBLOCK);
 
-  /* Local copy of all the uploaded ff effects */
-  std::map<int, ff_effect> ff_effects = {};
-
-  /* Currently running ff effects */
-  std::vector<ActiveRumbleEffect> active_effects = {};
-
-  auto remove_effects = [&](auto filter_fn) {
-    active_effects.erase(std::remove_if(active_effects.begin(),
-                                        active_effects.end(),
-                                        [&](const auto effect) {
-                                          auto to_be_removed = filter_fn(effect);
-                                          if (to_be_removed && state->on_rumble) {
-                                            state->on_rumble.value()(0, 0);
-                                          }
-                                          return to_be_removed;
-                                        }),
-                         active_effects.end());
-  };
+  /* All the uploaded ff effects, mixed into a single rumble output */
+  RumbleMixer mixer;
+
+  /* Reused on every iteration, fetch_events() will read straight into it */
+  std::array<input_event, 50> events_buffer = {};
 
   while (!state->stop_listening_events) {
     std::this_thread::sleep_for(20ms); // TODO: configurable?
 
-    int effect_gain = 1;
-
-    auto events = fetch_events(uinput_fd);
-    for (auto ev : events) {
-      if (ev->type == EV_UINPUT && ev->code == UI_FF_UPLOAD) { // Upload a new FF effect
+    auto now = std::chrono::steady_clock::now();
+    for (const auto &ev : fetch_events(uinput_fd, events_buffer)) {
+      if (ev.type == EV_UINPUT && ev.code == UI_FF_UPLOAD) { // Upload a new FF effect
         uinput_ff_upload upload{};
-        upload.request_id = ev->value;
+        upload.request_id = ev.value;
 
         ioctl(uinput_fd, UI_BEGIN_FF_UPLOAD, &upload); // retrieve the effect
 
-        ff_effects.insert_or_assign(upload.effect.id, upload.effect);
-        upload.retval = 0;
+        upload.retval = mixer.upload(upload.effect) ? 0 : -ENOSPC;
+        if (upload.retval == 0) {
+          forward_ff_effect(*state, Joypad::FF_EFFECT_UPLOAD, &upload.effect);
+        }
 
         ioctl(uinput_fd, UI_END_FF_UPLOAD, &upload);
-      } else if (ev->type == EV_UINPUT && ev->code == UI_FF_ERASE) { // Remove an uploaded FF effect
+      } else if (ev.type == EV_UINPUT && ev.code == UI_FF_ERASE) { // Remove an uploaded FF effect
         uinput_ff_erase erase{};
-        erase.request_id = ev->value;
+        erase.request_id = ev.value;
 
         ioctl(uinput_fd, UI_BEGIN_FF_ERASE, &erase); // retrieve ff_erase
 
-        ff_effects.erase(erase.effect_id);
+        forward_ff_effect(*state, Joypad::FF_EFFECT_ERASE, mixer.effect(erase.effect_id));
+        mixer.erase(erase.effect_id);
         erase.retval = 0;
 
         ioctl(uinput_fd, UI_END_FF_ERASE, &erase);
-      } else if (ev->type == EV_FF && ev->code == FF_GAIN) { // Force feedback set gain
-        effect_gain = std::clamp(ev->value, 0, 0xFFFF);
-      } else if (ev->type == EV_FF) { // Force feedback effect
-        auto effect_id = ev->code;
-        if (ev->value) { // Activate
-          if (ff_effects.find(effect_id) != ff_effects.end() && state->on_rumble) {
-            auto effect = ff_effects[effect_id];
-            active_effects.emplace_back(create_rumble_effect(effect_id, effect_gain, effect));
-          }
+      } else if (ev.type == EV_FF && ev.code == FF_GAIN) { // Force feedback set gain
+        mixer.set_gain(ev.value);
+      } else if (ev.type == EV_FF) { // Force feedback effect
+        if (ev.value) { // Activate
+          mixer.play(ev.code, now);
+          forward_ff_effect(*state, Joypad::FF_EFFECT_PLAY, mixer.effect(ev.code));
         } else { // Deactivate
-          remove_effects([effect_id](const auto &effect) { return effect.effect_id == effect_id; });
+          mixer.stop(ev.code);
+          forward_ff_effect(*state, Joypad::FF_EFFECT_STOP, mixer.effect(ev.code));
         }
-      } else if (ev->type == EV_LED) {
+      } else if (ev.type == EV_LED) {
         // TODO: support LED
       }
     }
 
-    auto now = std::chrono::steady_clock::now();
-
-    // Remove effects that have ended
-    remove_effects([now](const auto effect) { return effect.end_point <= now; });
-
-    // Simulate rumble
-    for (auto effect : active_effects) {
-      auto [weak, strong] = simulate_rumble(effect, now);
-      if (effect.previous.first != weak || effect.previous.second != strong) {
-        effect.previous.first = weak;
-        effect.previous.second = strong;
-
-        if (auto callback = state->on_rumble) {
-          callback.value()(weak, strong);
+    if (state->stop_rumble.exchange(false)) { // See reset_joypad()
+      for (int effect_id = 0; effect_id < RumbleMixer::MAX_EFFECTS; effect_id++) {
+        if (mixer.playing(effect_id)) {
+          mixer.stop(effect_id);
+          forward_ff_effect(*state, Joypad::FF_EFFECT_STOP, mixer.effect(effect_id));
         }
       }
     }
+
+    // A single callback with the combined output of all the playing effects, only when it changes
+    if (auto output = mixer.tick(now)) {
+      if (auto on_rumble = get_callback(*state, state->on_rumble)) {
+        (*on_rumble)(output->first, output->second);
+      }
+    }
   }
 }
 
@@ -12,74 +12,79 @@ namespace inputtino {
 std::vector<std::string> XboxOneJoypad::get_nodes() const {
   std::vector<std::string> nodes;
 
+  // Joypads will also have one `/dev/input/js*` device as child, we want to expose that as well
   if (auto joy = _state->joy.get()) {
-    auto additional_nodes = get_child_dev_nodes(joy);
-    nodes.insert(nodes.end(), additional_nodes.begin(), additional_nodes.end());
+    nodes = uinput_get_nodes(joy);
   }
 
   return nodes;
 }
 
-Result<libevdev_uinput_ptr> create_xbox_controller(const DeviceDefinition &device) {
-  libevdev *dev = libevdev_new();
-  libevdev_uinput *uidev;
-
-  libevdev_set_name(dev, device.name.c_str());
-  libevdev_set_id_vendor(dev, device.vendor_id);
-  libevdev_set_id_product(dev, device.product_id);
-  libevdev_set_id_version(dev, device.version);
-  libevdev_set_id_bustype(dev, BUS_USB);
-
-  libevdev_enable_event_type(dev, EV_KEY);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_WEST, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_EAST, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_NORTH, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_SOUTH, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_THUMBL, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_THUMBR, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_TR, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_TL, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_SELECT, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_MODE, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_START, nullptr);
-
-  libevdev_enable_event_type(dev, EV_ABS);
-
-  input_absinfo dpad{0, -1, 1, 0, 0, 0};
-  libevdev_enable_event_code(dev, EV_ABS, ABS_HAT0Y, &dpad);
-  libevdev_enable_event_code(dev, EV_ABS, ABS_HAT0X, &dpad);
-
-  input_absinfo stick{0, -32768, 32767, 16, 128, 0};
-  libevdev_enable_event_code(dev, EV_ABS, ABS_X, &stick);
-  libevdev_enable_event_code(dev, EV_ABS, ABS_RX, &stick);
-  libevdev_enable_event_code(dev, EV_ABS, ABS_Y, &stick);
-  libevdev_enable_event_code(dev, EV_ABS, ABS_RY, &stick);
-
-  input_absinfo trigger{0, 0, 255, 0, 0, 0};
-  libevdev_enable_event_code(dev, EV_ABS, ABS_Z, &trigger);
-  libevdev_enable_event_code(dev, EV_ABS, ABS_RZ, &trigger);
-
-  libevdev_enable_event_type(dev, EV_FF);
-  libevdev_enable_event_code(dev, EV_FF, FF_RUMBLE, nullptr);
-  libevdev_enable_event_code(dev, EV_FF, FF_CONSTANT, nullptr);
-  libevdev_enable_event_code(dev, EV_FF, FF_PERIODIC, nullptr);
-  libevdev_enable_event_code(dev, EV_FF, FF_SINE, nullptr);
-  libevdev_enable_event_code(dev, EV_FF, FF_RAMP, nullptr);
-  libevdev_enable_event_code(dev, EV_FF, FF_GAIN, nullptr);
-
-  auto err = libevdev_uinput_create_from_device(dev, LIBEVDEV_UINPUT_OPEN_MANAGED, &uidev);
-  libevdev_free(dev);
-  if (err != 0) {
-    return Error(strerror(-err));
-  }
+static constexpr input_absinfo JOYPAD_DPAD{0, -1, 1, 0, 0, 0};
+static constexpr input_absinfo JOYPAD_STICK{0, -32768, 32767, 16, 128, 0};
+
+static constexpr UinputTemplate xbox_template =
+    UinputTemplate{}
+        .key(BTN_WEST)
+        .key(BTN_EAST)
+        .key(BTN_NORTH)
+        .key(BTN_SOUTH)
+        .key(BTN_THUMBL)
+        .key(BTN_THUMBR)
+        .key(BTN_TR)
+        .key(BTN_TL)
+        .key(BTN_SELECT)
+        .key(BTN_MODE)
+        .key(BTN_START)
+        .abs_axis(ABS_HAT0Y, JOYPAD_DPAD)
+        .abs_axis(ABS_HAT0X, JOYPAD_DPAD)
+        .abs_axis(ABS_X, JOYPAD_STICK)
+        .abs_axis(ABS_RX, JOYPAD_STICK)
+        .abs_axis(ABS_Y, JOYPAD_STICK)
+        .abs_axis(ABS_RY, JOYPAD_STICK)
+        .abs_axis(ABS_Z, {0, 0, 255, 0, 0, 0})
+        .abs_axis(ABS_RZ, {0, 0, 255, 0, 0, 0})
+        .force_feedback(FF_RUMBLE, RumbleMixer::MAX_EFFECTS)
+        .force_feedback(FF_CONSTANT, RumbleMixer::MAX_EFFECTS)
+        .force_feedback(FF_PERIODIC, RumbleMixer::MAX_EFFECTS)
+        .force_feedback(FF_SINE, RumbleMixer::MAX_EFFECTS)
+        .force_feedback(FF_RAMP, RumbleMixer::MAX_EFFECTS)
+        .force_feedback(FF_GAIN, RumbleMixer::MAX_EFFECTS);
+
+static constexpr ButtonTable xbox_buttons = make_button_table(std::array<ButtonMapping, 11>{{
+    {Joypad::START, BTN_START},
+    {Joypad::BACK, BTN_SELECT},
+    {Joypad::HOME, BTN_MODE},
+    {Joypad::LEFT_STICK, BTN_THUMBL},
+    {Joypad::RIGHT_STICK, BTN_THUMBR},
+    {Joypad::LEFT_BUTTON, BTN_TL},
+    {Joypad::RIGHT_BUTTON, BTN_TR},
+    {Joypad::A, BTN_SOUTH},
+    {Joypad::B, BTN_EAST},
+    {Joypad::X, BTN_NORTH},
+    {Joypad::Y, BTN_WEST},
+}});
+
+Result<uinput_ptr> create_xbox_controller(const DeviceDefinition &device) {
+  return create_uinput(xbox_template, device);
+}
+
+void XboxOneJoypad::reset() {
+  _state->writer.run([state = _state.get()]() { reset_joypad(*state, xbox_template); });
+}
 
-  return libevdev_uinput_ptr{uidev, ::libevdev_uinput_destroy};
+void XboxOneJoypad::handover() {
+  reset();
+  _state->writer.flush();
+  handover_joypad(*_state);
 }
 
 XboxOneJoypad::XboxOneJoypad() : _state(std::make_shared<XboxOneJoypadState>()) {}
 
 XboxOneJoypad::~XboxOneJoypad() {
   if (_state) {
+    _state->conditioning.stop_settling();
+    _state->writer.flush();
     _state->stop_listening_events = true;
     if (_state->joy.get() != nullptr && _state->events_thread.joinable()) {
       _state->events_thread.join();
@@ -95,6 +100,10 @@ Result<XboxOneJoypad> XboxOneJoypad::create(const DeviceDefinition &device) {
 
   XboxOneJoypad joypad;
   joypad._state->joy = std::move(*joy_el);
+  joypad._state->conditioning.on_settle([state = joypad._state.get()]() { settle_sticks(*state); });
+  if (device.async_writes) {
+    joypad._state->writer.start_thread(device.writer_cpu);
+  }
 
   auto event_thread = std::thread(event_listener, joypad._state);
   joypad._state->events_thread = std::move(event_thread);
@@ -103,88 +112,64 @@ Result<XboxOneJoypad> XboxOneJoypad::create(const DeviceDefinition &device) {
 }
 
 void XboxOneJoypad::set_pressed_buttons(int newly_pressed) {
-  // Button flags that have been changed between current and prev
-  auto bf_changed = newly_pressed ^ this->_state->currently_pressed_btns;
-  // Button flags that are only part of the new packet
-  auto bf_new = newly_pressed;
-  if (auto controller = this->_state->joy.get()) {
+  _state->writer.run([state = _state.get(), newly_pressed]() {
+    if (auto controller = state->joy.get()) {
+      write_buttons(controller, xbox_buttons, state->snapshot.current().pressed_buttons, newly_pressed);
+      uinput_write_event(controller, EV_SYN, SYN_REPORT, 0);
+    }
+    state->snapshot.write([newly_pressed](Joypad::Snapshot &snapshot) { snapshot.pressed_buttons = newly_pressed; });
+  });
+}
 
-    if (bf_changed) {
-      if ((DPAD_UP | DPAD_DOWN) & bf_changed) {
-        int button_state = bf_new & DPAD_UP ? -1 : (bf_new & DPAD_DOWN ? 1 : 0);
+void XboxOneJoypad::set_stick(STICK_POSITION stick_type, short x, short y) {
+  _state->writer.run([state = _state.get(), stick_type, x, y]() { write_stick(*state, stick_type, x, y); });
+}
 
-        libevdev_uinput_write_event(controller, EV_ABS, ABS_HAT0Y, button_state);
+void XboxOneJoypad::set_triggers(int16_t left, int16_t right) {
+  _state->writer.run([state = _state.get(), raw_left = left, raw_right = right]() {
+    auto [left, right] = state->conditioning.triggers(raw_left, raw_right);
+    if (auto controller = state->joy.get()) {
+      if (left > 0) {
+        uinput_write_event(controller, EV_ABS, ABS_Z, left);
+      } else {
+        uinput_write_event(controller, EV_ABS, ABS_Z, left);
       }
 
-      if ((DPAD_LEFT | DPAD_RIGHT) & bf_changed) {
-        int button_state = bf_new & DPAD_LEFT ? -1 : (bf_new & DPAD_RIGHT ? 1 : 0);
-
-        libevdev_uinput_write_event(controller, EV_ABS, ABS_HAT0X, button_state);
+      if (right > 0) {
+        uinput_write_event(controller, EV_ABS, ABS_RZ, right);
+      } else {
+        uinput_write_event(controller, EV_ABS, ABS_RZ, right);
       }
 
-      if (START & bf_changed)
-        libevdev_uinput_write_event(controller, EV_KEY, BTN_START, bf_new & START ? 1 : 0);
-      if (BACK & bf_changed)
-        libevdev_uinput_write_event(controller, EV_KEY, BTN_SELECT, bf_new & BACK ? 1 : 0);
-      if (LEFT_STICK & bf_changed)
-        libevdev_uinput_write_event(controller, EV_KEY, BTN_THUMBL, bf_new & LEFT_STICK ? 1 : 0);
-      if (RIGHT_STICK & bf_changed)
-        libevdev_uinput_write_event(controller, EV_KEY, BTN_THUMBR, bf_new & RIGHT_STICK ? 1 : 0);
-      if (LEFT_BUTTON & bf_changed)
-        libevdev_uinput_write_event(controller, EV_KEY, BTN_TL, bf_new & LEFT_BUTTON ? 1 : 0);
-      if (RIGHT_BUTTON & bf_changed)
-        libevdev_uinput_write_event(controller, EV_KEY, BTN_TR, bf_new & RIGHT_BUTTON ? 1 : 0);
-      if (HOME & bf_changed)
-        libevdev_uinput_write_event(controller, EV_KEY, BTN_MODE, bf_new & HOME ? 1 : 0);
-      if (A & bf_changed)
-        libevdev_uinput_write_event(controller, EV_KEY, BTN_SOUTH, bf_new & A ? 1 : 0);
-      if (B & bf_changed)
-        libevdev_uinput_write_event(controller, EV_KEY, BTN_EAST, bf_new & B ? 1 : 0);
-      if (X & bf_changed)
-        libevdev_uinput_write_event(controller, EV_KEY, BTN_NORTH, bf_new & X ? 1 : 0);
-      if (Y & bf_changed)
-        libevdev_uinput_write_event(controller, EV_KEY, BTN_WEST, bf_new & Y ? 1 : 0);
+      uinput_write_event(controller, EV_SYN, SYN_REPORT, 0);
     }
-
-    libevdev_uinput_write_event(controller, EV_SYN, SYN_REPORT, 0);
-  }
-  this->_state->currently_pressed_btns = bf_new;
+    state->snapshot.write([left = left, right = right](Joypad::Snapshot &snapshot) {
+      snapshot.left_trigger = left;
+      snapshot.right_trigger = right;
+    });
+  });
 }
 
-void XboxOneJoypad::set_stick(STICK_POSITION stick_type, short x, short y) {
-  if (auto controller = this->_state->joy.get()) {
-    if (stick_type == LS) {
-      libevdev_uinput_write_event(controller, EV_ABS, ABS_X, x);
-      libevdev_uinput_write_event(controller, EV_ABS, ABS_Y, -y);
-    } else {
-      libevdev_uinput_write_event(controller, EV_ABS, ABS_RX, x);
-      libevdev_uinput_write_event(controller, EV_ABS, ABS_RY, -y);
-    }
-
-    libevdev_uinput_write_event(controller, EV_SYN, SYN_REPORT, 0);
-  }
+Result<bool> XboxOneJoypad::set_stick_conditioning(STICK_POSITION stick, const StickConditioning &conditioning) {
+  return _state->conditioning.configure(_state->writer, stick, conditioning);
 }
 
-void XboxOneJoypad::set_triggers(int16_t left, int16_t right) {
-  if (auto controller = this->_state->joy.get()) {
-    if (left > 0) {
-      libevdev_uinput_write_event(controller, EV_ABS, ABS_Z, left);
-    } else {
-      libevdev_uinput_write_event(controller, EV_ABS, ABS_Z, left);
-    }
-
-    if (right > 0) {
-      libevdev_uinput_write_event(controller, EV_ABS, ABS_RZ, right);
-    } else {
-      libevdev_uinput_write_event(controller, EV_ABS, ABS_RZ, right);
-    }
+Result<bool> XboxOneJoypad::set_trigger_conditioning(const TriggerConditioning &conditioning) {
+  return _state->conditioning.configure(_state->writer, conditioning);
+}
 
-    libevdev_uinput_write_event(controller, EV_SYN, SYN_REPORT, 0);
-  }
+Joypad::Snapshot XboxOneJoypad::snapshot() const {
+  return _state->snapshot.read();
 }
 
 void XboxOneJoypad::set_on_rumble(const std::function<void(int, int)> &callback) {
+  std::lock_guard<std::mutex> lock(this->_state->callbacks_m);
   this->_state->on_rumble = callback;
 }
 
+void XboxOneJoypad::set_on_ff_effect(const std::function<void(FF_EVENT_TYPE, const ff_effect &)> &callback) {
+  std::lock_guard<std::mutex> lock(this->_state->callbacks_m);
+  this->_state->on_ff_effect = callback;
+}
+
 } // namespace inputtino
\ No newline at end of file
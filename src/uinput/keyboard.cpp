@@ -4,7 +4,9 @@
 #include <algorithm>
 #include <cstring>
 #include <inputtino/protected_types.hpp>
+#include <inputtino/threads.hpp>
 #include <thread>
+#include <uhid/uhid.hpp>
 
 namespace inputtino {
 
@@ -14,46 +16,64 @@ std::vector<std::string> Keyboard::get_nodes() const {
   std::vector<std::string> nodes;
 
   if (auto kb = _state->kb.get()) {
-    nodes.emplace_back(libevdev_uinput_get_devnode(kb));
+    if (auto devnode = uinput_get_devnode(kb)) {
+      nodes.emplace_back(devnode);
+    }
+  } else if (_state->nkro_kb) {
+    nodes = _state->nkro_kb->get_nodes();
   }
 
   return nodes;
 }
 
-Result<libevdev_uinput_ptr> create_keyboard(const DeviceDefinition &device) {
-  auto dev = libevdev_new();
-  libevdev_uinput *uidev;
-
-  libevdev_set_name(dev, device.name.c_str());
-  libevdev_set_id_vendor(dev, device.vendor_id);
-  libevdev_set_id_product(dev, device.product_id);
-  libevdev_set_id_version(dev, device.version);
-  libevdev_set_id_bustype(dev, BUS_USB);
-
-  libevdev_enable_event_type(dev, EV_KEY);
-  libevdev_enable_event_code(dev, EV_KEY, KEY_BACKSPACE, nullptr);
-
-  for (auto ev : keyboard::key_mappings) {
-    libevdev_enable_event_code(dev, EV_KEY, ev.second.linux_code, nullptr);
-  }
+void Keyboard::reset() {
+  _state->writer.run([state = _state.get()]() {
+    if (state->nkro_kb) {
+      nkro_release_all(*state);
+    } else if (auto keyboard = state->kb.get()) {
+      if (state->cur_press_keys.empty()) {
+        return;
+      }
+      for (auto key : state->cur_press_keys) {
+        auto search_key = keyboard::key_mappings.find(key);
+        if (search_key != keyboard::key_mappings.end()) {
+          uinput_write_event(keyboard, EV_MSC, MSC_SCAN, search_key->second.scan_code);
+          uinput_write_event(keyboard, EV_KEY, search_key->second.linux_code, 0);
+        }
+      }
+      state->cur_press_keys.clear();
+      uinput_write_event(keyboard, EV_SYN, SYN_REPORT, 0);
+    }
+  });
+}
 
-  auto err = libevdev_uinput_create_from_device(dev, LIBEVDEV_UINPUT_OPEN_MANAGED, &uidev);
-  libevdev_free(dev);
-  if (err != 0) {
-    return Error(strerror(-err));
-  }
+/**
+ * key_mappings isn't constexpr, the template is built once on first use and shared by all keyboards
+ */
+static const UinputTemplate &keyboard_template() {
+  static const UinputTemplate capabilities = []() {
+    UinputTemplate capabilities;
+    capabilities.key(KEY_BACKSPACE);
+    for (const auto &ev : keyboard::key_mappings) {
+      capabilities.key(ev.second.linux_code);
+    }
+    return capabilities;
+  }();
+  return capabilities;
+}
 
-  return libevdev_uinput_ptr{uidev, ::libevdev_uinput_destroy};
+Result<uinput_ptr> create_keyboard(const DeviceDefinition &device) {
+  return create_uinput(keyboard_template(), device);
 }
 
-static std::optional<keyboard::KEY_MAP> press_btn(libevdev_uinput *kb, short key_code) {
+static std::optional<keyboard::KEY_MAP> press_btn(uinput_device *kb, short key_code) {
   auto search_key = keyboard::key_mappings.find(key_code);
   if (search_key != keyboard::key_mappings.end()) {
     auto mapped_key = search_key->second;
 
-    libevdev_uinput_write_event(kb, EV_MSC, MSC_SCAN, mapped_key.scan_code);
-    libevdev_uinput_write_event(kb, EV_KEY, mapped_key.linux_code, 1);
-    libevdev_uinput_write_event(kb, EV_SYN, SYN_REPORT, 0);
+    uinput_write_event(kb, EV_MSC, MSC_SCAN, mapped_key.scan_code);
+    uinput_write_event(kb, EV_KEY, mapped_key.linux_code, 1);
+    uinput_write_event(kb, EV_SYN, SYN_REPORT, 0);
     return mapped_key;
   }
   return {};
@@ -63,6 +83,7 @@ Keyboard::Keyboard() : _state(std::make_shared<KeyboardState>()) {}
 
 Keyboard::~Keyboard() {
   if (_state) {
+    _state->writer.flush();
     _state->stop_repeat_thread = true;
     if (_state->repeat_press_t.joinable()) {
       _state->repeat_press_t.join();
@@ -70,23 +91,43 @@ Keyboard::~Keyboard() {
   }
 }
 
-Result<Keyboard> Keyboard::create(const DeviceDefinition &device, int millis_repress_key) {
+Result<Keyboard> Keyboard::create(const DeviceDefinition &device, int millis_repress_key, BACKEND backend) {
+  if (backend == UHID) {
+    auto nkro_kb = create_nkro_keyboard(device);
+    if (!nkro_kb) {
+      return Error(nkro_kb.getErrorMessage());
+    }
+    Keyboard kb;
+    kb._state->nkro_kb = std::move(*nkro_kb);
+    if (device.async_writes) {
+      kb._state->writer.start_thread(device.writer_cpu);
+    }
+    return kb;
+  }
+
   auto kb_el = create_keyboard(device);
   if (kb_el) {
     Keyboard kb;
     kb._state->kb = std::move(*kb_el);
+    if (device.async_writes) {
+      kb._state->writer.start_thread(device.writer_cpu);
+    }
     auto repeat_thread = std::thread([state = kb._state, millis_repress_key]() {
+      apply_thread_config("rep");
       while (!state->stop_repeat_thread) {
         std::this_thread::sleep_for(std::chrono::milliseconds(millis_repress_key));
-        for (auto key : state->cur_press_keys) {
-          if (auto keyboard = state->kb.get()) {
-            press_btn(keyboard, key);
+        // cur_press_keys belongs to the writer, the repeat is just one more command
+        state->writer.run([state = state.get()]() {
+          for (auto key : state->cur_press_keys) {
+            if (auto keyboard = state->kb.get()) {
+              press_btn(keyboard, key);
+            }
           }
-        }
+        });
       }
+      state->writer.flush(); // the re-presses above might still be queued, they use the state we are about to release
     });
-    kb._state->repeat_press_t = std::move(repeat_thread);
-    kb._state->repeat_press_t.detach();
+    kb._state->repeat_press_t = std::move(repeat_thread); // Joined by ~Keyboard()
     return kb;
   } else {
     return Error(kb_el.getErrorMessage());
@@ -94,27 +135,37 @@ Result<Keyboard> Keyboard::create(const DeviceDefinition &device, int millis_rep
 }
 
 void Keyboard::press(short key_code) {
-  if (auto keyboard = _state->kb.get()) {
-    if (auto key = press_btn(keyboard, key_code)) {
-      _state->cur_press_keys.push_back(key_code);
+  _state->writer.run([state = _state.get(), key_code]() {
+    if (auto keyboard = state->kb.get()) {
+      if (auto key = press_btn(keyboard, key_code)) {
+        state->cur_press_keys.push_back(key_code);
+      }
+    } else if (state->nkro_kb) {
+      auto search_key = keyboard::key_mappings.find(key_code);
+      if (search_key != keyboard::key_mappings.end()) {
+        nkro_set_key(*state, search_key->second.linux_code, true);
+      }
     }
-  }
+  });
 }
 
 void Keyboard::release(short key_code) {
-  auto search_key = keyboard::key_mappings.find(key_code);
-  if (search_key != keyboard::key_mappings.end()) {
-    if (auto keyboard = _state->kb.get()) {
-      auto mapped_key = search_key->second;
-      this->_state->cur_press_keys.erase(
-          std::remove(this->_state->cur_press_keys.begin(), this->_state->cur_press_keys.end(), key_code),
-          this->_state->cur_press_keys.end());
-
-      libevdev_uinput_write_event(keyboard, EV_MSC, MSC_SCAN, mapped_key.scan_code);
-      libevdev_uinput_write_event(keyboard, EV_KEY, mapped_key.linux_code, 0);
-      libevdev_uinput_write_event(keyboard, EV_SYN, SYN_REPORT, 0);
+  _state->writer.run([state = _state.get(), key_code]() {
+    auto search_key = keyboard::key_mappings.find(key_code);
+    if (search_key != keyboard::key_mappings.end()) {
+      if (state->nkro_kb) {
+        nkro_set_key(*state, search_key->second.linux_code, false);
+      } else if (auto keyboard = state->kb.get()) {
+        auto mapped_key = search_key->second;
+        state->cur_press_keys.erase(std::remove(state->cur_press_keys.begin(), state->cur_press_keys.end(), key_code),
+                                    state->cur_press_keys.end());
+
+        uinput_write_event(keyboard, EV_MSC, MSC_SCAN, mapped_key.scan_code);
+        uinput_write_event(keyboard, EV_KEY, mapped_key.linux_code, 0);
+        uinput_write_event(keyboard, EV_SYN, SYN_REPORT, 0);
+      }
     }
-  }
+  });
 }
 
 } // namespace inputtino
\ No newline at end of file
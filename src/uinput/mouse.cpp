@@ -1,5 +1,7 @@
 #include "inputtino/input.hpp"
+#include <algorithm>
 #include <cmath>
+#include <inputtino/axis.hpp>
 #include <inputtino/protected_types.hpp>
 #include <string.h>
 
@@ -9,138 +11,189 @@ std::vector<std::string> Mouse::get_nodes() const {
   std::vector<std::string> nodes;
 
   if (auto mouse = _state->mouse_rel.get()) {
-    nodes.emplace_back(libevdev_uinput_get_devnode(mouse));
+    if (auto devnode = uinput_get_devnode(mouse)) {
+      nodes.emplace_back(devnode);
+    }
   }
 
+  std::lock_guard<std::mutex> lock(_state->mouse_abs_m);
   if (auto mouse = _state->mouse_abs.get()) {
-    nodes.emplace_back(libevdev_uinput_get_devnode(mouse));
+    if (auto devnode = uinput_get_devnode(mouse)) {
+      nodes.emplace_back(devnode);
+    }
   }
 
   return nodes;
 }
 
+void Mouse::reset() {
+  _state->writer.run([state = _state.get()]() {
+    if (auto mouse = state->mouse_rel.get()) {
+      for (auto button : {BTN_LEFT, BTN_MIDDLE, BTN_RIGHT, BTN_SIDE, BTN_EXTRA}) {
+        uinput_write_event(mouse, EV_KEY, button, 0);
+      }
+      uinput_write_event(mouse, EV_SYN, SYN_REPORT, 0);
+    }
+    state->remainder_x = 0.0f;
+    state->remainder_y = 0.0f;
+  });
+}
+
 constexpr int ABS_MAX_WIDTH = 19200;
 constexpr int ABS_MAX_HEIGHT = 12000;
 
-static Result<libevdev_uinput_ptr> create_mouse(const DeviceDefinition &device) {
-  libevdev *dev = libevdev_new();
-  libevdev_uinput *uidev;
-
-  libevdev_set_name(dev, device.name.c_str());
-  libevdev_set_id_vendor(dev, device.vendor_id);
-  libevdev_set_id_product(dev, device.product_id);
-  libevdev_set_id_version(dev, device.version);
-  libevdev_set_id_bustype(dev, BUS_USB);
-
-  libevdev_enable_event_type(dev, EV_KEY);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_LEFT, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_RIGHT, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_MIDDLE, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_SIDE, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_EXTRA, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_FORWARD, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_BACK, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_TASK, nullptr);
-
-  libevdev_enable_event_type(dev, EV_REL);
-  libevdev_enable_event_code(dev, EV_REL, REL_X, nullptr);
-  libevdev_enable_event_code(dev, EV_REL, REL_Y, nullptr);
-
-  libevdev_enable_event_code(dev, EV_REL, REL_WHEEL, nullptr);
-  libevdev_enable_event_code(dev, EV_REL, REL_WHEEL_HI_RES, nullptr);
-  libevdev_enable_event_code(dev, EV_REL, REL_HWHEEL, nullptr);
-  libevdev_enable_event_code(dev, EV_REL, REL_HWHEEL_HI_RES, nullptr);
-
-  libevdev_enable_event_type(dev, EV_MSC);
-  libevdev_enable_event_code(dev, EV_MSC, MSC_SCAN, nullptr);
-
-  auto err = libevdev_uinput_create_from_device(dev, LIBEVDEV_UINPUT_OPEN_MANAGED, &uidev);
-  libevdev_free(dev);
-  if (err != 0) {
-    return Error(strerror(-err));
-  }
-
-  return libevdev_uinput_ptr{uidev, ::libevdev_uinput_destroy};
+static constexpr UinputTemplate mouse_rel_template = UinputTemplate{}
+                                                        .key(BTN_LEFT)
+                                                        .key(BTN_RIGHT)
+                                                        .key(BTN_MIDDLE)
+                                                        .key(BTN_SIDE)
+                                                        .key(BTN_EXTRA)
+                                                        .key(BTN_FORWARD)
+                                                        .key(BTN_BACK)
+                                                        .key(BTN_TASK)
+                                                        .rel(REL_X)
+                                                        .rel(REL_Y)
+                                                        .rel(REL_WHEEL)
+                                                        .rel(REL_WHEEL_HI_RES)
+                                                        .rel(REL_HWHEEL)
+                                                        .rel(REL_HWHEEL_HI_RES)
+                                                        .misc(MSC_SCAN);
+
+static constexpr UinputTemplate mouse_abs_template =
+    UinputTemplate{}
+        .property(INPUT_PROP_DIRECT)
+        .key(BTN_LEFT)
+        .abs_axis(ABS_X, {.value = 0, .minimum = 0, .maximum = ABS_MAX_WIDTH, .fuzz = 1, .flat = 0, .resolution = 28})
+        .abs_axis(ABS_Y, {.value = 0, .minimum = 0, .maximum = ABS_MAX_HEIGHT, .fuzz = 1, .flat = 0, .resolution = 28});
+
+static Result<uinput_ptr> create_mouse(const DeviceDefinition &device) {
+  return create_uinput(mouse_rel_template, device);
 }
 
-static Result<libevdev_uinput_ptr> create_mouse_abs() {
-  libevdev *dev = libevdev_new();
-  libevdev_uinput *uidev;
-
-  libevdev_set_name(dev, "Wolf mouse (abs) virtual device");
-  libevdev_set_id_vendor(dev, 0xAB00);
-  libevdev_set_id_product(dev, 0xAB02);
-  libevdev_set_id_version(dev, 0xAB00);
-  libevdev_set_id_bustype(dev, BUS_USB);
-
-  libevdev_enable_property(dev, INPUT_PROP_DIRECT);
-  libevdev_enable_event_type(dev, EV_KEY);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_LEFT, nullptr);
-
-  struct input_absinfo absinfo {
-    .value = 0, .minimum = 0, .maximum = 0, .fuzz = 1, .flat = 0, .resolution = 28
-  };
-  libevdev_enable_event_type(dev, EV_ABS);
-
-  absinfo.maximum = ABS_MAX_WIDTH;
-  libevdev_enable_event_code(dev, EV_ABS, ABS_X, &absinfo);
-  absinfo.maximum = ABS_MAX_HEIGHT;
-  libevdev_enable_event_code(dev, EV_ABS, ABS_Y, &absinfo);
-
-  auto err = libevdev_uinput_create_from_device(dev, LIBEVDEV_UINPUT_OPEN_MANAGED, &uidev);
-  libevdev_free(dev);
-  if (err != 0) {
-    return Error(strerror(-err));
-  }
-
-  return libevdev_uinput_ptr{uidev, ::libevdev_uinput_destroy};
+static Result<uinput_ptr> create_mouse_abs() {
+  return create_uinput(mouse_abs_template,
+                       {.name = "Wolf mouse (abs) virtual device",
+                        .vendor_id = 0xAB00,
+                        .product_id = 0xAB02,
+                        .version = 0xAB00});
 }
 
 Mouse::Mouse() : _state(std::make_shared<MouseState>()) {}
 
 Mouse::~Mouse() {
   if (_state) {
+    _state->writer.flush();
     _state.reset();
   }
 }
 
-Result<Mouse> Mouse::create(const DeviceDefinition &device) {
+Result<Mouse> Mouse::create(const DeviceDefinition &device, bool lazy_abs_device) {
   auto mouse = Mouse();
 
   auto mouse_rel_or_error = create_mouse(device);
   if (mouse_rel_or_error) {
     mouse._state->mouse_rel = std::move(*mouse_rel_or_error);
+    if (device.async_writes) {
+      mouse._state->writer.start_thread(device.writer_cpu);
+    }
   } else {
     return Error(mouse_rel_or_error.getErrorMessage());
   }
 
-  auto mouse_abs_or_error = create_mouse_abs();
-  if (mouse_abs_or_error) {
-    mouse._state->mouse_abs = std::move(*mouse_abs_or_error);
-  } else {
-    return Error(mouse_abs_or_error.getErrorMessage());
+  if (!lazy_abs_device) {
+    auto mouse_abs_or_error = mouse.create_abs_device();
+    if (!mouse_abs_or_error) {
+      return Error(mouse_abs_or_error.getErrorMessage());
+    }
   }
 
-  return std::move(mouse);
+  return mouse;
 }
 
-void Mouse::move(int delta_x, int delta_y) {
-  if (auto mouse = _state->mouse_rel.get()) {
-    libevdev_uinput_write_event(mouse, EV_REL, REL_X, delta_x);
-    libevdev_uinput_write_event(mouse, EV_REL, REL_Y, delta_y);
-    libevdev_uinput_write_event(mouse, EV_SYN, SYN_REPORT, 0);
+/**
+ * Has to be called while holding `mouse_abs_m`
+ */
+static Result<bool> ensure_mouse_abs(MouseState &state) {
+  if (!state.mouse_abs) {
+    auto mouse_abs_or_error = create_mouse_abs();
+    if (!mouse_abs_or_error) {
+      return Error(mouse_abs_or_error.getErrorMessage());
+    }
+    state.mouse_abs = std::move(*mouse_abs_or_error);
   }
+  return true;
 }
 
-void Mouse::move_abs(int x, int y, int screen_width, int screen_height) {
-  int scaled_x = (int)std::lround((ABS_MAX_WIDTH / screen_width) * x);
-  int scaled_y = (int)std::lround((ABS_MAX_HEIGHT / screen_height) * y);
+Result<bool> Mouse::create_abs_device() {
+  std::lock_guard<std::mutex> lock(_state->mouse_abs_m);
+  auto created = ensure_mouse_abs(*_state);
+  if (created) {
+    _state->mouse_abs_error = std::nullopt;
+  }
+  return created;
+}
 
-  if (auto mouse = _state->mouse_abs.get()) {
-    libevdev_uinput_write_event(mouse, EV_ABS, ABS_X, scaled_x);
-    libevdev_uinput_write_event(mouse, EV_ABS, ABS_Y, scaled_y);
-    libevdev_uinput_write_event(mouse, EV_SYN, SYN_REPORT, 0);
+void Mouse::move(int delta_x, int delta_y) {
+  _state->writer.run([state = _state.get(), delta_x, delta_y]() {
+    if (auto mouse = state->mouse_rel.get()) {
+      uinput_write_event(mouse, EV_REL, REL_X, delta_x);
+      uinput_write_event(mouse, EV_REL, REL_Y, delta_y);
+      uinput_write_event(mouse, EV_SYN, SYN_REPORT, 0);
+    }
+  });
+}
+
+void Mouse::move_subpixel(float delta_x, float delta_y) {
+  if (!std::isfinite(delta_x) || !std::isfinite(delta_y)) {
+    return;
   }
+  _state->writer.run([state = _state.get(), delta_x, delta_y]() {
+    // Largest float below INT_MAX: huge (but finite) moves are clamped so that the cast below stays defined
+    constexpr float max_units = 2147483520.0f;
+    state->remainder_x = std::clamp(state->remainder_x + delta_x, -max_units, max_units);
+    state->remainder_y = std::clamp(state->remainder_y + delta_y, -max_units, max_units);
+    // Truncating keeps the remainders in (-1.0, 1.0) in both directions
+    auto units_x = static_cast<int>(state->remainder_x);
+    auto units_y = static_cast<int>(state->remainder_y);
+    if (units_x == 0 && units_y == 0) {
+      return; // Not even a whole unit yet, it'll be sent together with the next moves
+    }
+    state->remainder_x -= units_x;
+    state->remainder_y -= units_y;
+
+    if (auto mouse = state->mouse_rel.get()) {
+      if (units_x != 0) {
+        uinput_write_event(mouse, EV_REL, REL_X, units_x);
+      }
+      if (units_y != 0) {
+        uinput_write_event(mouse, EV_REL, REL_Y, units_y);
+      }
+      uinput_write_event(mouse, EV_SYN, SYN_REPORT, 0);
+    }
+  });
+}
+
+void Mouse::move_abs(int x, int y, int screen_width, int screen_height) {
+  _state->writer.run([state = _state.get(), x, y, screen_width, screen_height]() {
+    int scaled_x = scale_to_range(x, screen_width, ABS_MAX_WIDTH);
+    int scaled_y = scale_to_range(y, screen_height, ABS_MAX_HEIGHT);
+
+    std::lock_guard<std::mutex> lock(state->mouse_abs_m);
+    if (state->mouse_abs_error) {
+      return; // Already failed: retrying (and logging) at pointer rate would stall all the other mouse commands
+    }
+    if (auto created = ensure_mouse_abs(*state); !created) {
+      std::cerr << "Unable to create the absolute mouse device: " << created.getErrorMessage() << std::endl;
+      state->mouse_abs_error = created.getErrorMessage();
+      return;
+    }
+
+    if (auto mouse = state->mouse_abs.get()) {
+      uinput_write_event(mouse, EV_ABS, ABS_X, scaled_x);
+      uinput_write_event(mouse, EV_ABS, ABS_Y, scaled_y);
+      uinput_write_event(mouse, EV_SYN, SYN_REPORT, 0);
+    }
+  });
 }
 
 static std::pair<int, int> btn_to_uinput(Mouse::MOUSE_BUTTON button) {
@@ -159,41 +212,49 @@ static std::pair<int, int> btn_to_uinput(Mouse::MOUSE_BUTTON button) {
 }
 
 void Mouse::press(Mouse::MOUSE_BUTTON button) {
-  if (auto mouse = _state->mouse_rel.get()) {
-    auto [btn_type, scan_code] = btn_to_uinput(button);
-    libevdev_uinput_write_event(mouse, EV_MSC, MSC_SCAN, scan_code);
-    libevdev_uinput_write_event(mouse, EV_KEY, btn_type, 1);
-    libevdev_uinput_write_event(mouse, EV_SYN, SYN_REPORT, 0);
-  }
+  _state->writer.run([state = _state.get(), button]() {
+    if (auto mouse = state->mouse_rel.get()) {
+      auto [btn_type, scan_code] = btn_to_uinput(button);
+      uinput_write_event(mouse, EV_MSC, MSC_SCAN, scan_code);
+      uinput_write_event(mouse, EV_KEY, btn_type, 1);
+      uinput_write_event(mouse, EV_SYN, SYN_REPORT, 0);
+    }
+  });
 }
 
 void Mouse::release(Mouse::MOUSE_BUTTON button) {
-  if (auto mouse = _state->mouse_rel.get()) {
-    auto [btn_type, scan_code] = btn_to_uinput(button);
-    libevdev_uinput_write_event(mouse, EV_MSC, MSC_SCAN, scan_code);
-    libevdev_uinput_write_event(mouse, EV_KEY, btn_type, 0);
-    libevdev_uinput_write_event(mouse, EV_SYN, SYN_REPORT, 0);
-  }
+  _state->writer.run([state = _state.get(), button]() {
+    if (auto mouse = state->mouse_rel.get()) {
+      auto [btn_type, scan_code] = btn_to_uinput(button);
+      uinput_write_event(mouse, EV_MSC, MSC_SCAN, scan_code);
+      uinput_write_event(mouse, EV_KEY, btn_type, 0);
+      uinput_write_event(mouse, EV_SYN, SYN_REPORT, 0);
+    }
+  });
 }
 
 void Mouse::horizontal_scroll(int high_res_distance) {
-  int distance = high_res_distance / 120;
-
-  if (auto mouse = _state->mouse_rel.get()) {
-    libevdev_uinput_write_event(mouse, EV_REL, REL_HWHEEL, distance);
-    libevdev_uinput_write_event(mouse, EV_REL, REL_HWHEEL_HI_RES, high_res_distance);
-    libevdev_uinput_write_event(mouse, EV_SYN, SYN_REPORT, 0);
-  }
+  _state->writer.run([state = _state.get(), high_res_distance]() {
+    int distance = high_res_distance / 120;
+
+    if (auto mouse = state->mouse_rel.get()) {
+      uinput_write_event(mouse, EV_REL, REL_HWHEEL, distance);
+      uinput_write_event(mouse, EV_REL, REL_HWHEEL_HI_RES, high_res_distance);
+      uinput_write_event(mouse, EV_SYN, SYN_REPORT, 0);
+    }
+  });
 }
 
 void Mouse::vertical_scroll(int high_res_distance) {
-  int distance = high_res_distance / 120;
-
-  if (auto mouse = _state->mouse_rel.get()) {
-    libevdev_uinput_write_event(mouse, EV_REL, REL_WHEEL, distance);
-    libevdev_uinput_write_event(mouse, EV_REL, REL_WHEEL_HI_RES, high_res_distance);
-    libevdev_uinput_write_event(mouse, EV_SYN, SYN_REPORT, 0);
-  }
+  _state->writer.run([state = _state.get(), high_res_distance]() {
+    int distance = high_res_distance / 120;
+
+    if (auto mouse = state->mouse_rel.get()) {
+      uinput_write_event(mouse, EV_REL, REL_WHEEL, distance);
+      uinput_write_event(mouse, EV_REL, REL_WHEEL_HI_RES, high_res_distance);
+      uinput_write_event(mouse, EV_SYN, SYN_REPORT, 0);
+    }
+  });
 }
 
 } // namespace inputtino
\ No newline at end of file
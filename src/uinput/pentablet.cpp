@@ -1,6 +1,7 @@
 #include "inputtino/input.hpp"
 #include <cmath>
 #include <cstring>
+#include <inputtino/axis.hpp>
 #include <inputtino/protected_types.hpp>
 
 namespace inputtino {
@@ -26,59 +27,38 @@ static constexpr int PRESSURE_MAX = 253;
 static constexpr int DISTANCE_MAX = 1024;
 static constexpr int RESOLUTION = 28;
 
-Result<libevdev_uinput_ptr> create_tablet(const DeviceDefinition &device) {
-  libevdev *dev = libevdev_new();
-  libevdev_uinput *uidev;
-
-  libevdev_set_name(dev, device.name.c_str());
-  libevdev_set_id_vendor(dev, device.vendor_id);
-  libevdev_set_id_product(dev, device.product_id);
-  libevdev_set_id_version(dev, device.version);
-  libevdev_set_id_bustype(dev, BUS_USB);
-
-  libevdev_enable_event_type(dev, EV_KEY);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_TOUCH, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_STYLUS, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_STYLUS2, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_STYLUS3, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_PEN, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_RUBBER, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_BRUSH, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_PENCIL, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_AIRBRUSH, nullptr);
-
-  libevdev_enable_event_type(dev, EV_ABS);
-  input_absinfo abs_x{0, 0, MAX_X, 1, 0, RESOLUTION};
-  libevdev_enable_event_code(dev, EV_ABS, ABS_X, &abs_x);
-
-  input_absinfo abs_y{0, 0, MAX_Y, 1, 0, RESOLUTION};
-  libevdev_enable_event_code(dev, EV_ABS, ABS_Y, &abs_y);
-
-  input_absinfo pressure{0, 0, PRESSURE_MAX, 0, 0, 0};
-  libevdev_enable_event_code(dev, EV_ABS, ABS_PRESSURE, &pressure);
-
-  input_absinfo distance{0, 0, DISTANCE_MAX, 0, 0, 0};
-  libevdev_enable_event_code(dev, EV_ABS, ABS_DISTANCE, &distance);
-  input_absinfo abs_tilt{0, -90, 90, 0, 0, RESOLUTION}; // If resolution is nonzero, it's in units/radian.
-  libevdev_enable_event_code(dev, EV_ABS, ABS_TILT_X, &abs_tilt);
-  libevdev_enable_event_code(dev, EV_ABS, ABS_TILT_Y, &abs_tilt);
-
-  // https://docs.kernel.org/input/event-codes.html#tablets
-  libevdev_enable_property(dev, INPUT_PROP_POINTER);
-  libevdev_enable_property(dev, INPUT_PROP_DIRECT);
-  auto err = libevdev_uinput_create_from_device(dev, LIBEVDEV_UINPUT_OPEN_MANAGED, &uidev);
-  libevdev_free(dev);
-  if (err != 0) {
-    return Error(strerror(-err));
-  }
-
-  return libevdev_uinput_ptr{uidev, ::libevdev_uinput_destroy};
+// If resolution is nonzero, it's in units/radian.
+static constexpr input_absinfo PEN_ABS_TILT{0, -90, 90, 0, 0, RESOLUTION};
+
+static constexpr UinputTemplate tablet_template = UinputTemplate{}
+                                                      .key(BTN_TOUCH)
+                                                      .key(BTN_STYLUS)
+                                                      .key(BTN_STYLUS2)
+                                                      .key(BTN_STYLUS3)
+                                                      .key(BTN_TOOL_PEN)
+                                                      .key(BTN_TOOL_RUBBER)
+                                                      .key(BTN_TOOL_BRUSH)
+                                                      .key(BTN_TOOL_PENCIL)
+                                                      .key(BTN_TOOL_AIRBRUSH)
+                                                      .abs_axis(ABS_X, {0, 0, MAX_X, 1, 0, RESOLUTION})
+                                                      .abs_axis(ABS_Y, {0, 0, MAX_Y, 1, 0, RESOLUTION})
+                                                      .abs_axis(ABS_PRESSURE, {0, 0, PRESSURE_MAX, 0, 0, 0})
+                                                      .abs_axis(ABS_DISTANCE, {0, 0, DISTANCE_MAX, 0, 0, 0})
+                                                      .abs_axis(ABS_TILT_X, PEN_ABS_TILT)
+                                                      .abs_axis(ABS_TILT_Y, PEN_ABS_TILT)
+                                                      // https://docs.kernel.org/input/event-codes.html#tablets
+                                                      .property(INPUT_PROP_POINTER)
+                                                      .property(INPUT_PROP_DIRECT);
+
+Result<uinput_ptr> create_tablet(const DeviceDefinition &device) {
+  return create_uinput(tablet_template, device);
 }
 
 PenTablet::PenTablet() : _state(std::make_shared<PenTabletState>()) {}
 
 PenTablet::~PenTablet() {
   if (_state) {
+    _state->writer.flush();
     _state.reset();
   }
 }
@@ -88,7 +68,10 @@ Result<PenTablet> PenTablet::create(const DeviceDefinition &device) {
   if (tablet) {
     PenTablet pt;
     pt._state->pen_tablet = std::move(*tablet);
-    return std::move(pt);
+    if (device.async_writes) {
+      pt._state->writer.start_thread(device.writer_cpu);
+    }
+    return pt;
   } else {
     return Error(tablet.getErrorMessage());
   }
@@ -98,60 +81,123 @@ std::vector<std::string> PenTablet::get_nodes() const {
   std::vector<std::string> nodes;
 
   if (auto kb = _state->pen_tablet.get()) {
-    nodes.emplace_back(libevdev_uinput_get_devnode(kb));
+    if (auto devnode = uinput_get_devnode(kb)) {
+      nodes.emplace_back(devnode);
+    }
   }
 
   return nodes;
 }
 
-static inline float deg2rad(float degree) {
-  return M_PI * degree / 180.0;
+void PenTablet::reset() {
+  _state->writer.run([state = _state.get()]() {
+    if (auto tablet = state->pen_tablet.get()) {
+      for (auto btn : {PRIMARY, SECONDARY, TERTIARY}) {
+        uinput_write_event(tablet, EV_KEY, btn_to_linux.at(btn), 0);
+      }
+      if (state->last_tool != PenTablet::SAME_AS_BEFORE) { // Take the tool out of proximity
+        uinput_write_event(tablet, EV_ABS, ABS_PRESSURE, 0);
+        uinput_write_event(tablet, EV_KEY, tool_to_linux.at(state->last_tool), 0);
+        state->last_tool = PenTablet::SAME_AS_BEFORE;
+      }
+      uinput_write_event(tablet, EV_SYN, SYN_REPORT, 0);
+    }
+  });
 }
 
-void PenTablet::place_tool(
-    PenTablet::TOOL_TYPE tool_type, float x, float y, float pressure, float distance, float tilt_x, float tilt_y) {
-  if (auto tablet = _state->pen_tablet.get()) {
-    if (tool_type != PenTablet::SAME_AS_BEFORE && tool_type != _state->last_tool) {
-      libevdev_uinput_write_event(tablet, EV_KEY, tool_to_linux.at(tool_type), 1);
+/**
+ * A tool position converted to the device units, pressure and distance are -1 when they have to be discarded
+ */
+struct ScaledTool {
+  PenTablet::TOOL_TYPE tool_type;
+  int x, y, pressure, distance, tilt_x, tilt_y;
+};
 
-      if (_state->last_tool != PenTablet::SAME_AS_BEFORE)
-        libevdev_uinput_write_event(tablet, EV_KEY, tool_to_linux.at(_state->last_tool), 0);
+/**
+ * Runs on the writer
+ */
+static void write_tool(PenTabletState *state, const ScaledTool &tool) {
+  if (auto tablet = state->pen_tablet.get()) {
+    if (tool.tool_type != PenTablet::SAME_AS_BEFORE && tool.tool_type != state->last_tool) {
+      uinput_write_event(tablet, EV_KEY, tool_to_linux.at(tool.tool_type), 1);
 
-      _state->last_tool = tool_type;
+      if (state->last_tool != PenTablet::SAME_AS_BEFORE)
+        uinput_write_event(tablet, EV_KEY, tool_to_linux.at(state->last_tool), 0);
+
+      state->last_tool = tool.tool_type;
     }
 
-    int scaled_x = (int)std::lround(MAX_X * x);
-    int scaled_y = (int)std::lround(MAX_Y * y);
-    libevdev_uinput_write_event(tablet, EV_ABS, ABS_X, scaled_x);
-    libevdev_uinput_write_event(tablet, EV_ABS, ABS_Y, scaled_y);
+    uinput_write_event(tablet, EV_ABS, ABS_X, tool.x);
+    uinput_write_event(tablet, EV_ABS, ABS_Y, tool.y);
 
-    if (pressure >= 0) {
-      int scaled_pressure = (int)std::lround(pressure * PRESSURE_MAX);
-      libevdev_uinput_write_event(tablet, EV_ABS, ABS_PRESSURE, scaled_pressure);
+    if (tool.pressure >= 0) {
+      uinput_write_event(tablet, EV_ABS, ABS_PRESSURE, tool.pressure);
     }
 
-    if (distance >= 0) {
-      int scaled_distance = (int)std::lround(distance * DISTANCE_MAX);
-      libevdev_uinput_write_event(tablet, EV_ABS, ABS_DISTANCE, scaled_distance);
+    if (tool.distance >= 0) {
+      uinput_write_event(tablet, EV_ABS, ABS_DISTANCE, tool.distance);
     }
 
-    auto scaled_tilt_x = std::clamp(tilt_x, -90.0f, 90.0f);
-    scaled_tilt_x = deg2rad(scaled_tilt_x * RESOLUTION);
-    libevdev_uinput_write_event(tablet, EV_ABS, ABS_TILT_X, (int)std::lround(scaled_tilt_x));
+    uinput_write_event(tablet, EV_ABS, ABS_TILT_X, tool.tilt_x);
+    uinput_write_event(tablet, EV_ABS, ABS_TILT_Y, tool.tilt_y);
 
-    auto scaled_tilt_y = std::clamp(tilt_y, -90.0f, 90.0f);
-    scaled_tilt_y = deg2rad(scaled_tilt_y * RESOLUTION);
-    libevdev_uinput_write_event(tablet, EV_ABS, ABS_TILT_Y, (int)std::lround(scaled_tilt_y));
+    uinput_write_event(tablet, EV_SYN, SYN_REPORT, 0);
+  }
+}
+
+void PenTablet::place_tool(
+    PenTablet::TOOL_TYPE tool_type, float x, float y, float pressure, float distance, float tilt_x, float tilt_y) {
+  ScaledTool tool = {.tool_type = tool_type,
+                     .x = to_device_units(x, MAX_X),
+                     .y = to_device_units(y, MAX_Y),
+                     .pressure = pressure >= 0 ? to_device_units(pressure, PRESSURE_MAX) : -1,
+                     .distance = distance >= 0 ? to_device_units(distance, DISTANCE_MAX) : -1,
+                     .tilt_x = tilt_to_device_units(tilt_x, RESOLUTION),
+                     .tilt_y = tilt_to_device_units(tilt_y, RESOLUTION)};
+  _state->writer.run([state = _state.get(), tool]() { write_tool(state, tool); });
+}
 
-    libevdev_uinput_write_event(tablet, EV_SYN, SYN_REPORT, 0);
+void PenTablet::place_tools(const Tool *tools, std::size_t count) {
+  constexpr std::size_t CHUNK = 64;
+  std::array<float, CHUNK * 4> frames = {};
+  std::array<float, CHUNK * 2> tilts = {};
+  std::array<int, CHUNK * 4> scaled = {};
+  std::array<int, CHUNK * 2> scaled_tilts = {};
+  for (std::size_t start = 0; start < count; start += CHUNK) {
+    auto chunk = std::min(CHUNK, count - start);
+    for (std::size_t i = 0; i < chunk; i++) {
+      const auto &tool = tools[start + i];
+      frames[i * 4] = tool.x;
+      frames[i * 4 + 1] = tool.y;
+      frames[i * 4 + 2] = tool.pressure;
+      frames[i * 4 + 3] = tool.distance;
+      tilts[i * 2] = tool.tilt_x;
+      tilts[i * 2 + 1] = tool.tilt_y;
+    }
+    to_device_units(frames.data(), scaled.data(), chunk, {MAX_X, MAX_Y, PRESSURE_MAX, DISTANCE_MAX});
+    tilt_to_device_units(tilts.data(), scaled_tilts.data(), chunk * 2, RESOLUTION);
+
+    for (std::size_t i = 0; i < chunk; i++) {
+      const auto &source = tools[start + i];
+      ScaledTool tool = {.tool_type = source.tool_type,
+                         .x = scaled[i * 4],
+                         .y = scaled[i * 4 + 1],
+                         .pressure = source.pressure >= 0 ? scaled[i * 4 + 2] : -1,
+                         .distance = source.distance >= 0 ? scaled[i * 4 + 3] : -1,
+                         .tilt_x = scaled_tilts[i * 2],
+                         .tilt_y = scaled_tilts[i * 2 + 1]};
+      _state->writer.run([state = _state.get(), tool]() { write_tool(state, tool); });
+    }
   }
 }
 
 void PenTablet::set_btn(PenTablet::BTN_TYPE btn, bool pressed) {
-  if (auto tablet = _state->pen_tablet.get()) {
-    libevdev_uinput_write_event(tablet, EV_KEY, btn_to_linux.at(btn), pressed ? 1 : 0);
-    libevdev_uinput_write_event(tablet, EV_SYN, SYN_REPORT, 0);
-  }
+  _state->writer.run([state = _state.get(), btn, pressed]() {
+    if (auto tablet = state->pen_tablet.get()) {
+      uinput_write_event(tablet, EV_KEY, btn_to_linux.at(btn), pressed ? 1 : 0);
+      uinput_write_event(tablet, EV_SYN, SYN_REPORT, 0);
+    }
+  });
 }
 
 } // namespace inputtino
\ No newline at end of file
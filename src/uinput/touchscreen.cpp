@@ -1,6 +1,7 @@
 #include "inputtino/input.hpp"
 #include <cmath>
 #include <cstring>
+#include <inputtino/axis.hpp>
 #include <inputtino/protected_types.hpp>
 
 namespace inputtino {
@@ -9,72 +10,68 @@ std::vector<std::string> TouchScreen::get_nodes() const {
   std::vector<std::string> nodes;
 
   if (auto kb = _state->touch_screen.get()) {
-    nodes.emplace_back(libevdev_uinput_get_devnode(kb));
+    if (auto devnode = uinput_get_devnode(kb)) {
+      nodes.emplace_back(devnode);
+    }
   }
 
   return nodes;
 }
 
+void TouchScreen::reset() {
+  _state->writer.run([state = _state.get()]() {
+    if (auto ts = state->touch_screen.get()) {
+      if (state->fingers.empty()) {
+        return;
+      }
+      for (const auto &[finger_nr, slot] : state->fingers) {
+        uinput_write_event(ts, EV_ABS, ABS_MT_SLOT, slot);
+        uinput_write_event(ts, EV_ABS, ABS_MT_TRACKING_ID, -1);
+      }
+      state->fingers.clear();
+      state->current_slot = -1;
+      uinput_write_event(ts, EV_SYN, SYN_REPORT, 0);
+    }
+  });
+}
+
 static constexpr int TOUCH_MAX_X = 19200;
 static constexpr int TOUCH_MAX_Y = 10800;
 static constexpr int NUM_FINGERS = 16;
 static constexpr int PRESSURE_MAX = 253;
 
-Result<libevdev_uinput_ptr> create_touch_screen(const DeviceDefinition &device) {
-  libevdev *dev = libevdev_new();
-  libevdev_uinput *uidev;
-
-  libevdev_set_name(dev, device.name.c_str());
-  libevdev_set_id_vendor(dev, device.vendor_id);
-  libevdev_set_id_product(dev, device.product_id);
-  libevdev_set_id_version(dev, device.version);
-  libevdev_set_id_bustype(dev, BUS_USB);
-
-  libevdev_enable_event_type(dev, EV_KEY);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_LEFT, nullptr);
-  libevdev_enable_event_code(dev, EV_KEY, BTN_TOUCH, nullptr);
-
-  libevdev_enable_event_type(dev, EV_ABS);
-  input_absinfo mt_slot{0, 0, NUM_FINGERS - 1, 0, 0, 0};
-  libevdev_enable_event_code(dev, EV_ABS, ABS_MT_SLOT, &mt_slot);
-
-  input_absinfo abs_x{0, 0, TOUCH_MAX_X, 0, 0, 0};
-  libevdev_enable_event_code(dev, EV_ABS, ABS_X, &abs_x);
-  libevdev_enable_event_code(dev, EV_ABS, ABS_MT_POSITION_X, &abs_x);
-
-  input_absinfo abs_y{0, 0, TOUCH_MAX_Y, 0, 0, 0};
-  libevdev_enable_event_code(dev, EV_ABS, ABS_Y, &abs_y);
-  libevdev_enable_event_code(dev, EV_ABS, ABS_MT_POSITION_Y, &abs_y);
-
-  input_absinfo tracking{0, 0, 65535, 0, 0, 0};
-  libevdev_enable_event_code(dev, EV_ABS, ABS_MT_TRACKING_ID, &tracking);
-
-  input_absinfo abs_pressure{0, 0, PRESSURE_MAX, 0, 0, 0};
-  libevdev_enable_event_code(dev, EV_ABS, ABS_PRESSURE, &abs_pressure);
-  libevdev_enable_event_code(dev, EV_ABS, ABS_MT_PRESSURE, &abs_pressure);
-  // TODO:
-  //  input_absinfo touch{0, 0, TOUCH_MAX, 4, 0, 0};
-  //  libevdev_enable_event_code(dev, EV_ABS, ABS_MT_TOUCH_MAJOR, &touch);
-  //  libevdev_enable_event_code(dev, EV_ABS, ABS_MT_TOUCH_MINOR, &touch);
-  input_absinfo orientation{0, -90, 90, 0, 0, 0};
-  libevdev_enable_event_code(dev, EV_ABS, ABS_MT_ORIENTATION, &orientation);
-
-  // https://docs.kernel.org/input/event-codes.html#touchscreens
-  libevdev_enable_property(dev, INPUT_PROP_DIRECT);
-
-  auto err = libevdev_uinput_create_from_device(dev, LIBEVDEV_UINPUT_OPEN_MANAGED, &uidev);
-  libevdev_free(dev);
-  if (err != 0) {
-    return Error(strerror(-err));
-  }
-
-  return libevdev_uinput_ptr{uidev, ::libevdev_uinput_destroy};
+static constexpr input_absinfo TOUCH_SCREEN_ABS_X{0, 0, TOUCH_MAX_X, 0, 0, 0};
+static constexpr input_absinfo TOUCH_SCREEN_ABS_Y{0, 0, TOUCH_MAX_Y, 0, 0, 0};
+static constexpr input_absinfo TOUCH_SCREEN_ABS_PRESSURE{0, 0, PRESSURE_MAX, 0, 0, 0};
+
+static constexpr UinputTemplate touch_screen_template =
+    UinputTemplate{}
+        .key(BTN_LEFT)
+        .key(BTN_TOUCH)
+        .abs_axis(ABS_MT_SLOT, {0, 0, NUM_FINGERS - 1, 0, 0, 0})
+        .abs_axis(ABS_X, TOUCH_SCREEN_ABS_X)
+        .abs_axis(ABS_MT_POSITION_X, TOUCH_SCREEN_ABS_X)
+        .abs_axis(ABS_Y, TOUCH_SCREEN_ABS_Y)
+        .abs_axis(ABS_MT_POSITION_Y, TOUCH_SCREEN_ABS_Y)
+        .abs_axis(ABS_MT_TRACKING_ID, {0, 0, 65535, 0, 0, 0})
+        .abs_axis(ABS_PRESSURE, TOUCH_SCREEN_ABS_PRESSURE)
+        .abs_axis(ABS_MT_PRESSURE, TOUCH_SCREEN_ABS_PRESSURE)
+        // TODO:
+        //  .abs_axis(ABS_MT_TOUCH_MAJOR, {0, 0, TOUCH_MAX, 4, 0, 0})
+        //  .abs_axis(ABS_MT_TOUCH_MINOR, {0, 0, TOUCH_MAX, 4, 0, 0})
+        .abs_axis(ABS_MT_ORIENTATION, {0, -90, 90, 0, 0, 0})
+        // https://docs.kernel.org/input/event-codes.html#touchscreens
+        .property(INPUT_PROP_DIRECT);
+
+Result<uinput_ptr> create_touch_screen(const DeviceDefinition &device) {
+  return create_uinput(touch_screen_template, device);
 }
 
 TouchScreen::TouchScreen() : _state(std::make_shared<TouchScreenState>()) {}
 
 TouchScreen::~TouchScreen() {
   if (_state) {
+    _state->writer.flush();
     _state.reset();
   }
 }
@@ -84,57 +81,97 @@ Result<TouchScreen> TouchScreen::create(const DeviceDefinition &device) {
   if (touch_screen) {
     TouchScreen ts;
     ts._state->touch_screen = std::move(*touch_screen);
+    if (device.async_writes) {
+      ts._state->writer.start_thread(device.writer_cpu);
+    }
     return ts;
   } else {
     return Error(touch_screen.getErrorMessage());
   }
 }
 
-void TouchScreen::place_finger(int finger_nr, float x, float y, float pressure, int orientation) {
-  if (auto ts = this->_state->touch_screen.get()) {
-    int scaled_x = (int)std::lround(TOUCH_MAX_X * x);
-    int scaled_y = (int)std::lround(TOUCH_MAX_Y * y);
+/**
+ * Runs on the writer, the coordinates and the pressure have already been converted to the device units
+ */
+static void write_finger(TouchScreenState *state, int finger_nr, int x, int y, int pressure, int orientation) {
+  if (auto ts = state->touch_screen.get()) {
     int scaled_orientation = std::clamp(orientation, -90, 90);
 
-    if (_state->fingers.find(finger_nr) == _state->fingers.end()) {
+    if (state->fingers.find(finger_nr) == state->fingers.end()) {
       // Wow, a wild finger appeared!
-      auto finger_slot = _state->fingers.size() + 1;
-      _state->fingers[finger_nr] = finger_slot;
-      libevdev_uinput_write_event(ts, EV_ABS, ABS_MT_SLOT, finger_slot);
-      libevdev_uinput_write_event(ts, EV_ABS, ABS_MT_TRACKING_ID, finger_slot);
+      auto finger_slot = state->fingers.size() + 1;
+      state->fingers[finger_nr] = finger_slot;
+      uinput_write_event(ts, EV_ABS, ABS_MT_SLOT, finger_slot);
+      uinput_write_event(ts, EV_ABS, ABS_MT_TRACKING_ID, finger_slot);
     } else {
       // I already know this finger, let's check the slot
-      auto finger_slot = _state->fingers[finger_nr];
-      if (_state->current_slot != finger_slot) {
-        libevdev_uinput_write_event(ts, EV_ABS, ABS_MT_SLOT, finger_slot);
-        _state->current_slot = finger_slot;
+      auto finger_slot = state->fingers[finger_nr];
+      if (state->current_slot != finger_slot) {
+        uinput_write_event(ts, EV_ABS, ABS_MT_SLOT, finger_slot);
+        state->current_slot = finger_slot;
       }
     }
 
-    libevdev_uinput_write_event(ts, EV_ABS, ABS_X, scaled_x);
-    libevdev_uinput_write_event(ts, EV_ABS, ABS_MT_POSITION_X, scaled_x);
-    libevdev_uinput_write_event(ts, EV_ABS, ABS_Y, scaled_y);
-    libevdev_uinput_write_event(ts, EV_ABS, ABS_MT_POSITION_Y, scaled_y);
-    libevdev_uinput_write_event(ts, EV_ABS, ABS_PRESSURE, (int)std::lround(pressure * PRESSURE_MAX));
-    libevdev_uinput_write_event(ts, EV_ABS, ABS_MT_PRESSURE, (int)std::lround(pressure * PRESSURE_MAX));
-    libevdev_uinput_write_event(ts, EV_ABS, ABS_MT_ORIENTATION, scaled_orientation);
+    uinput_write_event(ts, EV_ABS, ABS_X, x);
+    uinput_write_event(ts, EV_ABS, ABS_MT_POSITION_X, x);
+    uinput_write_event(ts, EV_ABS, ABS_Y, y);
+    uinput_write_event(ts, EV_ABS, ABS_MT_POSITION_Y, y);
+    uinput_write_event(ts, EV_ABS, ABS_PRESSURE, pressure);
+    uinput_write_event(ts, EV_ABS, ABS_MT_PRESSURE, pressure);
+    uinput_write_event(ts, EV_ABS, ABS_MT_ORIENTATION, scaled_orientation);
 
-    libevdev_uinput_write_event(ts, EV_SYN, SYN_REPORT, 0);
+    uinput_write_event(ts, EV_SYN, SYN_REPORT, 0);
   }
 }
 
-void TouchScreen::release_finger(int finger_nr) {
-  if (auto ts = this->_state->touch_screen.get()) {
-    auto finger_slot = _state->fingers[finger_nr];
-    if (_state->current_slot != finger_slot) {
-      libevdev_uinput_write_event(ts, EV_ABS, ABS_MT_SLOT, finger_slot);
-      _state->current_slot = -1;
-    }
-    _state->fingers.erase(finger_nr);
-    libevdev_uinput_write_event(ts, EV_ABS, ABS_MT_TRACKING_ID, -1);
+void TouchScreen::place_finger(int finger_nr, float x, float y, float pressure, int orientation) {
+  int scaled_x = to_device_units(x, TOUCH_MAX_X);
+  int scaled_y = to_device_units(y, TOUCH_MAX_Y);
+  int scaled_pressure = to_device_units(pressure, PRESSURE_MAX);
+  _state->writer.run([state = _state.get(), finger_nr, scaled_x, scaled_y, scaled_pressure, orientation]() {
+    write_finger(state, finger_nr, scaled_x, scaled_y, scaled_pressure, orientation);
+  });
+}
 
-    libevdev_uinput_write_event(ts, EV_SYN, SYN_REPORT, 0);
+void TouchScreen::place_fingers(const Finger *fingers, std::size_t count) {
+  constexpr std::size_t CHUNK = 64;
+  std::array<float, CHUNK * 4> frames = {};
+  std::array<int, CHUNK * 4> scaled = {};
+  for (std::size_t start = 0; start < count; start += CHUNK) {
+    auto chunk = std::min(CHUNK, count - start);
+    for (std::size_t i = 0; i < chunk; i++) {
+      const auto &finger = fingers[start + i];
+      frames[i * 4] = finger.x;
+      frames[i * 4 + 1] = finger.y;
+      frames[i * 4 + 2] = finger.pressure;
+    }
+    to_device_units(frames.data(), scaled.data(), chunk, {TOUCH_MAX_X, TOUCH_MAX_Y, PRESSURE_MAX, 0});
+
+    for (std::size_t i = 0; i < chunk; i++) {
+      auto finger_nr = fingers[start + i].finger_nr;
+      auto orientation = fingers[start + i].orientation;
+      auto *units = &scaled[i * 4];
+      _state->writer.run([state = _state.get(), finger_nr, x = units[0], y = units[1], p = units[2], orientation]() {
+        write_finger(state, finger_nr, x, y, p, orientation);
+      });
+    }
   }
 }
 
+void TouchScreen::release_finger(int finger_nr) {
+  _state->writer.run([state = _state.get(), finger_nr]() {
+    if (auto ts = state->touch_screen.get()) {
+      auto finger_slot = state->fingers[finger_nr];
+      if (state->current_slot != finger_slot) {
+        uinput_write_event(ts, EV_ABS, ABS_MT_SLOT, finger_slot);
+        state->current_slot = -1;
+      }
+      state->fingers.erase(finger_nr);
+      uinput_write_event(ts, EV_ABS, ABS_MT_TRACKING_ID, -1);
+
+      uinput_write_event(ts, EV_SYN, SYN_REPORT, 0);
+    }
+  });
+}
+
 } // namespace inputtino
\ No newline at end of file
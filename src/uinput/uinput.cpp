@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <inputtino/uinput.hpp>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace inputtino {
+
+/**
+ * The events written on this thread that haven't been sent to the kernel yet, see uinput_write_event()
+ */
+struct PendingEvents {
+  uinput_device *device = nullptr; // nullptr once flushed, the entry (and its capacity) will be reused
+  std::uint64_t generation = 0;    // the address alone might belong to a new device, see uinput_device::generation
+  std::vector<input_event> events;
+  std::size_t complete = 0; // events up to the last SYN_REPORT
+};
+
+static thread_local std::vector<PendingEvents> pending_events;
+/* True while a UinputBatch is alive on this thread */
+static thread_local bool in_batch = false;
+
+static PendingEvents *find_pending(const uinput_device *device) {
+  for (auto &pending : pending_events) {
+    if (pending.device == device && pending.generation == device->generation) {
+      return &pending;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Sends the first `count` events with a single write(), the rest stays queued
+ */
+static int write_pending(PendingEvents &pending, std::size_t count) {
+  // uinput takes as many events as we want in a single write(), it'll process them in order
+  auto &events = pending.events;
+  auto size = static_cast<ssize_t>(count * sizeof(input_event));
+  auto ret = write(pending.device->fd, events.data(), size);
+  auto err = ret < 0 ? errno : EIO;
+  events.erase(events.begin(), events.begin() + static_cast<std::ptrdiff_t>(count)); // keeps the capacity
+  pending.complete = 0;
+  if (events.empty()) {
+    pending.device = nullptr;
+  }
+  return ret == size ? 0 : -err;
+}
+
+static std::atomic<std::uint64_t> next_generation = 1;
+
+uinput_device::uinput_device() : generation(next_generation++) {}
+
+uinput_device::~uinput_device() {
+  // An incomplete frame left on this thread. The ones left on other threads will never match another device, and they
+  // are never sent since the end of a UinputBatch only sends whole frames.
+  if (auto pending = find_pending(this)) {
+    pending->device = nullptr;
+    pending->events.clear();
+    pending->complete = 0;
+  }
+  if (fd >= 0) {
+    ioctl(fd, UI_DEV_DESTROY);
+    close(fd);
+  }
+}
+
+/**
+ * Before Linux 4.5 (uinput version 5) there's no UI_DEV_SETUP/UI_ABS_SETUP,
+ * the device has to be described by writing a `uinput_user_dev` instead
+ */
+static int legacy_setup(int fd, const UinputTemplate &capabilities, const DeviceDefinition &device, const char *name) {
+  uinput_user_dev dev{};
+  std::strncpy(dev.name, name, UINPUT_MAX_NAME_SIZE - 1);
+  dev.id = {.bustype = BUS_USB, .vendor = device.vendor_id, .product = device.product_id, .version = device.version};
+  dev.ff_effects_max = capabilities.ff_effects_max;
+  capabilities.abs.for_each([&](int code) {
+    dev.absmin[code] = capabilities.absinfo[code].minimum;
+    dev.absmax[code] = capabilities.absinfo[code].maximum;
+    dev.absfuzz[code] = capabilities.absinfo[code].fuzz;
+    dev.absflat[code] = capabilities.absinfo[code].flat;
+  });
+  return write(fd, &dev, sizeof(dev)) == sizeof(dev) ? 0 : -1;
+}
+
+static int setup(int fd, const UinputTemplate &capabilities, const DeviceDefinition &device, const char *name) {
+  int version = 0;
+  if (ioctl(fd, UI_GET_VERSION, &version) < 0 || version < 5) {
+    return legacy_setup(fd, capabilities, device, name);
+  }
+
+  int err = 0;
+  capabilities.abs.for_each([&](int code) {
+    uinput_abs_setup abs_setup{.code = static_cast<__u16>(code), .absinfo = capabilities.absinfo[code]};
+    err |= ioctl(fd, UI_ABS_SETUP, &abs_setup);
+  });
+
+  uinput_setup dev{};
+  std::strncpy(dev.name, name, UINPUT_MAX_NAME_SIZE - 1);
+  dev.id = {.bustype = BUS_USB, .vendor = device.vendor_id, .product = device.product_id, .version = device.version};
+  dev.ff_effects_max = capabilities.ff_effects_max;
+  return err | ioctl(fd, UI_DEV_SETUP, &dev);
+}
+
+/**
+ * Enables all the event types and codes set in `capabilities`
+ */
+static int set_bits(int fd, const UinputTemplate &capabilities) {
+  int err = 0;
+  auto enable = [&](const auto &bitmap, int ev_type, unsigned long request) {
+    if (!bitmap.empty()) {
+      err |= ioctl(fd, UI_SET_EVBIT, ev_type);
+      bitmap.for_each([&](int code) { err |= ioctl(fd, request, code); });
+    }
+  };
+  enable(capabilities.keys, EV_KEY, UI_SET_KEYBIT);
+  enable(capabilities.rels, EV_REL, UI_SET_RELBIT);
+  enable(capabilities.abs, EV_ABS, UI_SET_ABSBIT);
+  enable(capabilities.msc, EV_MSC, UI_SET_MSCBIT);
+  enable(capabilities.ff, EV_FF, UI_SET_FFBIT);
+  capabilities.props.for_each([&](int prop) { err |= ioctl(fd, UI_SET_PROPBIT, prop); });
+  return err;
+}
+
+/**
+ * The evdev handler is connected synchronously on UI_DEV_CREATE,
+ * so by now the `eventX` child is already there
+ */
+static std::string find_devnode(const std::string &syspath) {
+  std::string devnode;
+  if (auto dir = opendir(syspath.c_str())) {
+    while (auto entry = readdir(dir)) {
+      if (std::strncmp(entry->d_name, "event", 5) == 0) {
+        devnode = std::string("/dev/input/") + entry->d_name;
+        break;
+      }
+    }
+    closedir(dir);
+  }
+  return devnode;
+}
+
+Result<uinput_ptr> create_uinput(const UinputTemplate &capabilities, const DeviceDefinition &device, const char *name) {
+  hotplug_generation(); // Start listening for uevents before the device is created, see NodeCache
+  auto dev = std::make_shared<uinput_device>();
+  dev->fd = open("/dev/uinput", O_RDWR | O_CLOEXEC);
+  if (dev->fd < 0) {
+    return Error(strerror(errno));
+  }
+
+  auto dev_name = name ? name : device.name.c_str();
+  if (set_bits(dev->fd, capabilities) < 0 || setup(dev->fd, capabilities, device, dev_name) < 0 ||
+      ioctl(dev->fd, UI_DEV_CREATE) < 0) {
+    return Error(strerror(errno));
+  }
+
+  char sysname[64] = {};
+  if (ioctl(dev->fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) >= 0) {
+    dev->syspath = std::string("/sys/devices/virtual/input/") + sysname;
+    dev->devnode = find_devnode(dev->syspath);
+  }
+
+  return dev;
+}
+
+int uinput_write_event(uinput_device *device, unsigned int type, unsigned int code, int value) {
+  auto pending = find_pending(device);
+  if (!pending) {
+    auto free = std::find_if(pending_events.begin(), pending_events.end(), [](const auto &p) { return !p.device; });
+    pending = free != pending_events.end() ? &*free : &pending_events.emplace_back();
+    pending->device = device;
+    pending->generation = device->generation;
+  }
+
+  input_event ev{};
+  ev.type = static_cast<__u16>(type);
+  ev.code = static_cast<__u16>(code);
+  ev.value = value;
+  pending->events.push_back(ev);
+
+  if (type != EV_SYN || code != SYN_REPORT) {
+    return 0;
+  }
+  pending->complete = pending->events.size();
+  return in_batch ? 0 : write_pending(*pending, pending->complete);
+}
+
+int uinput_flush(uinput_device *device) {
+  auto pending = find_pending(device);
+  return pending ? write_pending(*pending, pending->events.size()) : 0;
+}
+
+UinputBatch::UinputBatch() {
+  if (!in_batch) {
+    in_batch = true;
+    outermost = true;
+  }
+}
+
+UinputBatch::~UinputBatch() {
+  if (outermost) {
+    in_batch = false;
+    for (auto &pending : pending_events) {
+      if (pending.device && pending.complete > 0) { // An incomplete frame waits for the rest of its events
+        write_pending(pending, pending.complete);
+      }
+    }
+  }
+}
+
+} // namespace inputtino
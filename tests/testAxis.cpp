@@ -0,0 +1,190 @@
+#include "catch2/catch_all.hpp"
+#include <array>
+#include <cmath>
+#include <inputtino/axis.hpp>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace inputtino;
+
+/* The formulas that were used before, the kernels must give the same results */
+static int reference_scale_value(int input, int input_start, int input_end, int output_start, int output_end) {
+  auto slope = 1.0 * (output_end - output_start) / (input_end - input_start);
+  return output_start + std::round(slope * (input - input_start));
+}
+
+static int reference_tilt(float degrees, int resolution) {
+  auto scaled = std::clamp(degrees, -90.0f, 90.0f);
+  float radians = M_PI * (scaled * resolution) / 180.0;
+  return (int)std::lround(radians);
+}
+
+TEST_CASE("Stick to PS5 byte", "[AXIS]") {
+  for (int value = -32768; value <= 32767; value++) {
+    REQUIRE(stick_to_ps5(static_cast<std::int16_t>(value)) == reference_scale_value(value, -32768, 32767, 0, 255));
+  }
+  REQUIRE(stick_to_ps5(0) == 0x80);
+
+  std::array<std::int16_t, 5> sticks = {-32768, -1, 0, 1, 32767};
+  std::array<std::uint8_t, 5> bytes = {};
+  stick_to_ps5(sticks.data(), bytes.data(), sticks.size());
+  REQUIRE(bytes == std::array<std::uint8_t, 5>{0, 127, 128, 128, 255});
+
+  REQUIRE(trigger_to_ps5(0) == 0);
+  REQUIRE(trigger_to_ps5(255) == 255);
+  REQUIRE(trigger_to_ps5(-1) == 0);
+  REQUIRE(trigger_to_ps5(300) == 255);
+}
+
+TEST_CASE("Normalised floats to device units", "[AXIS]") {
+  for (int max : {253, 1024, 1920, 19200}) {
+    for (int i = -1000; i <= 101000; i++) {
+      float value = i / 100000.0f;
+      REQUIRE(to_device_units(value, max) == (int)std::lround(max * value));
+    }
+    // Exactly half way and the floats right around it
+    float half = 0.5f / max;
+    for (float value : {half, std::nextafter(half, 0.0f), std::nextafter(half, 1.0f), -half}) {
+      REQUIRE(to_device_units(value, max) == (int)std::lround(max * value));
+    }
+  }
+
+  std::array<float, 3> values = {0.0f, 0.5f, 1.0f};
+  std::array<int, 3> units = {};
+  to_device_units(values.data(), units.data(), values.size(), 1920);
+  REQUIRE(units == std::array<int, 3>{0, 960, 1920});
+}
+
+TEST_CASE("NaN and out of range values", "[AXIS]") {
+  constexpr float nan = std::numeric_limits<float>::quiet_NaN();
+  constexpr float inf = std::numeric_limits<float>::infinity();
+
+  REQUIRE(to_device_units(nan, 1920) == 0);
+  REQUIRE(to_device_units(inf, 1920) == INT32_MAX);
+  REQUIRE(to_device_units(-inf, 1920) == INT32_MIN);
+  REQUIRE(to_device_units(1e10f, 1920) == INT32_MAX);
+  REQUIRE(to_device_units(-1e10f, 1920) == INT32_MIN);
+  REQUIRE(to_device_units(inf, 0) == 0); // 0 * inf is NaN
+
+  REQUIRE(tilt_to_device_units(nan, 28) == 0);
+  REQUIRE(tilt_to_device_units(inf, 28) == reference_tilt(90.0f, 28));
+  REQUIRE(tilt_to_device_units(-inf, 28) == reference_tilt(-90.0f, 28));
+
+  REQUIRE(motion_to_ps5(nan, 980.665f) == 0);
+  REQUIRE(motion_to_ps5(inf, 980.665f) == 32767);
+  REQUIRE(motion_to_ps5(-inf, 980.665f) == -32768);
+  REQUIRE(motion_to_ps5(1e10f, 980.665f) == 32767);
+  REQUIRE(motion_to_ps5(inf, 0.0f) == 0);
+}
+
+TEST_CASE("Pen tilt to device units", "[AXIS]") {
+  for (int i = -100000; i <= 100000; i++) {
+    float degrees = i / 1000.0f;
+    REQUIRE(tilt_to_device_units(degrees, 28) == reference_tilt(degrees, 28));
+  }
+}
+
+TEST_CASE("Pixels to absolute mouse units", "[AXIS]") {
+  REQUIRE(scale_to_range(0, 1920, 19200) == 0);
+  REQUIRE(scale_to_range(1920, 1920, 19200) == 19200);
+  REQUIRE(scale_to_range(1280, 2560, 19200) == 9600);
+  // 19200 / 2560 is 7.5: an integer division would have given 7 * 2559 = 17913
+  REQUIRE(scale_to_range(2559, 2560, 19200) == 19193);
+  REQUIRE(scale_to_range(1, 3, 1) == 0);
+  REQUIRE(scale_to_range(3, 2, 1) == 2);
+  REQUIRE(scale_to_range(-3, 2, 1) == -2);
+
+  for (int width : {1280, 1366, 1920, 2560, 3840}) {
+    for (int x = 0; x <= width; x++) {
+      REQUIRE(scale_to_range(x, width, 19200) == (int)std::lround(19200.0 * x / width));
+    }
+  }
+}
+
+static std::vector<SimdLevel> simd_levels() {
+  std::vector<SimdLevel> levels = {SimdLevel::SCALAR};
+  for (auto level : {SimdLevel::SSE2, SimdLevel::AVX2}) {
+    if (set_simd_level(level) == level) {
+      levels.push_back(level);
+    }
+  }
+  return levels;
+}
+
+TEST_CASE("Batch kernels give the same results as the scalar ones", "[AXIS]") {
+  auto default_level = get_simd_level();
+  // An odd number of samples, so that the scalar tails are covered as well
+  constexpr std::size_t COUNT = 1001;
+  std::vector<float> values(COUNT * 6);
+  for (std::size_t i = 0; i < values.size(); i++) {
+    values[i] = std::sin(i * 0.37f) * (i % 7 == 0 ? 150.0f : 1.2f);
+  }
+  // Spread over all the lanes of the vectors and the scalar tails
+  const std::array<float, 6> special = {std::numeric_limits<float>::quiet_NaN(),
+                                        std::numeric_limits<float>::infinity(),
+                                        -std::numeric_limits<float>::infinity(),
+                                        1e10f,
+                                        -1e10f,
+                                        -0.0f};
+  for (std::size_t i = 0; i < values.size(); i += 11) {
+    values[i] = special[(i / 11) % special.size()];
+  }
+  values[values.size() - 1] = special[0];
+  const std::array<int, 4> max = {19200, 10800, 253, 1024};
+  const std::array<float, 6> scale = {980.665f, 980.665f, 980.665f, 1145.9f, 1200.1f, 1100.3f};
+
+  for (auto level : simd_levels()) {
+    INFO("SIMD level " << static_cast<int>(level));
+    REQUIRE(set_simd_level(level) == level);
+
+    std::vector<int> units(COUNT * 4);
+    to_device_units(values.data(), units.data(), COUNT, max);
+    for (std::size_t i = 0; i < units.size(); i++) {
+      REQUIRE(units[i] == to_device_units(values[i], max[i % 4]));
+    }
+
+    std::vector<int> tilts(COUNT);
+    tilt_to_device_units(values.data(), tilts.data(), COUNT, 28);
+    for (std::size_t i = 0; i < tilts.size(); i++) {
+      REQUIRE(tilts[i] == tilt_to_device_units(values[i], 28));
+    }
+
+    std::vector<std::int16_t> motion(COUNT * 6);
+    motion_to_ps5(values.data(), motion.data(), COUNT, scale);
+    for (std::size_t i = 0; i < motion.size(); i++) {
+      REQUIRE(motion[i] == motion_to_ps5(values[i], scale[i % 6]));
+    }
+  }
+  set_simd_level(default_level);
+}
+
+TEST_CASE("Batch kernels throughput", "[AXIS][!benchmark]") {
+  // Each benchmark converts 1024 samples: samples/sec = 1024 / mean time
+  constexpr std::size_t COUNT = 1024;
+  std::vector<float> values(COUNT * 6, 0.42f);
+  std::vector<int> units(COUNT * 4);
+  std::vector<std::int16_t> motion(COUNT * 6);
+
+  auto default_level = get_simd_level();
+  for (auto level : simd_levels()) {
+    set_simd_level(level);
+    auto name = std::to_string(static_cast<int>(level));
+
+    BENCHMARK("touch/pen frames {x, y, pressure, distance}, SIMD level " + name) {
+      to_device_units(values.data(), units.data(), COUNT, {19200, 10800, 253, 1024});
+      return units[0];
+    };
+
+    BENCHMARK("pen tilt, SIMD level " + name) {
+      tilt_to_device_units(values.data(), units.data(), COUNT, 28);
+      return units[0];
+    };
+
+    BENCHMARK("motion samples {accel[3], gyro[3]}, SIMD level " + name) {
+      motion_to_ps5(values.data(), motion.data(), COUNT, {980.665f, 980.665f, 980.665f, 1145.9f, 1145.9f, 1145.9f});
+      return motion[0];
+    };
+  }
+  set_simd_level(default_level);
+}
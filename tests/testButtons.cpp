@@ -0,0 +1,61 @@
+#include "catch2/catch_all.hpp"
+#include <inputtino/joypad_buttons.hpp>
+#include <linux/input-event-codes.h>
+
+using namespace inputtino;
+
+TEST_CASE("Dpad hat LUT", "[JOYPAD]") {
+  REQUIRE(HAT_LUT[0].x == 0);
+  REQUIRE(HAT_LUT[0].y == 0);
+  REQUIRE(HAT_LUT[0].hid == 8);
+
+  REQUIRE(HAT_LUT[Joypad::DPAD_UP].y == -1);
+  REQUIRE(HAT_LUT[Joypad::DPAD_UP].hid == 0);
+  REQUIRE(HAT_LUT[Joypad::DPAD_DOWN | Joypad::DPAD_RIGHT].x == 1);
+  REQUIRE(HAT_LUT[Joypad::DPAD_DOWN | Joypad::DPAD_RIGHT].y == 1);
+  REQUIRE(HAT_LUT[Joypad::DPAD_DOWN | Joypad::DPAD_RIGHT].hid == 3);
+  REQUIRE(HAT_LUT[Joypad::DPAD_LEFT].hid == 6);
+
+  // Opposite directions: UP and LEFT win
+  REQUIRE(HAT_LUT[Joypad::DPAD_UP | Joypad::DPAD_DOWN].y == -1);
+  REQUIRE(HAT_LUT[DPAD_MASK].x == -1);
+  REQUIRE(HAT_LUT[DPAD_MASK].hid == 7);
+}
+
+TEST_CASE("Button tables and profiles", "[JOYPAD]") {
+  constexpr auto mappings = std::array<ButtonMapping, 2>{{{Joypad::A, BTN_SOUTH}, {Joypad::X, BTN_NORTH}}};
+
+  constexpr auto table = make_button_table<DefaultButtonProfile>(mappings);
+  REQUIRE(table[__builtin_ctz(Joypad::A)] == BTN_SOUTH);
+  REQUIRE(table[__builtin_ctz(Joypad::X)] == BTN_NORTH);
+  REQUIRE(table[__builtin_ctz(Joypad::B)] == -1);
+
+  constexpr auto swapped = make_button_table<SwapABXYButtonProfile>(mappings);
+  REQUIRE(swapped[__builtin_ctz(Joypad::B)] == BTN_SOUTH);
+  REQUIRE(swapped[__builtin_ctz(Joypad::Y)] == BTN_NORTH);
+  REQUIRE(swapped[__builtin_ctz(Joypad::A)] == -1);
+
+  struct RotateProfile { // A -> B -> X -> A
+    static constexpr Joypad::CONTROLLER_BTN remap(Joypad::CONTROLLER_BTN button) {
+      switch (button) {
+      case Joypad::A:
+        return Joypad::B;
+      case Joypad::B:
+        return Joypad::X;
+      case Joypad::X:
+        return Joypad::A;
+      default:
+        return button;
+      }
+    }
+  };
+  constexpr auto rotated = make_button_table<RotateProfile>(
+      std::array<ButtonMapping, 3>{{{Joypad::A, BTN_SOUTH}, {Joypad::B, BTN_EAST}, {Joypad::X, BTN_NORTH}}});
+  REQUIRE(rotated[__builtin_ctz(Joypad::A)] == BTN_EAST); // pressing A on the client presses B
+  REQUIRE(rotated[__builtin_ctz(Joypad::B)] == BTN_NORTH);
+  REQUIRE(rotated[__builtin_ctz(Joypad::X)] == BTN_SOUTH);
+
+  int visited = 0;
+  for_each_bit(Joypad::A | Joypad::HOME | Joypad::DPAD_UP, [&](int bit) { visited |= 1 << bit; });
+  REQUIRE(visited == (Joypad::A | Joypad::HOME | Joypad::DPAD_UP));
+}
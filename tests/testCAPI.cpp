@@ -1,6 +1,7 @@
 #include "catch2/catch_all.hpp"
 #include <filesystem>
 #include <inputtino/input.h>
+#include <thread>
 
 TEST_CASE("C Mouse API", "[C-API]") {
   InputtinoErrorHandler error_handler = {.eh = [](const char *message, void *_data) { FAIL(message); },
@@ -11,12 +12,9 @@ TEST_CASE("C Mouse API", "[C-API]") {
 
   int num_nodes = 0;
   auto nodes = inputtino_mouse_get_nodes(mouse, &num_nodes);
-  REQUIRE(num_nodes == 2);
+  REQUIRE(num_nodes == 1); // The absolute device is only created on the first absolute movement
   REQUIRE_THAT(std::string(nodes[0]), Catch::Matchers::StartsWith("/dev/input/event"));
-  REQUIRE_THAT(std::string(nodes[1]), Catch::Matchers::StartsWith("/dev/input/event"));
-
   REQUIRE(std::filesystem::exists(nodes[0]));
-  REQUIRE(std::filesystem::exists(nodes[1]));
 
   { // TODO: test that this actually work
     inputtino_mouse_move(mouse, 100, 100);
@@ -27,6 +25,12 @@ TEST_CASE("C Mouse API", "[C-API]") {
     inputtino_mouse_scroll_horizontal(mouse, 125);
   }
 
+  delete[] nodes;
+  nodes = inputtino_mouse_get_nodes(mouse, &num_nodes);
+  REQUIRE(num_nodes == 2);
+  REQUIRE_THAT(std::string(nodes[1]), Catch::Matchers::StartsWith("/dev/input/event"));
+  REQUIRE(std::filesystem::exists(nodes[1]));
+
   delete[] nodes;
   inputtino_mouse_destroy(mouse);
 }
@@ -186,8 +190,15 @@ TEST_CASE("C PS5 API", "[C-API]") {
   REQUIRE(ps_pad != nullptr);
 
   int num_nodes = 0;
-  auto nodes = inputtino_joypad_ps5_get_nodes(ps_pad, &num_nodes);
-  REQUIRE(num_nodes == 0); // TODO: implement this!
+  char **nodes = nullptr;
+  // Nodes are created asynchronously, once the kernel driver has picked up the device
+  for (int retry = 0; retry < 100 && num_nodes == 0; retry++) {
+    delete[] nodes;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    nodes = inputtino_joypad_ps5_get_nodes(ps_pad, &num_nodes);
+  }
+  REQUIRE(num_nodes > 0);
+  REQUIRE(std::filesystem::exists(nodes[0]));
 
   { // TODO: test that this actually work
     inputtino_joypad_ps5_set_pressed_buttons(ps_pad, INPUTTINO_JOYPAD_BTN::A | INPUTTINO_JOYPAD_BTN::B);
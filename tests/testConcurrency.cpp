@@ -0,0 +1,203 @@
+#include "catch2/catch_all.hpp"
+#include <algorithm>
+#include <array>
+#include <fcntl.h>
+#include <inputtino/seqlock.hpp>
+#include <inputtino/serial_writer.hpp>
+#include <new>
+#include <sys/ioctl.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace inputtino;
+
+TEST_CASE("SerialWriter runs one command at a time", "[CONCURRENCY]") {
+  constexpr int THREADS = 4;
+  constexpr int COMMANDS = 20000;
+
+  SerialWriter writer;
+  std::atomic<int> running = 0;
+  bool overlapped = false;
+  std::vector<int> last_seen(THREADS, -1);
+  bool out_of_order = false;
+  long total = 0;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < COMMANDS; i++) {
+        writer.run([&, t, i]() {
+          if (running.fetch_add(1) != 0) {
+            overlapped = true;
+          }
+          if (last_seen[t] != i - 1) {
+            out_of_order = true;
+          }
+          last_seen[t] = i;
+          total++;
+          running.fetch_sub(1);
+        });
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  writer.flush();
+
+  REQUIRE(!overlapped);
+  REQUIRE(!out_of_order);
+  REQUIRE(total == THREADS * COMMANDS);
+}
+
+TEST_CASE("SeqLock readers never see a torn value", "[CONCURRENCY]") {
+  struct Value {
+    int a;
+    short b;
+    int16_t c;
+    long d;
+  };
+  SeqLock<Value> lock;
+  REQUIRE(lock.read().d == 0);
+
+  std::atomic<bool> done = false;
+  std::thread writer([&]() {
+    for (int i = 1; i <= 100000; i++) {
+      lock.write([i](Value &value) { value = {i, static_cast<short>(i), static_cast<int16_t>(-i), -i}; });
+    }
+    done = true;
+  });
+
+  bool torn = false;
+  while (!done) {
+    auto value = lock.read();
+    if (value.b != static_cast<short>(value.a) || value.c != static_cast<int16_t>(-value.a) || value.d != -value.a) {
+      torn = true;
+    }
+  }
+  writer.join();
+
+  REQUIRE(!torn);
+  REQUIRE(lock.read().a == 100000);
+}
+
+TEST_CASE("SerialWriter on a dedicated thread", "[CONCURRENCY]") {
+  SerialWriter writer;
+  writer.start_thread();
+
+  std::vector<int> order;
+  for (int i = 0; i < 1000; i++) {
+    writer.run([&order, i]() { order.push_back(i); });
+  }
+  writer.flush();
+
+  REQUIRE(order.size() == 1000);
+  REQUIRE(std::is_sorted(order.begin(), order.end()));
+}
+
+TEST_CASE("UinputBatch sends whole frames at the end", "[CONCURRENCY]") {
+  int pipe_fds[2];
+  REQUIRE(pipe2(pipe_fds, O_NONBLOCK) == 0);
+  uinput_device device;
+  device.fd = pipe_fds[1];
+
+  auto queued = [&]() {
+    int size = 0;
+    ioctl(pipe_fds[0], FIONREAD, &size);
+    return size / static_cast<int>(sizeof(input_event));
+  };
+
+  uinput_write_event(&device, EV_KEY, BTN_LEFT, 1);
+  REQUIRE(queued() == 0); // frame not complete yet
+  uinput_write_event(&device, EV_SYN, SYN_REPORT, 0);
+  REQUIRE(queued() == 2);
+
+  {
+    UinputBatch batch;
+    for (int i = 0; i < 10; i++) {
+      uinput_write_event(&device, EV_REL, REL_X, i);
+      uinput_write_event(&device, EV_SYN, SYN_REPORT, 0);
+    }
+    REQUIRE(queued() == 2);
+  }
+  REQUIRE(queued() == 22);
+
+  std::array<input_event, 22> events = {};
+  REQUIRE(read(pipe_fds[0], events.data(), sizeof(events)) == sizeof(events));
+  REQUIRE(events[2].code == REL_X);
+  REQUIRE(events[20].value == 9);
+  REQUIRE(events[21].type == EV_SYN);
+
+  device.fd = -1;
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+}
+
+TEST_CASE("Frames written from different threads don't mix", "[CONCURRENCY]") {
+  int pipe_fds[2];
+  REQUIRE(pipe2(pipe_fds, 0) == 0);
+  uinput_device device;
+  device.fd = pipe_fds[1];
+
+  constexpr int FRAMES = 2000;
+  auto writer = [&device](int id) {
+    for (int i = 0; i < FRAMES; i++) {
+      uinput_write_event(&device, EV_REL, REL_X, id);
+      uinput_write_event(&device, EV_REL, REL_Y, id);
+      uinput_write_event(&device, EV_SYN, SYN_REPORT, 0);
+    }
+  };
+  std::thread first(writer, 1), second(writer, 2);
+
+  std::vector<input_event> events(2 * FRAMES * 3);
+  std::size_t read_bytes = 0;
+  auto total = events.size() * sizeof(input_event);
+  while (read_bytes < total) {
+    auto ret = read(pipe_fds[0], reinterpret_cast<char *>(events.data()) + read_bytes, total - read_bytes);
+    REQUIRE(ret > 0);
+    read_bytes += ret;
+  }
+  first.join();
+  second.join();
+
+  for (std::size_t i = 0; i < events.size(); i += 3) {
+    REQUIRE(events[i].code == REL_X);
+    REQUIRE(events[i + 1].code == REL_Y);
+    REQUIRE(events[i + 1].value == events[i].value);
+    REQUIRE(events[i + 2].type == EV_SYN);
+  }
+
+  device.fd = -1;
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+}
+
+TEST_CASE("A new device at the same address doesn't inherit queued events", "[CONCURRENCY]") {
+  int pipe_fds[2];
+  REQUIRE(pipe2(pipe_fds, O_NONBLOCK) == 0);
+  alignas(uinput_device) unsigned char storage[sizeof(uinput_device)];
+
+  auto device = new (storage) uinput_device();
+  uinput_write_event(device, EV_REL, REL_X, 1); // An incomplete frame, left on this thread
+
+  // Destroyed on another thread, a new device takes its place
+  std::thread([&]() {
+    device->~uinput_device();
+    device = new (storage) uinput_device();
+    device->fd = pipe_fds[1];
+  }).join();
+
+  uinput_write_event(device, EV_REL, REL_Y, 2);
+  uinput_write_event(device, EV_SYN, SYN_REPORT, 0);
+
+  std::array<input_event, 3> events = {};
+  REQUIRE(read(pipe_fds[0], events.data(), sizeof(events)) == 2 * sizeof(input_event));
+  REQUIRE(events[0].code == REL_Y);
+  REQUIRE(events[1].type == EV_SYN);
+
+  device->fd = -1;
+  device->~uinput_device();
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+}
@@ -0,0 +1,182 @@
+#include "catch2/catch_all.hpp"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <inputtino/conditioning.hpp>
+#include <thread>
+
+using namespace inputtino;
+using Catch::Matchers::WithinAbs;
+
+TEST_CASE("Default conditioning leaves the values untouched", "[CONDITIONING]") {
+  JoypadConditioning conditioning;
+  REQUIRE(conditioning.stick(Joypad::LS, 123, -32768) == std::pair<short, short>{123, -32768});
+  REQUIRE(conditioning.triggers(0, 255) == std::pair<std::int16_t, std::int16_t>{0, 255});
+
+  SerialWriter writer;
+  REQUIRE(conditioning.configure(writer, Joypad::LS, {.deadzone = 0.2f}));
+  REQUIRE(conditioning.configure(writer, Joypad::LS, StickConditioning{}));
+  REQUIRE(conditioning.stick(Joypad::LS, 1000, -1000) == std::pair<short, short>{1000, -1000});
+}
+
+TEST_CASE("Radial deadzone", "[CONDITIONING]") {
+  JoypadConditioning conditioning;
+  SerialWriter writer;
+  REQUIRE(conditioning.configure(writer, Joypad::RS, {.deadzone_type = StickConditioning::RADIAL, .deadzone = 0.1f}));
+
+  // Only the right stick is affected
+  REQUIRE(conditioning.stick(Joypad::LS, 2000, 2000) == std::pair<short, short>{2000, 2000});
+
+  // Inside the circle, even if each axis alone would be outside an axial deadzone
+  REQUIRE(conditioning.stick(Joypad::RS, 2000, 2000) == std::pair<short, short>{0, 0});
+  REQUIRE(conditioning.stick(Joypad::RS, 3000, 0) == std::pair<short, short>{0, 0});
+
+  auto [x, y] = conditioning.stick(Joypad::RS, 32767, 0);
+  REQUIRE(x == 32767);
+  REQUIRE(y == 0);
+
+  // The direction is preserved, the magnitude is rescaled: half way between the deadzone and the full range
+  auto half = 0.55f * 32767 / std::sqrt(2.0f);
+  std::tie(x, y) = conditioning.stick(Joypad::RS, half, -half);
+  REQUIRE(x == -y);
+  REQUIRE_THAT(std::hypot(x, y) / 32767.0, WithinAbs(0.5, 0.002));
+}
+
+TEST_CASE("Axial deadzone, anti deadzone and curves", "[CONDITIONING]") {
+  JoypadConditioning conditioning;
+  SerialWriter writer;
+  REQUIRE(conditioning.configure(
+      writer,
+      Joypad::LS,
+      {.deadzone_type = StickConditioning::AXIAL, .deadzone = 0.1f, .anti_deadzone = 0.2f, .exponent = 2.0f}));
+
+  auto [x, y] = conditioning.stick(Joypad::LS, 3000, 20000);
+  REQUIRE(x == 0);
+  float expected = 0.2f + 0.8f * std::pow((20000 / 32767.0f - 0.1f) / 0.9f, 2.0f);
+  REQUIRE_THAT(y / 32767.0, WithinAbs(expected, 0.0001));
+
+  // Right outside the deadzone we jump to the anti deadzone
+  std::tie(x, y) = conditioning.stick(Joypad::LS, -3300, 32767);
+  REQUIRE_THAT(x / 32767.0, WithinAbs(-0.2, 0.001));
+  REQUIRE(y == 32767);
+
+  REQUIRE(conditioning.configure(
+      writer, Joypad::LS, {.deadzone_type = StickConditioning::AXIAL, .curve = [](float) { return 1.0f; }}));
+  REQUIRE(conditioning.stick(Joypad::LS, 1, -1) == std::pair<short, short>{32767, -32767});
+}
+
+TEST_CASE("Smoothing", "[CONDITIONING]") {
+  JoypadConditioning conditioning;
+  SerialWriter writer;
+  REQUIRE(conditioning.configure(writer, Joypad::LS, {.smoothing = 0.5f}));
+
+  REQUIRE(conditioning.stick(Joypad::LS, 32000, 0).first == 16000);
+  REQUIRE(conditioning.stick(Joypad::LS, 32000, 0).first == 24000);
+  REQUIRE(conditioning.stick(Joypad::LS, 32000, 0).first == 28000);
+
+  conditioning.reset();
+  REQUIRE(conditioning.stick(Joypad::LS, 32000, 0).first == 16000);
+}
+
+TEST_CASE("Smoothing reaches the last value without new samples", "[CONDITIONING]") {
+  SerialWriter writer;
+  JoypadConditioning conditioning;
+  std::atomic<int> settles = 0;
+  std::atomic<short> last_x = -1;
+  conditioning.on_settle([&]() {
+    settles++;
+    writer.run([&conditioning, &last_x]() {
+      auto [x, y] = conditioning.last_stick(Joypad::LS);
+      last_x = conditioning.stick(Joypad::LS, x, y).first;
+    });
+  });
+  REQUIRE(conditioning.configure(writer, Joypad::LS, {.smoothing = 0.5f}));
+
+  // The client only sends the release, once
+  std::pair<short, short> released;
+  writer.run([&conditioning, &released]() {
+    conditioning.stick(Joypad::LS, 32000, 0);
+    released = conditioning.stick(Joypad::LS, 0, 0);
+  });
+  writer.flush();
+  REQUIRE(released.first == 8000);
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (last_x != 0 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(JoypadConditioning::SETTLE_INTERVAL);
+  }
+  REQUIRE(last_x == 0);
+
+  // Once there, the settle thread goes back to sleep
+  writer.flush();
+  std::this_thread::sleep_for(5 * JoypadConditioning::SETTLE_INTERVAL);
+  auto settled = settles.load();
+  std::this_thread::sleep_for(5 * JoypadConditioning::SETTLE_INTERVAL);
+  REQUIRE(settles == settled);
+  bool settling = true;
+  writer.run([&conditioning, &settling]() { settling = conditioning.settling(Joypad::LS); });
+  writer.flush();
+  REQUIRE(!settling);
+
+  conditioning.stop_settling();
+}
+
+TEST_CASE("Restoring the default conditioning", "[CONDITIONING]") {
+  JoypadConditioning conditioning;
+  SerialWriter writer;
+  REQUIRE(conditioning.configure(writer, Joypad::LS, {.deadzone = 0.2f}));
+  REQUIRE(conditioning.configure(writer, Joypad::RS, {.smoothing = 0.5f}));
+  REQUIRE(conditioning.configure(writer, TriggerConditioning{.deadzone = 0.5f}));
+
+  conditioning.restore_defaults(writer);
+  REQUIRE(conditioning.stick(Joypad::LS, 2000, 2000) == std::pair<short, short>{2000, 2000});
+  REQUIRE(conditioning.stick(Joypad::RS, 32000, 0) == std::pair<short, short>{32000, 0});
+  REQUIRE(conditioning.triggers(20, 100) == std::pair<std::int16_t, std::int16_t>{20, 100});
+}
+
+TEST_CASE("Triggers", "[CONDITIONING]") {
+  JoypadConditioning conditioning;
+  SerialWriter writer;
+  REQUIRE(conditioning.configure(writer, TriggerConditioning{.deadzone = 0.1f}));
+
+  REQUIRE(conditioning.triggers(20, 255) == std::pair<std::int16_t, std::int16_t>{0, 255});
+  REQUIRE(conditioning.triggers(-5, 1000) == std::pair<std::int16_t, std::int16_t>{0, 255});
+  REQUIRE_THAT(conditioning.triggers(140, 0).first, WithinAbs(127.5, 1));
+}
+
+TEST_CASE("Invalid conditioning", "[CONDITIONING]") {
+  JoypadConditioning conditioning;
+  SerialWriter writer;
+  REQUIRE(!conditioning.configure(writer, Joypad::LS, {.deadzone = 1.0f}));
+  REQUIRE(!conditioning.configure(writer, Joypad::LS, {.anti_deadzone = -0.1f}));
+  REQUIRE(!conditioning.configure(writer, Joypad::LS, {.exponent = 0.0f}));
+  REQUIRE(!conditioning.configure(writer, Joypad::LS, {.smoothing = 0.0f}));
+  REQUIRE(!conditioning.configure(writer, TriggerConditioning{.deadzone = std::nanf("")}));
+}
+
+TEST_CASE("Reconfiguring while the sticks are being moved", "[CONDITIONING]") {
+  JoypadConditioning conditioning;
+  SerialWriter writer;
+  std::atomic<bool> done = false;
+  std::atomic<int> out_of_range = 0;
+
+  std::thread sticks([&]() {
+    for (short value = 0; !done; value = (value + 1) % 32767) {
+      writer.run([&conditioning, &out_of_range, value]() {
+        auto [x, y] = conditioning.stick(Joypad::LS, value, -value);
+        if (x < 0 || y > 0) {
+          out_of_range++;
+        }
+      });
+    }
+    writer.flush();
+  });
+
+  for (int i = 0; i < 50; i++) {
+    auto type = i % 2 ? StickConditioning::RADIAL : StickConditioning::AXIAL;
+    REQUIRE(conditioning.configure(writer, Joypad::LS, {.deadzone_type = type, .deadzone = i / 100.0f}));
+  }
+  done = true;
+  sticks.join();
+  REQUIRE(out_of_range == 0);
+}
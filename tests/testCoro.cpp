@@ -0,0 +1,166 @@
+#include "catch2/catch_all.hpp"
+#include <inputtino/coro.hpp>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <optional>
+#include <poll.h>
+#include <utility>
+#include <vector>
+
+using namespace inputtino;
+
+/**
+ * The simplest coroutine type: starts straight away and nobody waits for it
+ */
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() {
+      return {};
+    }
+
+    std::suspend_never initial_suspend() {
+      return {};
+    }
+
+    std::suspend_never final_suspend() noexcept {
+      return {};
+    }
+
+    void return_void() {}
+
+    void unhandled_exception() {
+      std::terminate();
+    }
+  };
+};
+
+/**
+ * Same, but the caller owns it: it stays around after completion (or while suspended) until it's destroyed
+ */
+struct Owned {
+  struct promise_type {
+    Owned get_return_object() {
+      return {std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    std::suspend_never initial_suspend() {
+      return {};
+    }
+
+    std::suspend_always final_suspend() noexcept {
+      return {};
+    }
+
+    void return_void() {}
+
+    void unhandled_exception() {
+      std::terminate();
+    }
+  };
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+struct AlwaysReady : public VirtualDevice {
+  std::vector<std::string> get_nodes() const override {
+    return {};
+  }
+
+  void reset() override {}
+
+  bool is_ready() const override {
+    return true;
+  }
+};
+
+struct NeverReady : public VirtualDevice {
+  std::vector<std::string> get_nodes() const override {
+    return {};
+  }
+
+  void reset() override {}
+
+  bool is_ready() const override {
+    return false;
+  }
+};
+
+static Detached collect_rumbles(coro::Feedback &feedback, const VirtualDevice &device, std::vector<int> &rumbles) {
+  if (!co_await feedback.ready(device, std::chrono::seconds(1))) {
+    co_return;
+  }
+  while (rumbles.size() < 3) {
+    auto event = co_await feedback.next_rumble(42);
+    rumbles.push_back(event.payload.rumble.low_freq);
+  }
+}
+
+TEST_CASE("co_await feedback", "[CORO]") {
+  auto dispatcher = std::move(*FeedbackDispatcher::create(std::move(*FeedbackQueue::create())));
+  auto rumble = dispatcher.queue().rumble_callback(42);
+
+  std::vector<std::coroutine_handle<>> scheduled;
+  coro::Feedback feedback(dispatcher, [&scheduled](std::coroutine_handle<> handle) { scheduled.push_back(handle); });
+
+  AlwaysReady device;
+  std::vector<int> rumbles;
+  collect_rumbles(feedback, device, rumbles); // Suspends on the first rumble
+  REQUIRE(rumbles.empty());
+
+  rumble(1, 1);
+  dispatcher.dispatch();
+  REQUIRE(rumbles.empty()); // Resuming is up to the executor
+  REQUIRE(scheduled.size() == 1);
+
+  // Arrives while the coroutine is not waiting, it'll be picked up straight away
+  rumble(2, 2);
+  dispatcher.dispatch();
+  std::exchange(scheduled, {})[0].resume();
+  REQUIRE(rumbles == std::vector<int>{1, 2});
+  REQUIRE(scheduled.empty());
+
+  rumble(3, 3);
+  dispatcher.dispatch();
+  std::exchange(scheduled, {})[0].resume();
+  REQUIRE(rumbles == std::vector<int>{1, 2, 3});
+}
+
+static Owned wait_rumble(coro::Feedback &feedback, int &received) {
+  auto event = co_await feedback.next_rumble(42);
+  received = event.payload.rumble.low_freq;
+}
+
+static Owned wait_ready(coro::Feedback &feedback, const VirtualDevice &device, std::optional<bool> &ready) {
+  ready = co_await feedback.ready(device, std::chrono::milliseconds(10));
+}
+
+TEST_CASE("Destroying a suspended coroutine cancels its waits", "[CORO]") {
+  auto dispatcher = std::move(*FeedbackDispatcher::create(std::move(*FeedbackQueue::create())));
+  auto rumble = dispatcher.queue().rumble_callback(42);
+  coro::Feedback feedback(dispatcher);
+
+  int received = 0;
+  wait_rumble(feedback, received).handle.destroy();
+  rumble(1, 1);
+  dispatcher.dispatch();
+  REQUIRE(received == 0);
+  REQUIRE(dispatcher.take(42, FeedbackEvent::RUMBLE)->payload.rumble.low_freq == 1); // Nobody was waiting for it
+
+  NeverReady device;
+  std::optional<bool> ready;
+  wait_ready(feedback, device, ready).handle.destroy();
+  pollfd pfd{.fd = dispatcher.get_fd(), .events = POLLIN};
+  REQUIRE(poll(&pfd, 1, 50) == 0); // Not even the deadline is left
+  REQUIRE(!ready);
+
+  // Completed coroutines have nothing left to cancel
+  auto completed = wait_rumble(feedback, received);
+  rumble(2, 2);
+  dispatcher.dispatch();
+  REQUIRE(received == 2);
+  REQUIRE(completed.handle.done());
+  completed.handle.destroy();
+}
+
+#endif
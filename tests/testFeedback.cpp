@@ -0,0 +1,269 @@
+#include "catch2/catch_all.hpp"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <ctime>
+#include <inputtino/feedback.hpp>
+#include <optional>
+#include <poll.h>
+#include <pthread.h>
+#include <thread>
+#include <vector>
+
+using namespace inputtino;
+
+static bool is_readable(int fd) {
+  pollfd pfd{.fd = fd, .events = POLLIN};
+  return poll(&pfd, 1, 0) == 1;
+}
+
+TEST_CASE("FeedbackQueue basic", "[FEEDBACK]") {
+  auto queue = std::move(*FeedbackQueue::create(4));
+  REQUIRE(queue.get_fd() >= 0);
+  REQUIRE(!is_readable(queue.get_fd()));
+
+  auto rumble = queue.rumble_callback(1);
+  auto led = queue.led_callback(2);
+  rumble(100, 200);
+  led(255, 0, 128);
+  REQUIRE(is_readable(queue.get_fd()));
+
+  FeedbackEvent events[8];
+  REQUIRE(queue.drain(events, 8) == 2);
+  REQUIRE(!is_readable(queue.get_fd()));
+
+  REQUIRE(events[0].device_id == 1);
+  REQUIRE(events[0].kind == FeedbackEvent::RUMBLE);
+  REQUIRE(events[0].payload.rumble.low_freq == 100);
+  REQUIRE(events[0].payload.rumble.high_freq == 200);
+
+  REQUIRE(events[1].device_id == 2);
+  REQUIRE(events[1].kind == FeedbackEvent::LED);
+  REQUIRE(events[1].payload.led.r == 255);
+  REQUIRE(events[1].payload.led.g == 0);
+  REQUIRE(events[1].payload.led.b == 128);
+
+  // Bounded: events past the capacity are dropped
+  for (int i = 0; i < 6; i++) {
+    rumble(i, i);
+  }
+  REQUIRE(queue.dropped() == 2);
+
+  // A partial drain leaves the fd readable
+  REQUIRE(queue.drain(events, 3) == 3);
+  REQUIRE(is_readable(queue.get_fd()));
+  REQUIRE(queue.drain(events, 3) == 1);
+  REQUIRE(events[0].payload.rumble.low_freq == 3);
+  REQUIRE(!is_readable(queue.get_fd()));
+}
+
+TEST_CASE("FeedbackQueue multiple producers", "[FEEDBACK]") {
+  auto queue = std::move(*FeedbackQueue::create(64));
+  constexpr int nr_producers = 4;
+  constexpr int events_per_producer = 10000;
+
+  std::vector<std::thread> producers;
+  for (int id = 0; id < nr_producers; id++) {
+    producers.emplace_back([&queue, id]() {
+      auto rumble = queue.rumble_callback(id);
+      FeedbackEvent event{.device_id = static_cast<uint32_t>(id), .kind = FeedbackEvent::RUMBLE};
+      for (int i = 0; i < events_per_producer; i++) {
+        event.payload.rumble = {i, i};
+        while (!queue.push(event)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::vector<int> next_expected(nr_producers, 0);
+  int received = 0;
+  FeedbackEvent events[16];
+  while (received < nr_producers * events_per_producer) {
+    pollfd pfd{.fd = queue.get_fd(), .events = POLLIN};
+    REQUIRE(poll(&pfd, 1, 1000) == 1);
+    auto n = queue.drain(events, 16);
+    for (std::size_t i = 0; i < n; i++) {
+      // Events from the same producer are received in order
+      REQUIRE(events[i].payload.rumble.low_freq == next_expected[events[i].device_id]);
+      next_expected[events[i].device_id]++;
+    }
+    received += static_cast<int>(n);
+  }
+
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  // Nothing left, at most a spurious wakeup
+  REQUIRE(queue.drain(events, 16) == 0);
+  REQUIRE(!is_readable(queue.get_fd()));
+}
+
+static void pause_thread(int) {
+  timespec pause{.tv_sec = 0, .tv_nsec = 100000};
+  nanosleep(&pause, nullptr);
+}
+
+/* Returns the number of events received by the consumer before it stopped getting wakeups */
+static int push_with_paused_producers(int nr_producers, int events_per_producer) {
+  auto queue = std::move(*FeedbackQueue::create(16));
+  std::atomic<bool> stop = false;
+
+  std::vector<std::thread> producers;
+  for (int id = 0; id < nr_producers; id++) {
+    producers.emplace_back([&queue, &stop, id, events_per_producer]() {
+      FeedbackEvent event{.device_id = static_cast<uint32_t>(id), .kind = FeedbackEvent::RUMBLE};
+      for (int i = 0; i < events_per_producer; i++) {
+        event.payload.rumble = {i, i};
+        while (!queue.push(event)) {
+          if (stop) { // The consumer gave up, nobody is going to drain the queue
+            return;
+          }
+          std::this_thread::yield();
+        }
+      }
+      while (!stop) { // Stay alive until nobody sends signals to this thread anymore
+        std::this_thread::yield();
+      }
+    });
+  }
+
+  // The consumer is paused as well, in the middle of a drain() every now and then
+  std::thread pauser([&producers, &stop, nr_producers, consumer = pthread_self()]() {
+    for (int i = 0; !stop; i++) {
+      auto paused = i % (nr_producers + 1);
+      pthread_kill(paused == nr_producers ? consumer : producers[paused].native_handle(), SIGUSR1);
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  });
+
+  int received = 0;
+  FeedbackEvent events[4];
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (received < nr_producers * events_per_producer && std::chrono::steady_clock::now() < deadline) {
+    pollfd pfd{.fd = queue.get_fd(), .events = POLLIN};
+    if (poll(&pfd, 1, 100) == 1) { // Interrupted by the pauser every now and then
+      received += static_cast<int>(queue.drain(events, 4));
+      deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1); // Otherwise: lost wakeup
+    }
+  }
+
+  stop = true;
+  pauser.join();
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  return received;
+}
+
+TEST_CASE("FeedbackQueue paused producers", "[FEEDBACK]") {
+  // Threads are paused at random points, including producers between claiming a slot and publishing it, while the
+  // others keep going: no wakeup must be lost, the consumer has to see every single event.
+  struct sigaction action {};
+  action.sa_handler = pause_thread;
+  sigemptyset(&action.sa_mask);
+  struct sigaction previous {};
+  sigaction(SIGUSR1, &action, &previous);
+
+  for (int round = 0; round < 20; round++) {
+    REQUIRE(push_with_paused_producers(8, 5000) == 8 * 5000);
+  }
+
+  sigaction(SIGUSR1, &previous, nullptr);
+}
+
+struct FakeDevice : public VirtualDevice {
+  bool ready = false;
+  mutable int checks = 0;
+
+  std::vector<std::string> get_nodes() const override {
+    return {};
+  }
+
+  void reset() override {}
+
+  bool is_ready() const override {
+    checks++;
+    return ready;
+  }
+};
+
+static bool wait_readable(int fd) {
+  pollfd pfd{.fd = fd, .events = POLLIN};
+  return poll(&pfd, 1, 1000) == 1;
+}
+
+TEST_CASE("FeedbackDispatcher", "[FEEDBACK]") {
+  auto dispatcher = std::move(*FeedbackDispatcher::create(std::move(*FeedbackQueue::create(16))));
+  REQUIRE(!is_readable(dispatcher.get_fd()));
+
+  auto rumble = dispatcher.queue().rumble_callback(1);
+  auto led = dispatcher.queue().led_callback(1);
+
+  // Nobody is waiting: only the latest event is kept
+  rumble(1, 1);
+  rumble(2, 2);
+  REQUIRE(is_readable(dispatcher.get_fd()));
+  dispatcher.dispatch();
+  REQUIRE(!is_readable(dispatcher.get_fd()));
+  REQUIRE(dispatcher.take(1, FeedbackEvent::RUMBLE)->payload.rumble.low_freq == 2);
+  REQUIRE(!dispatcher.take(1, FeedbackEvent::RUMBLE));
+
+  std::vector<FeedbackEvent> received;
+  dispatcher.on_next(1, FeedbackEvent::LED, [&](const FeedbackEvent &event) { received.push_back(event); });
+  rumble(3, 3);
+  dispatcher.dispatch();
+  REQUIRE(received.empty());
+  led(10, 20, 30);
+  dispatcher.dispatch();
+  REQUIRE(received.size() == 1);
+  REQUIRE(received[0].payload.led.g == 20);
+  REQUIRE(!dispatcher.take(1, FeedbackEvent::LED)); // It's been handed over to the continuation
+
+  // Cancelled continuations are never called, the event is left for take()
+  auto wait_id = dispatcher.on_next(1, FeedbackEvent::LED, [&](const FeedbackEvent &event) {
+    received.push_back(event);
+  });
+  dispatcher.cancel(wait_id);
+  led(40, 50, 60);
+  dispatcher.dispatch();
+  REQUIRE(received.size() == 1);
+  REQUIRE(dispatcher.take(1, FeedbackEvent::LED)->payload.led.g == 50);
+
+  // Readiness is checked once for new waits, then only when device nodes show up or on the deadline
+  FakeDevice device;
+  std::optional<bool> device_ready;
+  dispatcher.on_ready(device, std::chrono::seconds(10), [&](bool ready) { device_ready = ready; });
+  REQUIRE(wait_readable(dispatcher.get_fd()));
+  dispatcher.dispatch();
+  REQUIRE(!device_ready);
+  REQUIRE(device.checks == 1);
+  device.ready = true;
+  rumble(4, 4);
+  dispatcher.dispatch(); // Just feedback, nothing to check
+  REQUIRE(!device_ready);
+  REQUIRE(device.checks == 1);
+
+  // A new wait checks all of them
+  std::optional<bool> other_ready;
+  dispatcher.on_ready(device, std::chrono::seconds(10), [&](bool ready) { other_ready = ready; });
+  REQUIRE(wait_readable(dispatcher.get_fd()));
+  dispatcher.dispatch();
+  REQUIRE(device_ready == true);
+  REQUIRE(other_ready == true);
+
+  // Cancelled waits are dropped, along with their deadline
+  device.ready = false;
+  device_ready = std::nullopt;
+  dispatcher.cancel(dispatcher.on_ready(device, std::chrono::milliseconds(10), [&](bool ready) {
+    device_ready = ready;
+  }));
+  REQUIRE(!is_readable(dispatcher.get_fd()));
+
+  dispatcher.on_ready(device, std::chrono::milliseconds(10), [&](bool ready) { device_ready = ready; });
+  while (!device_ready) {
+    REQUIRE(wait_readable(dispatcher.get_fd()));
+    dispatcher.dispatch();
+  }
+  REQUIRE(device_ready == false);
+}
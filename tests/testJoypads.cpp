@@ -1,6 +1,11 @@
 #include "catch2/catch_all.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <future>
 #include <inputtino/input.hpp>
 #include <iostream>
+#include <linux/input.h>
+#include <mutex>
 #include <SDL.h>
 #include <thread>
 
@@ -86,8 +91,14 @@ void test_buttons(SDL_GameController *gc, Joypad &joypad) {
 TEST_CASE_METHOD(SDLTestsFixture, "PS Joypad", "[SDL]") {
   // Create the controller
   auto joypad = std::move(*PS5Joypad::create());
+  REQUIRE(joypad.wait_ready(1s));
 
-  std::this_thread::sleep_for(250ms);
+  auto nodes = joypad.get_nodes();
+  auto has_node = [&nodes](const std::string &prefix) {
+    return std::any_of(nodes.begin(), nodes.end(), [&](const auto &node) { return node.rfind(prefix, 0) == 0; });
+  };
+  REQUIRE(has_node("/dev/hidraw"));
+  REQUIRE(has_node("/dev/input/js"));
 
   // TODO: seems that I can't force it to use HIDAPI, it's picking up sysjoystick which is lacking features
   SDL_SetHint(SDL_HINT_JOYSTICK_HIDAPI, "1");
@@ -122,6 +133,26 @@ TEST_CASE_METHOD(SDLTestsFixture, "PS Joypad", "[SDL]") {
     REQUIRE(rumble_data->second == 0xF0F0);
   }
 
+  { // Callbacks can call back into the joypad, even swap themselves or hand it over
+    auto called = std::make_shared<std::promise<void>>();
+    auto called_future = called->get_future();
+    joypad.set_on_rumble([&joypad, called](int low_freq, int high_freq) {
+      joypad.set_on_rumble([](int, int) {}); // Replaces the callback that is running
+      joypad.set_on_led([](int, int, int) {});
+      joypad.set_stick(Joypad::LS, 1000, 2000);
+      called->set_value();
+    });
+    SDL_GameControllerRumble(gc, 0xFF00, 0xF00F, 100); // The callback is called from the uhid thread
+    REQUIRE(called_future.wait_for(1s) == std::future_status::ready);
+
+    joypad.set_on_rumble([&joypad](int low_freq, int high_freq) {
+      joypad.set_on_rumble([](int, int) {});
+      joypad.handover();
+    });
+    joypad.reset(); // Tells the client to stop rumbling
+    REQUIRE(joypad.snapshot().ls_x == 0);
+  }
+
   { // LED
     // Unfortunately LINUX_JoystickSetLED is not implemented in sysjoystick
     // TODO: force hidapi driver
@@ -253,8 +284,7 @@ TEST_CASE_METHOD(SDLTestsFixture, "PS Joypad", "[SDL]") {
 TEST_CASE_METHOD(SDLTestsFixture, "XBOX Joypad", "[SDL]") {
   // Create the controller
   auto joypad = std::move(*XboxOneJoypad::create());
-
-  std::this_thread::sleep_for(150ms);
+  REQUIRE(joypad.wait_ready(1s));
 
   // Initializing the controller
   flush_sdl_events();
@@ -286,6 +316,47 @@ TEST_CASE_METHOD(SDLTestsFixture, "XBOX Joypad", "[SDL]") {
     REQUIRE(rumble_data->second == 100);
   }
 
+  { // Raw FF effects
+    struct FFEvents {
+      std::mutex m;
+      std::condition_variable cv;
+      std::vector<std::pair<Joypad::FF_EVENT_TYPE, ff_effect>> events;
+    };
+    auto ff_events = std::make_shared<FFEvents>();
+    joypad.set_on_ff_effect([ff_events](Joypad::FF_EVENT_TYPE type, const ff_effect &effect) {
+      std::lock_guard<std::mutex> lock(ff_events->m);
+      ff_events->events.push_back({type, effect});
+      ff_events->cv.notify_all();
+    });
+
+    SDL_GameControllerRumble(gc, 300, 400, 100);
+    std::unique_lock<std::mutex> lock(ff_events->m);
+    // wait for the effect to be picked up by the events thread
+    REQUIRE(ff_events->cv.wait_for(lock, 1s, [&ff_events]() { return ff_events->events.size() >= 2; }));
+    REQUIRE(ff_events->events.size() == 2);
+    REQUIRE(ff_events->events[0].first == Joypad::FF_EFFECT_UPLOAD);
+    REQUIRE(ff_events->events[1].first == Joypad::FF_EFFECT_PLAY);
+    auto effect = ff_events->events[1].second;
+    REQUIRE(effect.type == FF_RUMBLE);
+    REQUIRE(effect.u.rumble.strong_magnitude == 300);
+    REQUIRE(effect.u.rumble.weak_magnitude == 400);
+  }
+
+  { // Callbacks can call back into the joypad, even swap themselves
+    auto called = std::make_shared<std::promise<void>>();
+    auto called_future = called->get_future();
+    joypad.set_on_ff_effect([&joypad, called](Joypad::FF_EVENT_TYPE type, const ff_effect &effect) {
+      if (type == Joypad::FF_EFFECT_PLAY) {
+        joypad.set_on_ff_effect([](Joypad::FF_EVENT_TYPE, const ff_effect &) {}); // Replaces the running callback
+        joypad.set_on_rumble([](int, int) {});
+        joypad.set_stick(Joypad::LS, 1000, 2000);
+        called->set_value();
+      }
+    });
+    SDL_GameControllerRumble(gc, 300, 400, 100); // The callback is called from the events thread
+    REQUIRE(called_future.wait_for(1s) == std::future_status::ready);
+  }
+
   { // Sticks
     REQUIRE(SDL_GameControllerHasAxis(gc, SDL_CONTROLLER_AXIS_LEFTX));
     REQUIRE(SDL_GameControllerHasAxis(gc, SDL_CONTROLLER_AXIS_LEFTY));
@@ -309,6 +380,12 @@ TEST_CASE_METHOD(SDLTestsFixture, "XBOX Joypad", "[SDL]") {
     REQUIRE(SDL_GameControllerGetAxis(gc, SDL_CONTROLLER_AXIS_TRIGGERLEFT) == 1284);
     REQUIRE(SDL_GameControllerGetAxis(gc, SDL_CONTROLLER_AXIS_TRIGGERRIGHT) == 2569);
 
+    auto snapshot = joypad.snapshot();
+    REQUIRE(snapshot.ls_x == 1000);
+    REQUIRE(snapshot.rs_y == 2000);
+    REQUIRE(snapshot.left_trigger == 10);
+    REQUIRE(snapshot.right_trigger == 20);
+
     joypad.set_triggers(0, 0);
     flush_sdl_events();
     REQUIRE(SDL_GameControllerGetAxis(gc, SDL_CONTROLLER_AXIS_TRIGGERLEFT) == 0);
@@ -321,8 +398,7 @@ TEST_CASE_METHOD(SDLTestsFixture, "XBOX Joypad", "[SDL]") {
 TEST_CASE_METHOD(SDLTestsFixture, "Nintendo Joypad", "[SDL]") {
   // Create the controller
   auto joypad = std::move(*SwitchJoypad::create());
-
-  std::this_thread::sleep_for(150ms);
+  REQUIRE(joypad.wait_ready(1s));
 
   // Initializing the controller
   flush_sdl_events();
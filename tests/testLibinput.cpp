@@ -2,6 +2,7 @@
 
 #include "libinput.h"
 #include <inputtino/input.hpp>
+#include <inputtino/session.hpp>
 #include <libinput.h>
 #include <linux/input-event-codes.h>
 #include <thread>
@@ -17,6 +18,7 @@ using namespace std::chrono_literals;
 
 TEST_CASE("virtual keyboard", "[LIBINPUT]") {
     auto kb = std::move(*Keyboard::create());
+    REQUIRE(kb.wait_ready(1s));
     auto li = create_libinput_context(kb.get_nodes());
     auto event = get_event(li);
     REQUIRE(libinput_event_get_type(event.get()) == LIBINPUT_EVENT_DEVICE_ADDED);
@@ -42,6 +44,19 @@ TEST_CASE("virtual keyboard", "[LIBINPUT]") {
         REQUIRE(libinput_event_keyboard_get_key(k_event) == linux_code);
         REQUIRE(libinput_event_keyboard_get_key_state(k_event) == LIBINPUT_KEY_STATE_RELEASED);
     }
+
+    { // Reset should release all pressed keys
+        kb.press(test_key);
+        event = get_event(li);
+        REQUIRE(libinput_event_get_type(event.get()) == LIBINPUT_EVENT_KEYBOARD_KEY);
+
+        kb.reset();
+        event = get_event(li);
+        REQUIRE(libinput_event_get_type(event.get()) == LIBINPUT_EVENT_KEYBOARD_KEY);
+        auto k_event = libinput_event_get_keyboard_event(event.get());
+        REQUIRE(libinput_event_keyboard_get_key(k_event) == linux_code);
+        REQUIRE(libinput_event_keyboard_get_key_state(k_event) == LIBINPUT_KEY_STATE_RELEASED);
+    }
 }
 
 TEST_CASE("virtual mouse relative", "[LIBINPUT]") {
@@ -60,6 +75,31 @@ TEST_CASE("virtual mouse relative", "[LIBINPUT]") {
         REQUIRE(libinput_event_pointer_get_dy_unaccelerated(p_event) == 100);
     }
 
+    { // Fractional moves are only sent once they add up to a whole unit
+        mouse.move_subpixel(0.4f, -0.75f);
+        mouse.move_subpixel(0.4f, -0.75f);
+        mouse.move_subpixel(0.4f, 0.0f);
+        event = get_event(li);
+        REQUIRE(libinput_event_get_type(event.get()) == LIBINPUT_EVENT_POINTER_MOTION);
+        auto p_event = libinput_event_get_pointer_event(event.get());
+        REQUIRE(libinput_event_pointer_get_dx_unaccelerated(p_event) == 0);
+        REQUIRE(libinput_event_pointer_get_dy_unaccelerated(p_event) == -1);
+
+        event = get_event(li);
+        REQUIRE(libinput_event_get_type(event.get()) == LIBINPUT_EVENT_POINTER_MOTION);
+        p_event = libinput_event_get_pointer_event(event.get());
+        REQUIRE(libinput_event_pointer_get_dx_unaccelerated(p_event) == 1);
+        REQUIRE(libinput_event_pointer_get_dy_unaccelerated(p_event) == 0);
+
+        // The remainders (0.2, -0.5) are added to the next move
+        mouse.move_subpixel(10.9f, -10.5f);
+        event = get_event(li);
+        REQUIRE(libinput_event_get_type(event.get()) == LIBINPUT_EVENT_POINTER_MOTION);
+        p_event = libinput_event_get_pointer_event(event.get());
+        REQUIRE(libinput_event_pointer_get_dx_unaccelerated(p_event) == 11);
+        REQUIRE(libinput_event_pointer_get_dy_unaccelerated(p_event) == -11);
+    }
+
     {
         mouse.press(Mouse::LEFT);
         event = get_event(li);
@@ -127,6 +167,9 @@ TEST_CASE("virtual mouse relative", "[LIBINPUT]") {
 
 TEST_CASE("virtual mouse absolue", "[LIBINPUT]") {
     auto mouse = std::move(*Mouse::create());
+    REQUIRE(mouse.get_nodes().size() == 1); // The absolute device is created lazily
+    REQUIRE(mouse.create_abs_device());
+    REQUIRE(mouse.get_nodes().size() == 2);
     auto li = create_libinput_context({mouse.get_nodes()[1]});
     auto event = get_event(li);
     REQUIRE(libinput_event_get_type(event.get()) == LIBINPUT_EVENT_DEVICE_ADDED);
@@ -316,4 +359,27 @@ TEST_CASE("virtual pen tablet", "[LIBINPUT]") {
         REQUIRE(libinput_event_tablet_tool_get_button(t_event) == BTN_STYLUS);
         REQUIRE(libinput_event_tablet_tool_get_button_state(t_event) == LIBINPUT_BUTTON_STATE_RELEASED);
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("virtual session", "[LIBINPUT]") {
+    auto session = create_session({.keyboard = true,
+                                   .mouse = true,
+                                   .trackpad = true,
+                                   .touch_screen = true,
+                                   .pen_tablet = true,
+                                   .joypads = {{.type = SessionSpec::XBOX}, {.type = SessionSpec::NINTENDO}}});
+    REQUIRE(session);
+    REQUIRE((*session).keyboard);
+    REQUIRE((*session).mouse);
+    REQUIRE((*session).trackpad);
+    REQUIRE((*session).touch_screen);
+    REQUIRE((*session).pen_tablet);
+    REQUIRE((*session).joypads.size() == 2);
+    REQUIRE(std::holds_alternative<XboxOneJoypad>((*session).joypads[0]));
+    REQUIRE(std::holds_alternative<SwitchJoypad>((*session).joypads[1]));
+
+    auto li = create_libinput_context((*session).keyboard->get_nodes());
+    auto event = get_event(li);
+    REQUIRE(libinput_event_get_type(event.get()) == LIBINPUT_EVENT_DEVICE_ADDED);
+    REQUIRE(libinput_device_has_capability(libinput_event_get_device(event.get()), LIBINPUT_DEVICE_CAP_KEYBOARD));
+}
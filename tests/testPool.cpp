@@ -0,0 +1,81 @@
+#include "catch2/catch_all.hpp"
+#include <inputtino/pool.hpp>
+#include <memory>
+#include <thread>
+
+using namespace inputtino;
+
+namespace {
+/**
+ * A stand-in for a real device, so that we can test the pool without /dev/uinput
+ */
+struct FakeDevice {
+  std::unique_ptr<int> id;
+  int handovers = 0;
+
+  void handover() {
+    handovers++;
+  }
+};
+} // namespace
+
+TEST_CASE("DevicePool", "[POOL]") {
+  int created = 0;
+  auto pool = DevicePool<FakeDevice>(2, [&created]() -> Result<FakeDevice> {
+    return FakeDevice{std::make_unique<int>(created++)};
+  });
+  REQUIRE(pool.idle() == 0);
+
+  auto filled = pool.fill();
+  REQUIRE(filled);
+  REQUIRE(*filled == 2);
+  REQUIRE(created == 2);
+
+  // Acquiring doesn't create new devices while there are idle ones
+  auto first = pool.acquire();
+  auto second = pool.acquire();
+  REQUIRE(first);
+  REQUIRE(second);
+  REQUIRE(created == 2);
+  REQUIRE(pool.idle() == 0);
+
+  // An empty pool creates a new device on the spot
+  auto third = pool.acquire();
+  REQUIRE(third);
+  REQUIRE(created == 3);
+
+  // Released devices are handed over and reused
+  auto first_id = *(*first).id;
+  pool.release(std::move(*first));
+  REQUIRE(pool.idle() == 1);
+  auto reused = pool.acquire();
+  REQUIRE(*(*reused).id == first_id);
+  REQUIRE((*reused).handovers == 1);
+
+  // Never keeps more than `size` idle devices
+  pool.release(std::move(*reused));
+  pool.release(std::move(*second));
+  pool.release(std::move(*third));
+  REQUIRE(pool.idle() == 2);
+  REQUIRE(!(*third).id); // Destroyed, not left behind in the caller's object
+}
+
+TEST_CASE("DevicePool errors", "[POOL]") {
+  auto pool = DevicePool<FakeDevice>(2, []() -> Result<FakeDevice> { return Error("Nope"); });
+  auto filled = pool.fill();
+  REQUIRE(!filled);
+  REQUIRE(filled.getErrorMessage() == "Nope");
+  REQUIRE(!pool.acquire());
+}
+
+TEST_CASE("DevicePool background fill", "[POOL]") {
+  auto pool = DevicePool<FakeDevice>(16, []() -> Result<FakeDevice> { return FakeDevice{std::make_unique<int>(0)}; });
+  auto filler = std::thread([&pool]() { pool.fill(); });
+  for (int i = 0; i < 32; i++) {
+    if (auto device = pool.acquire()) {
+      pool.release(std::move(*device));
+    }
+  }
+  filler.join();
+  REQUIRE(pool.idle() == 16);
+}
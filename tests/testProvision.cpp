@@ -0,0 +1,52 @@
+#include "catch2/catch_all.hpp"
+#include <filesystem>
+#include <inputtino/input.hpp>
+#include <inputtino/provision.hpp>
+#include <sys/stat.h>
+
+using namespace inputtino;
+
+TEST_CASE("Provision device nodes", "[PROVISION]") {
+  auto target = std::filesystem::temp_directory_path() / "inputtino-provision";
+  std::filesystem::remove_all(target);
+  std::filesystem::create_directories(target);
+
+  auto mouse = Mouse::create();
+  REQUIRE(mouse);
+  auto keyboard = Keyboard::create();
+  REQUIRE(keyboard);
+
+  std::vector<const VirtualDevice *> devices = {&*mouse, &*keyboard};
+  auto provisioned = ProvisionedNodes::create(devices, target.string(), {.mode = 0600});
+  REQUIRE(provisioned);
+
+  std::vector<std::string> expected = (*mouse).get_nodes();
+  auto kb_nodes = (*keyboard).get_nodes();
+  expected.insert(expected.end(), kb_nodes.begin(), kb_nodes.end());
+  REQUIRE((*provisioned).get_nodes().size() == expected.size());
+
+  for (std::size_t i = 0; i < expected.size(); i++) {
+    auto node = (*provisioned).get_nodes()[i];
+    REQUIRE(node == target.string() + expected[i].substr(4)); // same path, relative to /dev
+    struct stat original {}, copy{};
+    REQUIRE(stat(expected[i].c_str(), &original) == 0);
+    REQUIRE(stat(node.c_str(), &copy) == 0);
+    REQUIRE(S_ISCHR(copy.st_mode));
+    REQUIRE(copy.st_rdev == original.st_rdev);
+    REQUIRE((copy.st_mode & 0777) == 0600);
+  }
+
+  // The absolute pointer is created lazily, pick it up
+  REQUIRE((*mouse).create_abs_device());
+  REQUIRE((*provisioned).update(devices));
+  REQUIRE((*provisioned).get_nodes().size() == expected.size() + 1);
+
+  auto nodes = (*provisioned).get_nodes();
+  { // Nodes are removed together with the provisioned object
+    auto moved = std::move(*provisioned);
+  }
+  for (const auto &node : nodes) {
+    REQUIRE(!std::filesystem::exists(node));
+  }
+  std::filesystem::remove_all(target);
+}
@@ -0,0 +1,217 @@
+#include "catch2/catch_all.hpp"
+#include <inputtino/rumble.hpp>
+
+using namespace inputtino;
+using namespace std::chrono_literals;
+
+static ff_effect make_rumble(int id, std::uint16_t weak, std::uint16_t strong, std::uint16_t length_ms = 1000) {
+  ff_effect effect = {};
+  effect.type = FF_RUMBLE;
+  effect.id = id;
+  effect.replay.length = length_ms;
+  effect.u.rumble.weak_magnitude = weak;
+  effect.u.rumble.strong_magnitude = strong;
+  return effect;
+}
+
+TEST_CASE("RumbleMixer single effect", "[RUMBLE]") {
+  RumbleMixer mixer;
+  auto now = std::chrono::steady_clock::now();
+
+  REQUIRE(mixer.upload(make_rumble(0, 200, 100, 100)));
+  REQUIRE(!mixer.tick(now)); // Nothing is playing yet
+
+  mixer.play(0, now);
+  auto output = mixer.tick(now + 10ms);
+  REQUIRE(output);
+  REQUIRE(output->first == 200);
+  REQUIRE(output->second == 100);
+
+  // Same output, no need to report it again
+  REQUIRE(!mixer.tick(now + 20ms));
+
+  // Once the effect is over we should go back to 0
+  output = mixer.tick(now + 150ms);
+  REQUIRE(output);
+  REQUIRE(output->first == 0);
+  REQUIRE(output->second == 0);
+  REQUIRE(!mixer.tick(now + 200ms));
+}
+
+TEST_CASE("RumbleMixer concurrent effects", "[RUMBLE]") {
+  RumbleMixer mixer;
+  auto now = std::chrono::steady_clock::now();
+
+  REQUIRE(mixer.upload(make_rumble(0, 0x1000, 0xF000)));
+  REQUIRE(mixer.upload(make_rumble(1, 0x2000, 0xF000)));
+  mixer.play(0, now);
+  mixer.play(1, now);
+
+  auto output = mixer.tick(now + 10ms);
+  REQUIRE(output);
+  REQUIRE(output->first == 0x3000);
+  REQUIRE(output->second == RumbleMixer::MAX_MAGNITUDE); // Clamped
+
+  // Stopping one of them leaves the other one playing
+  REQUIRE(mixer.playing(1));
+  mixer.stop(1);
+  REQUIRE(!mixer.playing(1));
+  REQUIRE(mixer.playing(0));
+  output = mixer.tick(now + 20ms);
+  REQUIRE(output);
+  REQUIRE(output->first == 0x1000);
+  REQUIRE(output->second == 0xF000);
+
+  // Erasing a playing effect stops it
+  mixer.erase(0);
+  output = mixer.tick(now + 30ms);
+  REQUIRE(output);
+  REQUIRE(output->first == 0);
+  REQUIRE(output->second == 0);
+
+  // Erased effects can't be played anymore
+  mixer.play(0, now);
+  REQUIRE(!mixer.tick(now + 40ms));
+}
+
+TEST_CASE("RumbleMixer gain", "[RUMBLE]") {
+  RumbleMixer mixer;
+  auto now = std::chrono::steady_clock::now();
+
+  mixer.set_gain(0x8000);
+  REQUIRE(mixer.upload(make_rumble(0, 0xFFFF, 0x1000)));
+  mixer.play(0, now);
+
+  auto output = mixer.tick(now + 10ms);
+  REQUIRE(output);
+  REQUIRE(output->first == 0x8000);
+  REQUIRE(output->second == 0x1000 * 0x8000 / 0xFFFF);
+
+  mixer.set_gain(0);
+  output = mixer.tick(now + 20ms);
+  REQUIRE(output);
+  REQUIRE(output->first == 0);
+  REQUIRE(output->second == 0);
+}
+
+TEST_CASE("RumbleMixer out of range effects", "[RUMBLE]") {
+  RumbleMixer mixer;
+  auto now = std::chrono::steady_clock::now();
+
+  REQUIRE(!mixer.upload(make_rumble(-1, 100, 100)));
+  REQUIRE(!mixer.upload(make_rumble(RumbleMixer::MAX_EFFECTS, 100, 100)));
+
+  // Should be safely ignored
+  mixer.play(RumbleMixer::MAX_EFFECTS, now);
+  mixer.stop(-1);
+  mixer.erase(RumbleMixer::MAX_EFFECTS + 1);
+  REQUIRE(!mixer.tick(now));
+}
+
+TEST_CASE("RumbleTable constant with envelope", "[RUMBLE]") {
+  ff_effect effect = {};
+  effect.type = FF_CONSTANT;
+  effect.replay.length = 1000;
+  effect.replay.delay = 100;
+  effect.u.constant.level = 0x7FFF;
+  effect.u.constant.envelope.attack_length = 100;
+  effect.u.constant.envelope.attack_level = 0;
+  effect.u.constant.envelope.fade_length = 100;
+  effect.u.constant.envelope.fade_level = 0;
+
+  RumbleTable table;
+  compile_rumble_effect(effect, table);
+  REQUIRE(table.samples.size() == 1000);
+
+  REQUIRE(table.at(50ms).weak == 0); // Delayed
+  REQUIRE(table.at(100ms).weak == 0);
+  REQUIRE(table.at(150ms).weak == rumble_level_to_magnitude(0x7FFF / 2));
+  REQUIRE(table.at(500ms).weak == 0xFFFF);
+  REQUIRE(table.at(500ms).strong == 0xFFFF);
+  REQUIRE(table.at(1050ms).weak == rumble_level_to_magnitude(0x7FFF / 2));
+  REQUIRE(!table.ended(1099ms));
+  REQUIRE(table.ended(1100ms));
+}
+
+TEST_CASE("RumbleTable periodic", "[RUMBLE]") {
+  ff_effect effect = {};
+  effect.type = FF_PERIODIC;
+  effect.replay.length = 0; // Infinite
+  effect.u.periodic.waveform = FF_SQUARE;
+  effect.u.periodic.period = 100;
+  effect.u.periodic.magnitude = 0x4000;
+  effect.u.periodic.offset = 0x2000;
+
+  RumbleTable table;
+  compile_rumble_effect(effect, table);
+  REQUIRE(table.periodic);
+  REQUIRE(table.periodic->waveform.size() == 100);
+
+  // offset + magnitude during the first half of the period, offset - magnitude on the second half
+  auto high = rumble_level_to_magnitude(0x6000);
+  auto low = rumble_level_to_magnitude(0x2000 - 0x4000);
+  REQUIRE(table.at(10ms).weak == high);
+  REQUIRE(table.at(60ms).weak == low);
+  // Keeps looping
+  REQUIRE(table.at(10010ms).weak == high);
+  REQUIRE(table.at(10060ms).weak == low);
+  REQUIRE(!table.ended(100000ms));
+
+  effect.u.periodic.waveform = FF_TRIANGLE;
+  effect.u.periodic.offset = 0;
+  compile_rumble_effect(effect, table);
+  REQUIRE(table.at(0ms).weak == rumble_level_to_magnitude(0x4000));
+  REQUIRE(table.at(25ms).weak == 0);
+  REQUIRE(table.at(50ms).weak == rumble_level_to_magnitude(0x4000));
+}
+
+TEST_CASE("RumbleTable long periodic effects", "[RUMBLE]") {
+  ff_effect effect = {};
+  effect.type = FF_PERIODIC;
+  effect.u.periodic.waveform = FF_SINE;
+  effect.u.periodic.period = 20;
+  effect.u.periodic.magnitude = 0x6000;
+  effect.u.periodic.phase = 0x4000;
+  effect.u.periodic.envelope.attack_length = 300;
+  effect.u.periodic.envelope.attack_level = 0x1000;
+  effect.u.periodic.envelope.fade_length = 2000;
+  effect.u.periodic.envelope.fade_level = 0;
+
+  // No matter how long the effect is, every period must be played back as it was sampled on its own
+  for (std::uint16_t length : {5000, 32767}) {
+    effect.replay.length = length;
+    RumbleTable table;
+    compile_rumble_effect(effect, table);
+    REQUIRE(table.periodic->waveform.size() == 20);
+    REQUIRE(table.periodic->fade.size() <= RumbleTable::MAX_SAMPLES);
+
+    for (int t = 0; t < length; t += 7) {
+      INFO("length: " << length << " t: " << t);
+      REQUIRE_THAT(table.at(std::chrono::milliseconds{t}).weak,
+                   Catch::Matchers::WithinAbs(rumble_sample(effect, t).weak, 0x40));
+    }
+    REQUIRE(table.ended(std::chrono::milliseconds{length}));
+  }
+}
+
+TEST_CASE("RumbleTable long effects", "[RUMBLE]") {
+  ff_effect effect = {};
+  effect.type = FF_RAMP;
+  effect.replay.length = 32767;
+  effect.u.ramp.start_level = 0;
+  effect.u.ramp.end_level = 0x7FFF;
+
+  RumbleTable table;
+  compile_rumble_effect(effect, table);
+  REQUIRE(table.samples.size() <= RumbleTable::MAX_SAMPLES);
+  REQUIRE(table.at(0ms).weak == 0);
+  REQUIRE_THAT(table.at(16384ms).weak, Catch::Matchers::WithinAbs(0x7FFF, 0x100));
+  REQUIRE_THAT(table.at(32766ms).weak, Catch::Matchers::WithinAbs(0xFFFF, 0x100));
+
+  // Rumble effects are constant, no need to sample them
+  effect = make_rumble(0, 100, 200, 32767);
+  compile_rumble_effect(effect, table);
+  REQUIRE(table.samples.size() == 1);
+  REQUIRE(table.at(30000ms).weak == 100);
+  REQUIRE(table.at(30000ms).strong == 200);
+}
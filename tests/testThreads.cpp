@@ -0,0 +1,40 @@
+#include "catch2/catch_all.hpp"
+#include <inputtino/threads.hpp>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <thread>
+
+using namespace inputtino;
+
+TEST_CASE("Thread config", "[THREADS]") {
+  REQUIRE(!set_thread_config({.policy = ThreadConfig::FIFO, .priority = 1000}));
+  REQUIRE(!set_thread_config({.cpus = {-1}}));
+
+  // Without CAP_SYS_NICE the policy can't be applied, the rest of the config still has to be
+  REQUIRE(set_thread_config({.policy = ThreadConfig::RR, .priority = 10, .cpus = {0}}));
+  REQUIRE(get_thread_config().priority == 10);
+
+  std::string name;
+  bool pinned = false;
+  int policy = -1;
+  std::thread([&]() {
+    apply_thread_config("test");
+    char buffer[16] = {};
+    pthread_getname_np(pthread_self(), buffer, sizeof(buffer));
+    name = buffer;
+
+    cpu_set_t cpus;
+    pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    pinned = CPU_COUNT(&cpus) == 1 && CPU_ISSET(0, &cpus);
+
+    sched_param param{};
+    pthread_getschedparam(pthread_self(), &policy, &param);
+  }).join();
+
+  REQUIRE(name == "inputtino-test");
+  REQUIRE(pinned);
+  REQUIRE((policy == SCHED_RR || policy == SCHED_OTHER));
+
+  REQUIRE(set_thread_config({}));
+}
@@ -0,0 +1,145 @@
+#include "catch2/catch_all.hpp"
+#include <algorithm>
+#include <cstring>
+#include <endian.h>
+#include <inputtino/udev_monitor.hpp>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace inputtino;
+
+static bool has_property(const std::vector<std::string> &properties, const std::string &property) {
+  return std::find(properties.begin(), properties.end(), property) != properties.end();
+}
+
+TEST_CASE("udev input_id", "[UDEV]") {
+  auto mouse = UinputTemplate{}.rel(REL_X).rel(REL_Y).key(BTN_LEFT).key(BTN_RIGHT);
+  auto properties = udev_input_properties(mouse);
+  REQUIRE(has_property(properties, "ID_INPUT=1"));
+  REQUIRE(has_property(properties, "ID_INPUT_MOUSE=1"));
+  REQUIRE(!has_property(properties, "ID_INPUT_KEY=1"));
+
+  UinputTemplate keyboard;
+  for (int code = KEY_ESC; code <= KEY_MICMUTE; code++) {
+    keyboard.key(code);
+  }
+  properties = udev_input_properties(keyboard);
+  REQUIRE(has_property(properties, "ID_INPUT_KEY=1"));
+  REQUIRE(has_property(properties, "ID_INPUT_KEYBOARD=1"));
+
+  auto joypad = UinputTemplate{}
+                    .key(BTN_SOUTH)
+                    .key(BTN_EAST)
+                    .abs_axis(ABS_X, {.minimum = -32768, .maximum = 32767})
+                    .abs_axis(ABS_Y, {.minimum = -32768, .maximum = 32767})
+                    .abs_axis(ABS_RX, {.minimum = -32768, .maximum = 32767})
+                    .abs_axis(ABS_RY, {.minimum = -32768, .maximum = 32767});
+  properties = udev_input_properties(joypad);
+  REQUIRE(has_property(properties, "ID_INPUT_JOYSTICK=1"));
+  REQUIRE(!has_property(properties, "ID_INPUT_KEY=1"));
+
+  auto trackpad = UinputTemplate{}
+                      .key(BTN_LEFT)
+                      .key(BTN_TOOL_FINGER)
+                      .key(BTN_TOUCH)
+                      .abs_axis(ABS_MT_POSITION_X, {.maximum = 1920})
+                      .abs_axis(ABS_MT_POSITION_Y, {.maximum = 1080})
+                      .property(INPUT_PROP_POINTER);
+  REQUIRE(has_property(udev_input_properties(trackpad), "ID_INPUT_TOUCHPAD=1"));
+
+  auto touchscreen = UinputTemplate{}
+                         .key(BTN_TOUCH)
+                         .abs_axis(ABS_MT_POSITION_X, {.maximum = 1920})
+                         .abs_axis(ABS_MT_POSITION_Y, {.maximum = 1080})
+                         .property(INPUT_PROP_DIRECT);
+  REQUIRE(has_property(udev_input_properties(touchscreen), "ID_INPUT_TOUCHSCREEN=1"));
+
+  auto tablet = UinputTemplate{}
+                    .key(BTN_TOOL_PEN)
+                    .key(BTN_STYLUS)
+                    .abs_axis(ABS_X, {.maximum = 1920})
+                    .abs_axis(ABS_Y, {.maximum = 1080});
+  REQUIRE(has_property(udev_input_properties(tablet), "ID_INPUT_TABLET=1"));
+
+  auto motion_sensors = UinputTemplate{}
+                            .abs_axis(ABS_X, {.maximum = 1})
+                            .abs_axis(ABS_Y, {.maximum = 1})
+                            .abs_axis(ABS_RX, {.maximum = 1})
+                            .property(INPUT_PROP_ACCELEROMETER);
+  properties = udev_input_properties(motion_sensors);
+  REQUIRE(has_property(properties, "ID_INPUT_ACCELEROMETER=1"));
+  REQUIRE(!has_property(properties, "ID_INPUT_JOYSTICK=1"));
+}
+
+struct MonitorHeader {
+  char prefix[8];
+  std::uint32_t magic;
+  std::uint32_t header_size;
+  std::uint32_t properties_off;
+  std::uint32_t properties_len;
+  std::uint32_t filter_subsystem_hash;
+  std::uint32_t filter_devtype_hash;
+  std::uint32_t filter_tag_bloom_hi;
+  std::uint32_t filter_tag_bloom_lo;
+};
+
+static std::vector<std::string> parse_properties(const char *data, std::size_t size) {
+  auto header = reinterpret_cast<const MonitorHeader *>(data);
+  std::vector<std::string> properties;
+  // Sizes and offsets are in host byte order, same as libudev reads them
+  auto offset = header->properties_off;
+  auto end = offset + header->properties_len;
+  REQUIRE(end <= size);
+  while (offset < end) {
+    properties.emplace_back(data + offset);
+    offset += properties.back().size() + 1;
+  }
+  return properties;
+}
+
+TEST_CASE("udev monitor message", "[UDEV]") {
+  std::vector<std::string> properties = {"ACTION=add", "SUBSYSTEM=input", "DEVNAME=/dev/input/event42"};
+  auto message = udev_monitor_message(properties, "input", "", {"seat"});
+  REQUIRE(message.size() >= sizeof(MonitorHeader));
+
+  auto header = reinterpret_cast<const MonitorHeader *>(message.data());
+  REQUIRE(std::string(header->prefix) == "libudev");
+  REQUIRE(be32toh(header->magic) == 0xfeedcafe);
+  REQUIRE(header->header_size == sizeof(MonitorHeader));
+  REQUIRE(header->properties_off == sizeof(MonitorHeader));
+  // libudev drops messages where `properties_off + 32 > size`
+  REQUIRE(header->properties_off + 32 <= message.size());
+  REQUIRE(be32toh(header->filter_subsystem_hash) == udev_murmur_hash2("input"));
+  REQUIRE(header->filter_devtype_hash == 0);
+  REQUIRE((header->filter_tag_bloom_hi | header->filter_tag_bloom_lo) != 0);
+  REQUIRE(parse_properties(message.data(), message.size()) == properties);
+}
+
+TEST_CASE("udev netlink broadcast", "[UDEV]") {
+  int listener = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+  REQUIRE(listener >= 0);
+  sockaddr_nl addr{.nl_family = AF_NETLINK, .nl_pid = 0, .nl_groups = 2 /* udev */};
+  REQUIRE(bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0);
+
+  std::vector<std::string> properties = {"ACTION=add", "SUBSYSTEM=input", "DEVNAME=/dev/input/event42"};
+  auto sent = udev_broadcast(udev_monitor_message(properties, "input", "", {"seat"}));
+  if (!sent) {
+    close(listener);
+    SKIP("Unable to broadcast (missing CAP_NET_ADMIN?): " << sent.getErrorMessage());
+  }
+
+  // When udevd is running we might get other events as well, look for ours
+  bool received = false;
+  pollfd pfd{.fd = listener, .events = POLLIN};
+  while (!received && poll(&pfd, 1, 1000) == 1) {
+    char buffer[4096];
+    auto size = recv(listener, buffer, sizeof(buffer), 0);
+    REQUIRE(size > 0);
+    REQUIRE(std::string(buffer) == "libudev");
+    received = parse_properties(buffer, size) == properties;
+  }
+  close(listener);
+  REQUIRE(received);
+}